@@ -21,6 +21,7 @@
 static enum shutdown_type how = SHUTDOWN_NONE;
 
 static void print_stats (void);
+static void power_off (void) NO_RETURN;
 
 /* Shuts down the machine in the way configured by
    shutdown_configure().  If the shutdown type is SHUTDOWN_NONE
@@ -87,12 +88,27 @@ shutdown_reboot (void)
 void
 shutdown_power_off (void)
 {
-  const char s[] = "Shutdown";
-  const char *p;
-
 #ifdef FILESYS
   filesys_done ();
 #endif
+  power_off ();
+}
+
+/* Powers down the machine like shutdown_power_off(), but without
+   writing back anything the file system holds in memory, as if
+   the power failed. */
+void
+shutdown_power_fail (void)
+{
+  power_off ();
+}
+
+/* Prints statistics and powers down the machine. */
+static void
+power_off (void)
+{
+  const char s[] = "Shutdown";
+  const char *p;
 
   print_stats ();
 
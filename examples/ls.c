@@ -24,38 +24,35 @@ list_dir (const char *dir, bool verbose)
 
   if (isdir (dir_fd))
     {
-      char name[READDIR_MAX_LEN];
+      struct dirent entries[16];
+      int cnt;
 
       printf ("%s", dir);
       if (verbose)
         printf (" (inumber %d)", inumber (dir_fd));
       printf (":\n");
 
-      while (readdir (dir_fd, name)) 
+      /* getdents() returns each entry's type, size and inumber
+         along with its name, so there is no need to open the
+         entries one by one. */
+      while ((cnt = getdents (dir_fd, entries,
+                              sizeof entries / sizeof *entries)) > 0)
         {
-          printf ("%s", name); 
-          if (verbose) 
+          int i;
+          for (i = 0; i < cnt; i++)
             {
-              char full_name[128];
-              int entry_fd;
-
-              snprintf (full_name, sizeof full_name, "%s/%s", dir, name);
-              entry_fd = open (full_name);
-
-              printf (": ");
-              if (entry_fd != -1)
+              printf ("%s", entries[i].name);
+              if (verbose)
                 {
-                  if (isdir (entry_fd))
+                  printf (": ");
+                  if (entries[i].is_dir)
                     printf ("directory");
                   else
-                    printf ("%d-byte file", filesize (entry_fd));
-                  printf (", inumber %d", inumber (entry_fd));
+                    printf ("%d-byte file", entries[i].size);
+                  printf (", inumber %d", entries[i].inumber);
                 }
-              else
-                printf ("open failed");
-              close (entry_fd);
+              printf ("\n");
             }
-          printf ("\n");
         }
     }
   else 
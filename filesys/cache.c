@@ -2,40 +2,57 @@
 #include <threads/synch.h>
 #include <threads/thread.h>
 #include <threads/malloc.h>
+#include <threads/palloc.h>
+#include <threads/vaddr.h>
 #include <devices/timer.h>
 #include <lib/string.h>
 #include "filesys.h"
-#include "free-map.h"
+#include "journal.h"
 /**
 	compilation options
 */
-#define CACHE_SIZE_IN_SECTORS 64
-#define SECTOR_SIZE_IN_BYTES 512
+#define CACHE_SIZE_IN_SLOTS 32
+#define SECTOR_SIZE_IN_BYTES BLOCK_SECTOR_SIZE
+#define SLOT_SIZE_IN_SECTORS (PGSIZE / SECTOR_SIZE_IN_BYTES)
 #define DUMP_INTERVAL_TICKS 10
+#define CACHE_MAX_QUOTAS 16
+#define METADATA_RESERVED_SLOTS (CACHE_SIZE_IN_SLOTS / 4)
 
 /**
 	data structures
+
+	- the cache is made of slots, each one page holding
+	  SLOT_SIZE_IN_SECTORS consecutive sectors, starting at a
+	  multiple of SLOT_SIZE_IN_SECTORS
+	- one lookup serves a whole slot, and a slot is read and
+	  written back with multi-sector transfers
+	- sectors are read in and written back only as needed, so a
+	  slot keeps, per sector, whether it holds the sector and
+	  whether the sector is dirty
 */
-struct sector_t {
-	char data[SECTOR_SIZE_IN_BYTES];
-};
-typedef struct sector_t sector_t;
+
+//one bit per sector of a slot
+typedef uint8_t sector_mask_t;
 
 struct sector_supl_t {
-	bool present;
+	bool present; //the slot belongs to sector_index
 	bool accessed;
-	bool dirty;
+	uint8_t klass[SLOT_SIZE_IN_SECTORS]; //cache class of each sector, as last used
+	uint8_t chances; //turns of the hand left once no longer accessed
+	unsigned stamp; //gTouchClock at the last use
+	sector_mask_t valid; //sectors read in or written
+	sector_mask_t dirty; //sectors newer than the disk
 	int pinned; //pin counter
-	struct lock *s_lock;
-	int sector_index_in_cache;
-	sid_t sector_index; 
+	struct lock *s_lock; //protects data, valid and dirty
+	uint8_t *data; //one page
+	sid_t sector_index; //first sector of the slot
+	int owner; //process that brought the slot in, 0 for the kernel
 };
 typedef struct sector_supl_t sector_supl_t;
 
 
 struct buffer_cache {
-	sector_t cache[CACHE_SIZE_IN_SECTORS];
-	sector_supl_t cache_aux[CACHE_SIZE_IN_SECTORS];
+	sector_supl_t cache_aux[CACHE_SIZE_IN_SLOTS];
 	struct lock ss_lock;
 };
 typedef struct buffer_cache buffer_cache;
@@ -43,32 +60,89 @@ typedef struct buffer_cache buffer_cache;
 struct read_ahead_entry {
 	struct list_elem l_elem;
 	sid_t sector_index;
+	int owner; //process the slot is fetched for
 };
 typedef struct read_ahead_entry read_ahead_entry;
 
 /**
-	internal function declarations
+	soft quotas
+	- an owner with a quota that holds that many slots or more
+	  gives up its own slots first when it needs another one
+	- everyone else takes slots from owners over their quotas
+	  before slots from owners within them
+	- slots are counted from their owner fields, so only the
+	  quotas themselves are kept here
 */
+struct cache_quota {
+	int owner;
+	int slots; //0 if the entry is free
+};
+typedef struct cache_quota cache_quota;
 
+/**
+	metadata residency
+	- a slot that stops being used survives as many extra turns
+	  of the clock hand as its class has here
+	- the reserve is METADATA_RESERVED_SLOTS slots' worth of
+	  metadata sectors; the most recently used slots holding
+	  metadata are kept out of eviction as long as their metadata
+	  sectors fit in it, unless nothing else can go
+	- a slot is charged only for its metadata sectors, so one
+	  inode sector next to file data takes little of the reserve
+*/
+static const uint8_t gResidency[CACHE_CLASS_CNT] = {
+	[CACHE_DATA] = 0,
+	[CACHE_BITMAP] = 1,
+	[CACHE_DIRECTORY] = 1,
+	[CACHE_INDEX] = 2,
+	[CACHE_INODE] = 2,
+};
 
-//can evict cache sectors	
-//if there is no eviction will just supply the correct index 
-//and lock the page such that a concurrent eviction will not evict the same page
-int cache_atomic_get_supl_data_and_pin(sector_supl_t *data, sid_t index);
-
+/**
+	internal function declarations
+*/
 
-//will write back the data and will enable eviction for this cache entry
-void cache_atomic_set_supl_data_and_unpin(int cache_sector_index, sector_supl_t *data);
 
-int cache_evict(void);
-int cache_lru(void);
+//can evict cache slots
+//if there is no eviction will just supply the correct index
+//and pin the slot such that a concurrent eviction will not evict the same slot
+int cache_get_and_pin(sid_t index, int owner);
+
+int cache_evict(int owner);
+static void cache_drop(int cache_slot_index);
+int cache_lru(int owner);
+static int cache_sweep(const bool *candidates);
+static bool cache_age(int cache_slot_index);
+static void cache_touch(sector_supl_t *info, sid_t index, int hints);
+static int cache_class_of(const sector_supl_t *info);
+static void cache_reserve(bool *reserved);
+static void cache_cool(int cache_slot_index);
+static int cache_owner(void);
+static int cache_quota_of(int owner);
 void cache_read_ahead_asynch(sid_t index);
 void cache_read_ahead_internal(void);
+void cache_fetch(sid_t index, int owner);
 
 void cache_dump_all(void);
 void cache_dump_entry(int entry_index);
+void cache_dump_sectors(int entry_index, sector_mask_t mask);
 
-void cache_read_internal(int cache_sector_index, sid_t sector_index);
+//reads in the sectors of the slot it does not hold yet;
+//the caller holds the slot lock
+void cache_read_internal(int cache_slot_index);
+
+//pins the slot holding INDEX, if there is one, without
+//evicting anything; returns -1 if the sector is not cached
+int cache_lookup_and_pin(sid_t index);
+void cache_unpin(int cache_slot_index);
+
+static void read_direct_one(sid_t index, void *buffer);
+static void write_direct_one(sid_t index, const void *buffer);
+static bool update_direct_one(sid_t index, const void *buffer);
+
+static sid_t slot_of(sid_t index);
+static sector_mask_t bit_of(sid_t index);
+static uint8_t *data_of(int cache_slot_index, sid_t index);
 
 
 /**
@@ -78,7 +152,7 @@ void cache_read_internal(int cache_sector_index, sid_t sector_index);
 void cache_main_dump(void *aux UNUSED);
 
 
-/**	
+/**
 	main read ahead thread
 	- processes the read_ahead requests
 */
@@ -93,6 +167,9 @@ void cache_main_read_ahead(void *aux UNUSED);
 buffer_cache gCache;
 bool gIsCacheThreadRunning;
 int gLruCursor;
+unsigned gTouchClock; //counts slot uses, to order them by age
+
+cache_quota gQuotas[CACHE_MAX_QUOTAS];
 
 struct list gReadAheadList;
 struct lock gReadAheadLock;
@@ -100,61 +177,251 @@ struct semaphore gReadAheadWakeUpSema;
 
 
 
-void cache_write(sid_t index, void *buffer, int offset, int size) {	
-	sector_supl_t info;
-	int sdataIndex = cache_atomic_get_supl_data_and_pin(&info, index);
-	
-	if(info.present) {
-		//printf("cache_write present %d %d\n", index, sdataIndex);
-		info.dirty = true;
-		info.accessed = true;
-		lock_acquire(info.s_lock);
-		memcpy(gCache.cache[info.sector_index_in_cache].data + offset, buffer, size);
-		lock_release(info.s_lock);
-	}
-	else {
-		//printf("cache_write not present %d %d\n", index, sdataIndex);
-		cache_read_internal(sdataIndex, index);
-		info.present = true;		
-		info.accessed = true;
-		info.sector_index_in_cache = sdataIndex;
-		info.sector_index = index;
+void cache_write(sid_t index, const void *buffer, int offset, int size) {
+	cache_write_hint(index, buffer, offset, size, 0);
+}
+
+void cache_write_hint(sid_t index, const void *buffer, int offset, int size, int hints) {
+	int sdataIndex = cache_get_and_pin(index, cache_owner());
+	sector_supl_t *info = &gCache.cache_aux[sdataIndex];
+
+	lock_acquire(info->s_lock);
+	/* A write of the whole sector replaces all of it; no need
+	   to read the old contents first. */
+	if(!(info->valid & bit_of(index)) && (offset != 0 || size != SECTOR_SIZE_IN_BYTES))
+		cache_read_internal(sdataIndex);
+	memcpy(data_of(sdataIndex, index) + offset, buffer, size);
+	info->valid |= bit_of(index);
+	info->dirty |= bit_of(index);
+	cache_touch(info, index, hints);
+	lock_release(info->s_lock);
+	if(hints & CACHE_COLD)
+		cache_cool(sdataIndex);
+	cache_unpin(sdataIndex);
+}
 
-		info.dirty = true;
-		lock_acquire(info.s_lock);
-		memcpy(gCache.cache[info.sector_index_in_cache].data + offset, buffer, size);
-		lock_release(info.s_lock);		
+void cache_write_meta(sid_t index, const void *buffer, int offset, int size, int hints) {
+	int sdataIndex = cache_get_and_pin(index, cache_owner());
+	sector_supl_t *info = &gCache.cache_aux[sdataIndex];
+	uint8_t *data = data_of(sdataIndex, index);
+
+	lock_acquire(info->s_lock);
+	//the old contents are needed even for a whole sector, to tell
+	//whether the write changes anything
+	if(!(info->valid & bit_of(index)))
+		cache_read_internal(sdataIndex);
+	cache_touch(info, index, hints & ~CACHE_COLD);
+	if((info->dirty & bit_of(index)) || memcmp(data + offset, buffer, size) != 0) {
+		memcpy(data + offset, buffer, size);
+		journal_record(index, data);
 	}
-	cache_atomic_set_supl_data_and_unpin(sdataIndex, &info);
+	//the journal writes the sector back once it is logged
+	info->dirty &= ~bit_of(index);
+	lock_release(info->s_lock);
+	cache_unpin(sdataIndex);
 }
 
 void cache_read(sid_t index, void *buffer, int offset, int size) {
-	sector_supl_t info;
-	int sdataIndex = cache_atomic_get_supl_data_and_pin(&info, index);
-	
-	if(info.present) {
-		//printf("cache_read present %d %d\n", index, sdataIndex);
-		info.accessed = true;
-		lock_acquire(info.s_lock);
-		memcpy(buffer, gCache.cache[info.sector_index_in_cache].data + offset, size);
-		lock_release(info.s_lock);
-	}
-	else {
-		//printf("cache_read not present %d %d\n", index, sdataIndex);
-		cache_read_internal(sdataIndex, index);
-		info.present = true;		
-		info.accessed = true;
-		info.sector_index_in_cache = sdataIndex;
-		info.sector_index = index;
-
-		info.dirty = false;
-		lock_acquire(info.s_lock);
-		memcpy(buffer, gCache.cache[info.sector_index_in_cache].data + offset, size);
-		lock_release(info.s_lock);
-		cache_read_ahead_asynch(index + 1);
-	}
-	cache_atomic_set_supl_data_and_unpin(sdataIndex, &info);
-	
+	cache_read_hint(index, buffer, offset, size, 0);
+}
+
+void cache_read_hint(sid_t index, void *buffer, int offset, int size, int hints) {
+	int sdataIndex = cache_get_and_pin(index, cache_owner());
+	sector_supl_t *info = &gCache.cache_aux[sdataIndex];
+	bool missed = false;
+
+	lock_acquire(info->s_lock);
+	if(!(info->valid & bit_of(index))) {
+		cache_read_internal(sdataIndex);
+		missed = true;
+	}
+	cache_touch(info, index, hints);
+	memcpy(buffer, data_of(sdataIndex, index) + offset, size);
+	lock_release(info->s_lock);
+	if(hints & CACHE_COLD)
+		cache_cool(sdataIndex);
+	cache_unpin(sdataIndex);
+
+	//the rest of this slot came in along with the sector
+	if(missed && !(hints & CACHE_NO_READ_AHEAD))
+		cache_read_ahead_asynch(slot_of(index) + SLOT_SIZE_IN_SECTORS);
+}
+
+//true if the cache or the journal holds a copy of INDEX, which may be
+//newer than the disk
+static bool has_copy(sid_t index) {
+	int sdataIndex = cache_lookup_and_pin(index);
+
+	if(sdataIndex < 0)
+		return journal_holds(index);
+	cache_unpin(sdataIndex);
+	return true;
+}
+
+//number of sectors from INDEX on, at most CNT, of which neither the
+//cache nor the journal holds a copy
+static size_t uncached_run(sid_t index, size_t cnt) {
+	size_t run = 0;
+
+	while(run < cnt && !has_copy(index + run))
+		run++;
+	return run;
+}
+
+void cache_read_direct(sid_t index, size_t cnt, void *buffer_) {
+	uint8_t *buffer = buffer_;
+
+	//a copy of a sector can only appear meanwhile by a read ahead, which
+	//brings in what the disk holds anyway, or by a racing write
+	while(cnt > 0) {
+		size_t run = uncached_run(index, cnt);
+
+		if(run > 0)
+			block_read_multiple(fs_device, index, run, buffer);
+		else {
+			read_direct_one(index, buffer);
+			run = 1;
+		}
+		index += run;
+		buffer += run * SECTOR_SIZE_IN_BYTES;
+		cnt -= run;
+	}
+}
+
+static void read_direct_one(sid_t index, void *buffer) {
+	int sdataIndex = cache_lookup_and_pin(index);
+	sector_supl_t *info;
+
+	//the journal is asked first: once it has no image, the disk copy
+	//is current
+	if(sdataIndex < 0) {
+		if(!journal_read(index, buffer))
+			block_read(fs_device, index, buffer);
+		return;
+	}
+	info = &gCache.cache_aux[sdataIndex];
+	lock_acquire(info->s_lock);
+	if(info->valid & bit_of(index))
+		memcpy(buffer, data_of(sdataIndex, index), SECTOR_SIZE_IN_BYTES);
+	else if(!journal_read(index, buffer))
+		block_read(fs_device, index, buffer);
+	lock_release(info->s_lock);
+	cache_unpin(sdataIndex);
+}
+
+void cache_write_direct(sid_t index, size_t cnt, const void *buffer_) {
+	const uint8_t *buffer = buffer_;
+	size_t i;
+
+	while(cnt > 0) {
+		size_t run = uncached_run(index, cnt);
+
+		if(run > 0) {
+			block_write_multiple(fs_device, index, run, buffer);
+
+			//a read ahead may have cached the old contents meanwhile
+			for(i = 0; i < run; i++)
+				update_direct_one(index + i, buffer + i * SECTOR_SIZE_IN_BYTES);
+		}
+		else {
+			write_direct_one(index, buffer);
+			run = 1;
+		}
+		index += run;
+		buffer += run * SECTOR_SIZE_IN_BYTES;
+		cnt -= run;
+	}
+}
+
+static void write_direct_one(sid_t index, const void *buffer) {
+	if(!update_direct_one(index, buffer))
+		block_write(fs_device, index, buffer);
+}
+
+//writes BUFFER to the cached copy of INDEX and to disk, if INDEX is cached;
+//returns false if it is not
+static bool update_direct_one(sid_t index, const void *buffer) {
+	int sdataIndex = cache_lookup_and_pin(index);
+	sector_supl_t *info;
+
+	if(sdataIndex < 0)
+		return false;
+	//the cached copy and the disk are written under the slot lock,
+	//so the dump thread cannot write the old copy back over them
+	info = &gCache.cache_aux[sdataIndex];
+	lock_acquire(info->s_lock);
+	memcpy(data_of(sdataIndex, index), buffer, SECTOR_SIZE_IN_BYTES);
+	block_write(fs_device, index, buffer);
+	info->valid |= bit_of(index);
+	info->dirty &= ~bit_of(index);
+	lock_release(info->s_lock);
+	cache_unpin(sdataIndex);
+	return true;
+}
+
+void cache_flush(sid_t index) {
+	int sdataIndex = cache_lookup_and_pin(index);
+
+	if(sdataIndex < 0)
+		return;
+	cache_dump_sectors(sdataIndex, bit_of(index));
+	cache_unpin(sdataIndex);
+}
+
+void cache_flush_if(bool (*belongs)(sid_t index, void *aux), void *aux) {
+	int i, k;
+
+	//the slot is only read here; a slot that changes hands
+	//meanwhile is written back under its new index, which is harmless
+	for(i = 0; i < CACHE_SIZE_IN_SLOTS; ++i) {
+		sector_supl_t *info = &gCache.cache_aux[i];
+		sector_mask_t mask = 0;
+
+		if(!info->present || !info->dirty)
+			continue;
+		for(k = 0; k < SLOT_SIZE_IN_SECTORS; ++k)
+			if((info->dirty & (1 << k)) && belongs(info->sector_index + k, aux))
+				mask |= 1 << k;
+		if(mask)
+			cache_dump_sectors(i, mask);
+	}
+}
+
+void cache_sync(void) {
+	cache_dump_all();
+}
+
+bool cache_set_quota(int owner, int slots) {
+	int i, free_entry = -1;
+	bool success = true;
+
+	ASSERT(slots >= 0);
+	lock_acquire(&gCache.ss_lock);
+	for(i = 0; i < CACHE_MAX_QUOTAS; ++i) {
+		if(gQuotas[i].slots && gQuotas[i].owner == owner)
+			break;
+		if(!gQuotas[i].slots && free_entry < 0)
+			free_entry = i;
+	}
+	if(i == CACHE_MAX_QUOTAS)
+		i = free_entry;
+	if(i >= 0) {
+		gQuotas[i].owner = owner;
+		gQuotas[i].slots = slots;
+	}
+	else
+		success = slots == 0;
+	lock_release(&gCache.ss_lock);
+	return success;
+}
+
+int cache_get_quota(int owner) {
+	int slots;
+
+	lock_acquire(&gCache.ss_lock);
+	slots = cache_quota_of(owner);
+	lock_release(&gCache.ss_lock);
+	return slots;
 }
 
 void cache_init(void) {
@@ -164,36 +431,40 @@ void cache_init(void) {
 	sema_init(&gReadAheadWakeUpSema, 0);
 	int i;
 
-	for(i = 0; i < CACHE_SIZE_IN_SECTORS; ++i) {
+	for(i = 0; i < CACHE_SIZE_IN_SLOTS; ++i) {
 		memset(&gCache.cache_aux[i], 0, sizeof(sector_supl_t));
 
 		gCache.cache_aux[i].s_lock = (struct lock *)malloc(sizeof(struct lock));
+		gCache.cache_aux[i].data = palloc_get_page(PAL_ASSERT);
 
 		lock_init(gCache.cache_aux[i].s_lock);
 		gCache.cache_aux[i].present = false;
 		gCache.cache_aux[i].pinned = 0;
 		gCache.cache_aux[i].accessed = false;
-		gCache.cache_aux[i].dirty = false;
+		gCache.cache_aux[i].valid = 0;
+		gCache.cache_aux[i].dirty = 0;
 	}
+	memset(gQuotas, 0, sizeof gQuotas);
 	gIsCacheThreadRunning = true;
 	gLruCursor = 0;
-	//printf("cache: Initialized cache with %d sectors\n", CACHE_SIZE_IN_SECTORS);
+	//printf("cache: Initialized cache with %d slots\n", CACHE_SIZE_IN_SLOTS);
 	thread_create ("cache_dump_t", 0, cache_main_dump, NULL);
 	thread_create ("cache_rh_t", 0, cache_main_read_ahead, NULL);
 }
 
-void cache_close(void) {	
+void cache_close(void) {
 	cache_dump_all();
 	gIsCacheThreadRunning = false;
 	int i;
 
 	lock_acquire(&gCache.ss_lock);
-	for(i = 0; i < CACHE_SIZE_IN_SECTORS; ++i) {		
+	for(i = 0; i < CACHE_SIZE_IN_SLOTS; ++i) {
 		free(gCache.cache_aux[i].s_lock);
+		palloc_free_page(gCache.cache_aux[i].data);
 		memset(&gCache.cache_aux[i], 0, sizeof(sector_supl_t));
-		
+
 		gCache.cache_aux[i].present = false;
-		gCache.cache_aux[i].dirty = false;
+		gCache.cache_aux[i].dirty = 0;
 		gCache.cache_aux[i].s_lock = NULL;
 	}
 	lock_release(&gCache.ss_lock);
@@ -201,79 +472,338 @@ void cache_close(void) {
 
 void cache_dump_all(void) {
 	int i = 0;
-	for(i = 0; i < CACHE_SIZE_IN_SECTORS; ++i) {
+	for(i = 0; i < CACHE_SIZE_IN_SLOTS; ++i) {
 		cache_dump_entry(i);
-	}	
+	}
 }
 
 void cache_dump_entry(int index) {
-	lock_acquire(gCache.cache_aux[index].s_lock);
-	if(gCache.cache_aux[index].dirty) {		
-		gCache.cache_aux[index].dirty = false;	
-		ASSERT(gCache.cache_aux[index].present);
-		block_write( fs_device, gCache.cache_aux[index].sector_index, gCache.cache[index].data );		
+	cache_dump_sectors(index, (sector_mask_t) -1);
+}
+
+void cache_dump_sectors(int index, sector_mask_t mask) {
+	sector_supl_t *info = &gCache.cache_aux[index];
+	int k, run;
+
+	lock_acquire(info->s_lock);
+	mask &= info->dirty;
+	if(mask) {
+		ASSERT(info->present);
+		info->dirty &= ~mask;
+		//each run of dirty sectors goes out as one transfer
+		for(k = 0; k < SLOT_SIZE_IN_SECTORS; k += run + 1) {
+			for(run = 0; k + run < SLOT_SIZE_IN_SECTORS && (mask & (1 << (k + run))); ++run)
+				continue;
+			if(run > 0)
+				block_write_multiple(fs_device, info->sector_index + k, run,
+					info->data + k * SECTOR_SIZE_IN_BYTES);
+		}
 	}
-	lock_release(gCache.cache_aux[index].s_lock);
+	lock_release(info->s_lock);
 }
 
 int advance(int);
 int advance(int glru) {
-	return (glru + 1) % CACHE_SIZE_IN_SECTORS;
+	return (glru + 1) % CACHE_SIZE_IN_SLOTS;
 }
 
 int retreat(int);
 int retreat(int glru) {
-	return (glru + CACHE_SIZE_IN_SECTORS - 1) % CACHE_SIZE_IN_SECTORS;
+	return (glru + CACHE_SIZE_IN_SLOTS - 1) % CACHE_SIZE_IN_SLOTS;
 }
 
-int cache_lru(void) {
-	int it;
+int cache_lru(int owner) {
+	bool candidates[CACHE_SIZE_IN_SLOTS];
+	bool reserved[CACHE_SIZE_IN_SLOTS];
+	int held[CACHE_SIZE_IN_SLOTS];
+	int it, k, quota;
 
-	for(it = 0; it != CACHE_SIZE_IN_SECTORS; ++it) {
+	for(it = 0; it != CACHE_SIZE_IN_SLOTS; ++it) {
 		if(!gCache.cache_aux[it].present)
 			return it;
 	}
 
+	//metadata slots within the reserve are kept out of every
+	//choice below but the last
+	cache_reserve(reserved);
+
+	//slots held by the owner of each slot
+	for(it = 0; it != CACHE_SIZE_IN_SLOTS; ++it) {
+		held[it] = 0;
+		for(k = 0; k != CACHE_SIZE_IN_SLOTS; ++k)
+			if(gCache.cache_aux[k].owner == gCache.cache_aux[it].owner)
+				held[it]++;
+	}
+
+	quota = cache_quota_of(owner);
+	if(quota) {
+		int own = 0;
+
+		for(it = 0; it != CACHE_SIZE_IN_SLOTS; ++it) {
+			own += gCache.cache_aux[it].owner == owner;
+			candidates[it] = gCache.cache_aux[it].owner == owner && !reserved[it];
+		}
+		if(own >= quota && (it = cache_sweep(candidates)) >= 0)
+			return it;
+	}
+
+	for(it = 0; it != CACHE_SIZE_IN_SLOTS; ++it) {
+		quota = cache_quota_of(gCache.cache_aux[it].owner);
+		candidates[it] = quota && held[it] > quota && !reserved[it];
+	}
+	if((it = cache_sweep(candidates)) >= 0)
+		return it;
+
+	for(it = 0; it != CACHE_SIZE_IN_SLOTS; ++it)
+		candidates[it] = !reserved[it];
+	if((it = cache_sweep(candidates)) >= 0)
+		return it;
+
+	//the hand stays past the victim, so the next sweep starts
+	//where this one stopped
 	for(it = gLruCursor; ; it = advance(it)) {
-		if(!gCache.cache_aux[it].pinned &&
-			!gCache.cache_aux[it].accessed &&
-			gCache.cache_aux[it].present) {
+		if(cache_age(it)) {
+			gLruCursor = advance(it);
 			return it;
 		}
-		else {
-			gCache.cache_aux[it].accessed = false;
+	}
+	ASSERT(!"no more free cache slots");
+}
+
+//the clock over the slots marked in CANDIDATES only, leaving the
+//others as they are; returns -1 if two turns of the hand find
+//none that can go
+static int cache_sweep(const bool *candidates) {
+	int it, n;
+
+	for(it = gLruCursor, n = 0; n != 2 * CACHE_SIZE_IN_SLOTS; it = advance(it), ++n) {
+		if(candidates[it] && cache_age(it)) {
+			gLruCursor = advance(it);
+			return it;
 		}
 	}
-	ASSERT(!"no more free cache pages");
+	return -1;
+}
+
+//the hand passes slot CACHE_SLOT_INDEX; returns true if the slot
+//can go, otherwise takes away its accessed bit or one of its
+//chances
+static bool cache_age(int cache_slot_index) {
+	sector_supl_t *info = &gCache.cache_aux[cache_slot_index];
+
+	if(info->pinned || !info->present)
+		return false;
+	if(info->accessed)
+		info->accessed = false;
+	else if(info->chances)
+		info->chances--;
+	else
+		return true;
+	return false;
+}
+
+//records a use of sector INDEX of a slot, with HINTS, under its
+//slot lock; the sector takes the class of its latest use, so one
+//that is freed and reused for data stops counting as metadata
+static void cache_touch(sector_supl_t *info, sid_t index, int hints) {
+	info->klass[index - slot_of(index)] = hints >> CACHE_CLASS_SHIFT;
+	if(!(hints & CACHE_COLD)) {
+		info->accessed = true;
+		info->chances = gResidency[cache_class_of(info)];
+		info->stamp = ++gTouchClock;
+	}
+}
+
+//the highest class among the sectors of a slot
+static int cache_class_of(const sector_supl_t *info) {
+	int k, klass = CACHE_DATA;
+
+	for(k = 0; k < SLOT_SIZE_IN_SECTORS; ++k)
+		if(info->klass[k] > klass)
+			klass = info->klass[k];
+	return klass;
+}
+
+//marks in RESERVED the slots the metadata reserve keeps: the
+//most recently used slots holding metadata, for as long as their
+//metadata sectors fit; called with ss_lock held
+static void cache_reserve(bool *reserved) {
+	bool seen[CACHE_SIZE_IN_SLOTS];
+	int left = METADATA_RESERVED_SLOTS * SLOT_SIZE_IN_SECTORS;
+	int it, k;
+
+	for(it = 0; it != CACHE_SIZE_IN_SLOTS; ++it)
+		reserved[it] = seen[it] = false;
+	while(left > 0) {
+		int newest = -1, cost = 0;
+
+		for(it = 0; it != CACHE_SIZE_IN_SLOTS; ++it) {
+			if(!seen[it] && cache_class_of(&gCache.cache_aux[it]) != CACHE_DATA
+				&& (newest < 0 || gCache.cache_aux[it].stamp > gCache.cache_aux[newest].stamp))
+				newest = it;
+		}
+		if(newest < 0)
+			break;
+		seen[newest] = true;
+		for(k = 0; k < SLOT_SIZE_IN_SECTORS; ++k)
+			cost += gCache.cache_aux[newest].klass[k] != CACHE_DATA;
+		if(cost <= left) {
+			reserved[newest] = true;
+			left -= cost;
+		}
+	}
+}
+
+//the process on whose behalf the running thread uses the cache
+static int cache_owner(void) {
+#ifdef USERPROG
+	return thread_current()->pid;
+#else
+	return 0;
+#endif
+}
+
+//called with ss_lock held; the quota of OWNER, 0 if none
+static int cache_quota_of(int owner) {
+	int i;
+
+	for(i = 0; i < CACHE_MAX_QUOTAS; ++i)
+		if(gQuotas[i].slots && gQuotas[i].owner == owner)
+			return gQuotas[i].slots;
+	return 0;
+}
+
+//puts the slot under the clock hand, unless someone has used it
+//since the hand last passed, so that it goes before any other
+static void cache_cool(int cache_slot_index) {
+	lock_acquire(&gCache.ss_lock);
+	if(!gCache.cache_aux[cache_slot_index].accessed)
+		gLruCursor = cache_slot_index;
+	lock_release(&gCache.ss_lock);
 }
 
 void cache_read_ahead_internal(void) {
-	lock_acquire(&gReadAheadLock);
-	char dummyBuffer[16];
 	struct list* rhlist = &gReadAheadList;
-	struct list_elem *e;
-	for (e = list_begin(rhlist); e != list_end(rhlist); ){
-		read_ahead_entry *link = list_entry(e, read_ahead_entry, l_elem);
-		e = list_next(e);
-		cache_read(link->sector_index, dummyBuffer, 0, sizeof(dummyBuffer));		
-		list_remove(&link->l_elem);
-		free(link);		
+
+	//the lock is dropped while the slot is read so that readers
+	//can keep queueing requests
+	lock_acquire(&gReadAheadLock);
+	while(!list_empty(rhlist)) {
+		read_ahead_entry *link = list_entry(list_pop_front(rhlist), read_ahead_entry, l_elem);
+		lock_release(&gReadAheadLock);
+		cache_fetch(link->sector_index, link->owner);
+		free(link);
+		lock_acquire(&gReadAheadLock);
 	}
-	lock_release(&gReadAheadLock);	
+	lock_release(&gReadAheadLock);
 }
 
-void cache_read_ahead_asynch(sid_t index) {
+/**
+	brings the slot holding a sector into the cache without
+	copying it anywhere and without triggering further read ahead.
+	- the slot is not marked as accessed, so a prefetched
+	  slot nobody asks for is the first to be evicted
+*/
+void cache_fetch(sid_t index, int owner) {
+	if(index < 0 || (block_sector_t)index >= block_size(fs_device))
+		return;
+
+	int sdataIndex = cache_get_and_pin(index, owner);
+	sector_supl_t *info = &gCache.cache_aux[sdataIndex];
+
+	lock_acquire(info->s_lock);
+	cache_read_internal(sdataIndex);
+	lock_release(info->s_lock);
+	cache_unpin(sdataIndex);
+}
+
+void cache_prefetch(sid_t *indexes, int count) {
+	int i, j;
+
+	//insertion sort, so the read ahead thread sweeps the disk in
+	//one direction instead of seeking back and forth
+	for(i = 1; i < count; ++i) {
+		sid_t key = indexes[i];
+		for(j = i; j > 0 && indexes[j - 1] > key; --j)
+			indexes[j] = indexes[j - 1];
+		indexes[j] = key;
+	}
+
+	//the slots are charged to whoever asked for them
+	int owner = cache_owner();
+
 	lock_acquire(&gReadAheadLock);
-	read_ahead_entry *entry = (read_ahead_entry*)malloc(sizeof(read_ahead_entry));
-	entry->sector_index = index;
-	list_push_back(&gReadAheadList, &(entry->l_elem));
-	lock_release(&gReadAheadLock);	
+	for(i = 0; i < count; ++i) {
+		//one fetch brings in the whole slot
+		if(i > 0 && slot_of(indexes[i]) == slot_of(indexes[i - 1]))
+			continue;
+		read_ahead_entry *entry = (read_ahead_entry*)malloc(sizeof(read_ahead_entry));
+		if(entry == NULL)
+			break;
+		entry->sector_index = indexes[i];
+		entry->owner = owner;
+		list_push_back(&gReadAheadList, &(entry->l_elem));
+	}
+	lock_release(&gReadAheadLock);
 	sema_up(&gReadAheadWakeUpSema);
 }
 
+void cache_discard(sid_t *indexes, int count) {
+	sector_mask_t covered[CACHE_SIZE_IN_SLOTS];
+	bool kept[CACHE_SIZE_IN_SLOTS];
+	int i, k;
+
+	lock_acquire(&gCache.ss_lock);
+	for(k = 0; k < CACHE_SIZE_IN_SLOTS; ++k)
+		covered[k] = 0;
+	for(i = 0; i < count; ++i) {
+		sid_t slot = slot_of(indexes[i]);
+
+		for(k = 0; k < CACHE_SIZE_IN_SLOTS; ++k) {
+			sector_supl_t *info = &gCache.cache_aux[k];
+
+			if(info->present && info->sector_index == slot) {
+				covered[k] |= bit_of(indexes[i]);
+				break;
+			}
+		}
+	}
+
+	//a slot may hold sectors of other files, which stay cached;
+	//it is pinned so that it keeps its sectors until they are
+	//written back below
+	for(k = 0; k < CACHE_SIZE_IN_SLOTS; ++k) {
+		kept[k] = false;
+		if(covered[k] == (sector_mask_t) -1 && !gCache.cache_aux[k].pinned)
+			cache_drop(k);
+		else if(covered[k]) {
+			gCache.cache_aux[k].pinned++;
+			kept[k] = true;
+		}
+	}
+	lock_release(&gCache.ss_lock);
+
+	//a slot lock may be held by someone waiting for ss_lock, so
+	//it is only taken once ss_lock is released
+	for(k = 0; k < CACHE_SIZE_IN_SLOTS; ++k) {
+		if(kept[k]) {
+			cache_dump_sectors(k, covered[k]);
+			cache_unpin(k);
+		}
+	}
+}
+
+void cache_read_ahead_asynch(sid_t index) {
+	cache_prefetch(&index, 1);
+}
+
 void cache_main_dump(void *aux UNUSED) {
 	while(gIsCacheThreadRunning) {
-		cache_dump_all();		
+		//data first, so a commit finds little left to order before
+		//its log records; metadata, the free map included, goes out
+		//through the journal
+		cache_dump_all();
+		journal_tick();
 		timer_sleep(DUMP_INTERVAL_TICKS);
 	}
 }
@@ -287,48 +817,121 @@ void cache_main_read_ahead(void *aux UNUSED) {
 	}
 }
 
-int cache_evict(void) {
-	int ev_id = cache_lru();
+//called with ss_lock held; the slot comes back unpinned, with no
+//sectors, for the caller to claim
+int cache_evict(int owner) {
+	int ev_id = cache_lru(owner);
 
 	//printf("cache_evict %d\n", ev_id);
-	cache_dump_entry(ev_id);
-	gCache.cache_aux[ev_id].present = false;
-	ASSERT(gCache.cache_aux[ev_id].pinned == 0);
+	cache_drop(ev_id);
 	return ev_id;
 }
 
-int cache_atomic_get_supl_data_and_pin(sector_supl_t *data, sid_t index) {
-	lock_acquire(&gCache.ss_lock);
+//called with ss_lock held; writes back the dirty sectors of a
+//slot nobody has pinned and leaves it empty
+static void cache_drop(int cache_slot_index) {
+	sector_supl_t *info = &gCache.cache_aux[cache_slot_index];
+
+	ASSERT(info->pinned == 0);
+	cache_dump_entry(cache_slot_index);
+	lock_acquire(info->s_lock);
+	info->present = false;
+	info->valid = 0;
+	info->dirty = 0;
+	lock_release(info->s_lock);
+}
+
+int cache_get_and_pin(sid_t index, int owner) {
+	sid_t slot = slot_of(index);
 	int i = 0;
 	int found_index = -1;
-	for(i = 0; i < CACHE_SIZE_IN_SECTORS; ++i) {
-		if(gCache.cache_aux[i].sector_index == index) {
+
+	lock_acquire(&gCache.ss_lock);
+	for(i = 0; i < CACHE_SIZE_IN_SLOTS; ++i) {
+		if(gCache.cache_aux[i].present && gCache.cache_aux[i].sector_index == slot) {
 			found_index = i;
 			break;
 		}
 	}
-	
+
 
 	if(found_index == -1) {
-		found_index = cache_evict();
-	}	
+		found_index = cache_evict(owner);
+		gCache.cache_aux[found_index].present = true;
+		gCache.cache_aux[found_index].accessed = false;
+		gCache.cache_aux[found_index].sector_index = slot;
+		gCache.cache_aux[found_index].owner = owner;
+		memset(gCache.cache_aux[found_index].klass, CACHE_DATA,
+			sizeof gCache.cache_aux[found_index].klass);
+		gCache.cache_aux[found_index].chances = 0;
+		gCache.cache_aux[found_index].stamp = gTouchClock;
+	}
 	gCache.cache_aux[found_index].pinned++;
-	memcpy(data, &gCache.cache_aux[found_index], sizeof(sector_supl_t));
-	lock_release(&gCache.ss_lock);	
+	lock_release(&gCache.ss_lock);
 	return found_index;
 }
 
+void cache_read_internal(int cache_slot_index) {
+	sector_supl_t *info = &gCache.cache_aux[cache_slot_index];
+	sid_t end = block_size(fs_device);
+	int k, run;
+
+	//each run of missing sectors comes in as one transfer
+	for(k = 0; k < SLOT_SIZE_IN_SECTORS; k += run + 1) {
+		for(run = 0; k + run < SLOT_SIZE_IN_SECTORS && !(info->valid & (1 << (k + run)))
+			&& info->sector_index + k + run < end; ++run)
+			continue;
+		if(run > 0)
+			block_read_multiple(fs_device, info->sector_index + k, run,
+				info->data + k * SECTOR_SIZE_IN_BYTES);
+	}
+
+	//a metadata sector that was evicted before the journal wrote it
+	//back is newer in the journal than on disk
+	for(k = 0; k < SLOT_SIZE_IN_SECTORS; ++k) {
+		if(!(info->valid & (1 << k)) && info->sector_index + k < end)
+			journal_read(info->sector_index + k, info->data + k * SECTOR_SIZE_IN_BYTES);
+	}
+	info->valid = (sector_mask_t) -1;
+}
+
+int cache_lookup_and_pin(sid_t index) {
+	sid_t slot = slot_of(index);
+	int i;
+	int found_index = -1;
+
+	lock_acquire(&gCache.ss_lock);
+	for(i = 0; i < CACHE_SIZE_IN_SLOTS; ++i) {
+		if(gCache.cache_aux[i].present && gCache.cache_aux[i].sector_index == slot) {
+			found_index = i;
+			gCache.cache_aux[i].pinned++;
+			break;
+		}
+	}
+	lock_release(&gCache.ss_lock);
+	return found_index;
+}
 
-void cache_atomic_set_supl_data_and_unpin(int cache_sector_index, sector_supl_t *data) {
+void cache_unpin(int cache_slot_index) {
 	lock_acquire(&gCache.ss_lock);
-	//sanity checks
-	ASSERT(cache_sector_index >= 0 && cache_sector_index < CACHE_SIZE_IN_SECTORS);
-	ASSERT(gCache.cache_aux[cache_sector_index].pinned);
-	memcpy(&gCache.cache_aux[cache_sector_index], data, sizeof(sector_supl_t));
-	gCache.cache_aux[cache_sector_index].pinned--;
+	ASSERT(cache_slot_index >= 0 && cache_slot_index < CACHE_SIZE_IN_SLOTS);
+	ASSERT(gCache.cache_aux[cache_slot_index].pinned);
+	gCache.cache_aux[cache_slot_index].pinned--;
 	lock_release(&gCache.ss_lock);
 }
 
-void cache_read_internal(int cache_sector_index, sid_t sector_index) {
-	block_read( fs_device, sector_index, gCache.cache[cache_sector_index].data);
+//first sector of the slot holding INDEX
+static sid_t slot_of(sid_t index) {
+	return index - index % SLOT_SIZE_IN_SECTORS;
+}
+
+//bit of INDEX in the masks of its slot
+static sector_mask_t bit_of(sid_t index) {
+	return 1 << (index % SLOT_SIZE_IN_SECTORS);
+}
+
+//where sector INDEX lives in slot CACHE_SLOT_INDEX
+static uint8_t *data_of(int cache_slot_index, sid_t index) {
+	return gCache.cache_aux[cache_slot_index].data
+		+ (index % SLOT_SIZE_IN_SECTORS) * SECTOR_SIZE_IN_BYTES;
 }
@@ -7,10 +7,58 @@ sector index type
 */
 typedef int sid_t;
 
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+	what a cached sector holds, from the cheapest to the dearest
+	to lose
+	- slots holding metadata survive more turns of the clock and
+	  have a reserved part of the cache
+	- the class is passed in the hints of a read or write, as
+	  CACHE_HINT_CLASS(class); hints without one mean CACHE_DATA
+*/
+enum cache_class {
+	CACHE_DATA, //file data
+	CACHE_BITMAP, //free map and share map data
+	CACHE_DIRECTORY, //directory entries
+	CACHE_INDEX, //chained extent sectors
+	CACHE_INODE, //inode sectors
+	CACHE_CLASS_CNT
+};
+#define CACHE_CLASS_SHIFT 8
+#define CACHE_HINT_CLASS(CLASS) ((CLASS) << CACHE_CLASS_SHIFT)
+
+/**
+	hints for cache_read_hint() and cache_write_hint()
+	- CACHE_NO_READ_AHEAD: a miss does not queue the next slot
+	- CACHE_COLD: the slot is not marked as accessed and is put
+	  under the clock hand, so it is the next one evicted unless
+	  someone else uses it first
+*/
+#define CACHE_NO_READ_AHEAD 0x1
+#define CACHE_COLD 0x2
+
 /**
 	will write to disk through the cache
 */
-void cache_write(sid_t index, void *buffer, int offset, int size);
+void cache_write(sid_t index, const void *buffer, int offset, int size);
+
+/**
+	like cache_write, with HINTS made of the CACHE_* hints above
+*/
+void cache_write_hint(sid_t index, const void *buffer, int offset, int size, int hints);
+
+
+/**
+	writes metadata through the cache and the journal.
+	- the new sector contents are recorded in the running journal
+	  transaction, unless the write changes nothing
+	- the cache never writes the sector back itself; the journal
+	  does, after logging it
+	- HINTS give the sector's class; CACHE_COLD is ignored
+*/
+void cache_write_meta(sid_t index, const void *buffer, int offset, int size, int hints);
 
 
 /**
@@ -18,6 +66,71 @@ void cache_write(sid_t index, void *buffer, int offset, int size);
 */
 void cache_read(sid_t index, void *buffer, int offset, int size);
 
+/**
+	like cache_read, with HINTS made of the CACHE_* hints above
+*/
+void cache_read_hint(sid_t index, void *buffer, int offset, int size, int hints);
+
+/**
+	reads CNT whole sectors from INDEX on from disk straight into BUFFER.
+	- a cached copy, which may be newer than the disk, is used instead
+	- so is an image in the journal that is not home yet
+	- the sectors are not brought into the cache
+	- each run of sectors with no such copy is one disk request
+*/
+void cache_read_direct(sid_t index, size_t cnt, void *buffer);
+
+/**
+	writes CNT whole sectors from BUFFER straight to disk from INDEX on.
+	- a cached copy is updated too, and is clean afterwards
+	- the sectors are not brought into the cache
+	- each run of sectors with no cached copy is one disk request
+*/
+void cache_write_direct(sid_t index, size_t cnt, const void *buffer);
+
+/**
+	writes sector INDEX back to disk now if it is cached and dirty
+*/
+void cache_flush(sid_t index);
+
+/**
+	writes back every dirty cached sector for which BELONGS returns true.
+	- BELONGS is called with the sector index and AUX
+*/
+void cache_flush_if(bool (*belongs)(sid_t index, void *aux), void *aux);
+
+/**
+	writes back every dirty cached sector
+*/
+void cache_sync(void);
+
+/**
+	queues COUNT sectors to be read into the cache in the background.
+	- the array is sorted in place by sector index
+*/
+void cache_prefetch(sid_t *indexes, int count);
+
+/**
+	drops the slots holding COUNT sectors from the cache.
+	- dirty sectors among them are written back first
+	- only a slot all of whose sectors are listed is dropped; the
+	  listed sectors of any other slot are just written back
+	- a slot someone is using is left alone
+*/
+void cache_discard(sid_t *indexes, int count);
+
+/**
+	sets the soft quota of OWNER, a process id, to SLOTS cache slots.
+	- 0 removes the quota; no owner has one to begin with
+	- returns false if quotas are already kept for too many owners
+*/
+bool cache_set_quota(int owner, int slots);
+
+/**
+	returns the soft quota of OWNER in cache slots, 0 if none
+*/
+int cache_get_quota(int owner);
+
 /**
 	called when the OS starts.
 	- starts the cache main thread
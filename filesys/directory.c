@@ -2,18 +2,25 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include <dirent.h>
 
 #include "userprog/process.h"
 
 #include "threads/malloc.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "filesys/path.h"
 
-#ifdef FILESYS_SYNC
 #include "threads/synch.h"
+#ifdef FILESYS_USE_CACHE
+#include "filesys/cache.h"
 #endif
 
+/* Number of upcoming entries whose inodes are prefetched while a
+   directory is being read. */
+#define DIR_PREFETCH_WINDOW 16
+
 /**
  * In-memory representation of a directory. 
  */
@@ -21,17 +28,7 @@ struct dir
 {
     struct inode *inode;    /* Backing store. */
     off_t pos;              /* Current position. */
-};
-
-/**
- *  Disk representation of a directory entry.
- */
-struct dir_entry 
-{
-    block_sector_t inode_sector;        /* Sector number of header. */
-    char name[NAME_MAX + 1];            /* Null terminated file name. */
-    bool is_directory;                  /* Type of the entry. */
-    bool in_use;                        /* In use or free? */
+    off_t prefetch_pos;     /* End of the entries already prefetched. */
 };
 
 // struct dir_list_elem {
@@ -42,17 +39,31 @@ struct dir_entry
 static struct dir *root_dir;
 // static struct list open_dirs;
 
+/* Held for writing while an entry is added or removed, so that the
+   check for a name and the write of its slot happen as one step,
+   and for reading while entries are looked up or listed, so that
+   nobody sees an entry half written. */
+static struct rwlock dir_lock;
+
 void dir_init() {
+    rwlock_init(&dir_lock, RWLOCK_PREFER_WRITERS);
     root_dir = dir_open(inode_open(ROOT_DIR_SECTOR));
     // list_init(&open_dirs);
 }
 
+/* Shuts down the directory module, closing the root directory. */
+void dir_done() {
+    dir_close(root_dir);
+    root_dir = NULL;
+}
+
 /**
  * Creates a directory with space for ENTRY_CNT entries in the given SECTOR.
  * Returns true if successful, false on failure. 
  */
 bool dir_create (block_sector_t sector, size_t entry_count, block_sector_t parent)
 {
+  journal_begin();
   #ifdef FILESYS_SYNC
 	inode_global_lock();
   #endif
@@ -68,6 +79,7 @@ bool dir_create (block_sector_t sector, size_t entry_count, block_sector_t paren
   #ifdef FILESYS_SYNC
     inode_global_unlock();
   #endif
+    journal_end();
 
     return success;
 }
@@ -93,7 +105,8 @@ struct dir *dir_open (struct inode *inode)
     struct dir *dir = calloc (1, sizeof *dir);
     if (inode != NULL && dir != NULL)
     {
-        dir->inode = inode_open(inode_get_inumber(inode));
+        inode_set_metadata(inode, CACHE_DIRECTORY);
+        dir->inode = inode;
         dir->pos = 0;
         // struct dir_list_elem elem = (dir_list_elem*)malloc(sizeof struct dir_list_elem);
         // elem->dir = dir;
@@ -134,7 +147,7 @@ void dir_close (struct dir *dir)
 {
     if (dir != NULL)
     {
-        inode_close (&(dir->inode));
+        inode_close (dir->inode);
         free (dir);
     }
 
@@ -185,12 +198,14 @@ bool dir_lookup (const struct dir *dir, const char *name, struct inode **inode)
     ASSERT (dir != NULL);
     ASSERT (name != NULL);
 
+    rwlock_acquire_read(&dir_lock);
     if (lookup (dir, name, &e, NULL))
     {
         *inode = inode_open (e.inode_sector);
     } else {
         *inode = NULL;
     }
+    rwlock_release_read(&dir_lock);
 
     return *inode != NULL;
 }
@@ -203,6 +218,7 @@ bool dir_lookup (const struct dir *dir, const char *name, struct inode **inode)
    error occurs. */
 bool dir_add (struct dir *dir, const char *name, block_sector_t inode_sector, bool is_dir)
 {
+  journal_begin();
  #ifdef FILESYS_SYNC
   inode_lock(dir->inode);
  #endif
@@ -219,9 +235,12 @@ bool dir_add (struct dir *dir, const char *name, block_sector_t inode_sector, bo
 #ifdef FILESYS_SYNC
     inode_unlock(dir->inode);
 #endif
+    journal_end();
     return false;
   }
 
+  rwlock_acquire_write(&dir_lock);
+
   /* Check that NAME is not in use. */
   if (lookup (dir, name, NULL, NULL))
   {
@@ -256,6 +275,8 @@ bool dir_add (struct dir *dir, const char *name, block_sector_t inode_sector, bo
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
  done:
+  rwlock_release_write(&dir_lock);
+  journal_end();
   return success;
 }
 
@@ -265,6 +286,7 @@ bool dir_add (struct dir *dir, const char *name, block_sector_t inode_sector, bo
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
+  journal_begin();
 #ifdef FILESYS_SYNC
   inode_lock(dir->inode);
 #endif
@@ -276,6 +298,8 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  rwlock_acquire_write(&dir_lock);
+
   /* Find directory entry. */
   if (!lookup (dir, name, &e, &ofs))
     goto done;
@@ -285,9 +309,8 @@ dir_remove (struct dir *dir, const char *name)
   if (inode == NULL)
     goto done;
 
-  if (inode_open_cnt(inode) > 1) {
-    return false;
-  }
+  if (inode_open_cnt(inode) > 1)
+    goto done;
 
   /* Erase directory entry. */
   e.in_use = false;
@@ -306,10 +329,42 @@ dir_remove (struct dir *dir, const char *name)
   inode_unlock(dir->inode);
 #endif
  done:
+  rwlock_release_write(&dir_lock);
   inode_close (inode);
+  journal_end();
   return success;
 }
 
+/* Queues the inode sectors of the next DIR_PREFETCH_WINDOW entries
+   after DIR's position for background reading, unless they were
+   queued by an earlier call.  Directory scans are usually followed
+   by opening the entries, which then hit the cache. */
+static void
+dir_prefetch_inodes (struct dir *dir)
+{
+#ifdef FILESYS_USE_CACHE
+  sid_t sectors[DIR_PREFETCH_WINDOW];
+  struct dir_entry e;
+  int count = 0;
+  off_t ofs;
+
+  if (dir->pos < dir->prefetch_pos)
+    return;
+
+  for (ofs = dir->pos; count < DIR_PREFETCH_WINDOW
+       && inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+       ofs += sizeof e)
+    if (e.in_use)
+      sectors[count++] = e.inode_sector;
+  dir->prefetch_pos = ofs;
+
+  if (count > 0)
+    cache_prefetch (sectors, count);
+#else
+  (void) dir;
+#endif
+}
+
 /* Reads the next directory entry in DIR and stores the name in
    NAME.  Returns true if successful, false if the directory
    contains no more entries. */
@@ -320,68 +375,121 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
   inode_lock(dir->inode);
 #endif
   struct dir_entry e;
+  bool found = false;
 
+  rwlock_acquire_read(&dir_lock);
+  dir_prefetch_inodes (dir);
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
     {
       dir->pos += sizeof e;
       if (e.in_use)
         {
           strlcpy (name, e.name, NAME_MAX + 1);
-	 #ifdef FILESYS_SYNC
-        inode_unlock(dir->inode);
-	 #endif
-          return true;
+          found = true;
+          break;
+        }
+    }
+  rwlock_release_read(&dir_lock);
+#ifdef FILESYS_SYNC
+  inode_unlock(dir->inode);
+#endif
+  return found;
+}
+
+/* Reads up to MAX_ENTRIES directory entries from DIR, starting
+   at its current position, into ENTRIES.  Each entry also carries
+   the inode number, type and length of the inode it names, so
+   callers need not open the entries one by one.  The inodes of
+   the entries after the batch are queued for reading in the
+   background, so that they are cached by the next call.
+   Returns the number of entries stored, 0 once the directory
+   contains no more entries. */
+int
+dir_readdir_batch (struct dir *dir, struct dirent *entries, int max_entries)
+{
+#ifdef FILESYS_SYNC
+  inode_lock(dir->inode);
+#endif
+  struct dir_entry e;
+  int count = 0;
+
+  rwlock_acquire_read(&dir_lock);
+  while (count < max_entries)
+    {
+      if (inode_read_at (dir->inode, &e, sizeof e, dir->pos) != sizeof e)
+        break;
+      dir->pos += sizeof e;
+      if (e.in_use)
+        {
+          struct dirent *entry = &entries[count++];
+          entry->inumber = e.inode_sector;
+          entry->is_dir = e.is_directory;
+          entry->size = inode_length_at (e.inode_sector);
+          strlcpy (entry->name, e.name, sizeof entry->name);
         }
     }
+  if (count > 0)
+    dir_prefetch_inodes (dir);
+  rwlock_release_read(&dir_lock);
 #ifdef FILESYS_SYNC
   inode_unlock(dir->inode);
 #endif
-  return false;
+  return count;
 }
 
 #ifdef FILESYS_SUBDIRS
+/* Returns a new reference to the directory a walk of PATH starts
+   from: the root for an absolute path, otherwise the current
+   process's working directory. */
+static struct dir *walk_start(const char *path) {
+    struct dir *cwd = process_current()->working_directory;
+
+    if (!path_is_relative(path) || cwd == NULL)
+        return dir_reopen(root_dir);
+    return dir_reopen(cwd);
+}
+
+/* Returns the inode PATH names, setting *IS_DIR to whether it is a
+   directory, or a null pointer if PATH does not exist.  The caller
+   owns the returned reference and must close it. */
 struct inode *dir_open_from_path(const char *path, bool *is_dir) {
     // printf("[debug] opening path %s\n", path);
     // printf("root dir: %p %d\n", root_dir, inode_get_inumber(dir_get_inode(root_dir)));
 
-    if (strcmp(path, "/") == 0) {
-      *is_dir = true;
-      return dir_get_inode(root_dir);
-    }
+    *is_dir = false;
 
-    if (strcmp(path, ".") == 0) {
-      *is_dir = true;
-      return dir_get_inode(process_working_directory(process_current()));
-    }
-
-    const struct dir *current_dir;
+    struct dir *current_dir;
+    struct inode *inode;
     char entry_name_buffer[NAME_MAX + 1];
     int offset = 0;
     struct dir_entry dir_entry_buffer;
 
     // initialize the current directory
-    if (path_is_relative(path)) {
-        current_dir = process_working_directory(process_current());
-        // printf("[debug] path is relative to %x\n", inode_get_inumber(current_dir->inode));
-    } else {
-        current_dir = root_dir;
-        // printf("[debug] path is absolute: %d\n", inode_get_inumber(current_dir->inode));
-    }
+    current_dir = walk_start(path);
+    if (current_dir == NULL)
+        return NULL;
 
     // walk the path
     while (*(path + offset) != '\0') {
         path_next_entry(path + offset, entry_name_buffer, NAME_MAX + 1, &offset);
 
+        if (entry_name_buffer[0] == '\0' || strcmp(entry_name_buffer, ".") == 0)
+            continue;
+
         // handle parent directory
         if (strcmp(entry_name_buffer, "..") == 0) {
-            struct dir *old_dir = current_dir;
-            current_dir = dir_parent(current_dir);
-            if (old_dir != root_dir) {
-              free(old_dir);
-            }
+            struct dir *parent = dir_parent(current_dir);
+            if (parent == root_dir)
+                parent = dir_reopen(root_dir);
+            dir_close(current_dir);
+            current_dir = parent;
+            if (current_dir == NULL)
+                return NULL;
         } else {
             // handle subdirectory
+            rwlock_acquire_read(&dir_lock);
             bool found = lookup(current_dir, entry_name_buffer, &dir_entry_buffer, NULL);
+            rwlock_release_read(&dir_lock);
 
             if (!found) {
                // printf("[debug] Could not find entry %s.\n", entry_name_buffer);
@@ -391,28 +499,31 @@ struct inode *dir_open_from_path(const char *path, bool *is_dir) {
                 // printf("[debug] found entry %s at inode %d.\n", entry_name_buffer, dir_entry_buffer.inode_sector);
                 if (dir_entry_buffer.is_directory) {
                     struct dir *old_dir = current_dir;
-                    struct inode *inode = inode_open(dir_entry_buffer.inode_sector);
+                    inode = inode_open(dir_entry_buffer.inode_sector);
                     // printf("[debug] directory entry at inode %d.\n", inode_get_inumber(inode));
                     current_dir = dir_open(inode);
                     // printf("[debug] dir pointer created at %p.\n", current_dir);
-                    // if (old_dir != root_dir) {
-                    //   free(old_dir);
-                    // }
+                    dir_close(old_dir);
+                    if (current_dir == NULL)
+                        return NULL;
                 } else {
                     path_next_entry(path + offset, entry_name_buffer, NAME_MAX + 1, &offset);
-                    if (entry_name_buffer[0] == '\0') {
-                        *is_dir = false;
+                    dir_close(current_dir);
+                    if (entry_name_buffer[0] == '\0')
                         return inode_open(dir_entry_buffer.inode_sector);
-                    }
+                    return NULL;
                 }
             } else {
+                dir_close(current_dir);
                 return NULL;
             }
         }
     }
     // printf("[debug] exiting %p %d\n", current_dir, inode_get_inumber(current_dir->inode));
     *is_dir = true;
-    return current_dir->inode;
+    inode = inode_reopen(current_dir->inode);
+    dir_close(current_dir);
+    return inode;
 }
 
 struct dir *dir_parent(const struct dir *dir) {
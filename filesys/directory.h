@@ -4,12 +4,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "devices/block.h"
-
-/* Maximum length of a file name component.
-   This is the traditional UNIX maximum length.
-   After directories are implemented, this maximum length may be
-   retained, but much longer full path names must be allowed. */
-#define NAME_MAX 16
+#include "filesys/layout.h"
 
 enum dir_entry_type {
 	T_FILE,
@@ -18,9 +13,11 @@ enum dir_entry_type {
 };
 
 struct inode;
+struct dirent;
 
 /* Initializes the directory module. */
 void dir_init(void);
+void dir_done(void);
 
 /* Opening and closing directories. */
 bool dir_create (block_sector_t sector, size_t entry_cnt, block_sector_t parent);
@@ -35,6 +32,7 @@ bool dir_lookup (const struct dir *, const char *name, struct inode **);
 bool dir_add (struct dir *, const char *name, block_sector_t, bool is_dir);
 bool dir_remove (struct dir *, const char *name);
 bool dir_readdir (struct dir *, char name[NAME_MAX + 1]);
+int dir_readdir_batch (struct dir *, struct dirent *, int max_entries);
 
 #ifdef FILESYS_SUBDIRS
 struct inode *dir_open_from_path(const char *path, bool *is_dir);
@@ -1,5 +1,6 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include <fadvise.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
@@ -9,6 +10,7 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    struct inode_advice advice; /* How this opener uses the data. */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -23,6 +25,8 @@ file_open (struct inode *inode)
         file->inode = inode;
         file->pos = 0;
         file->deny_write = false;
+        file->advice.advice = POSIX_FADV_NORMAL;
+        file->advice.ahead = 0;
         return file;
     } 
     else
@@ -68,7 +72,8 @@ file_get_inode (struct file *file)
 off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
-  off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  off_t bytes_read = inode_read_advised (file->inode, buffer, size,
+                                         file->pos, &file->advice);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -81,7 +86,8 @@ file_read (struct file *file, void *buffer, off_t size)
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) 
 {
-  return inode_read_at (file->inode, buffer, size, file_ofs);
+  return inode_read_advised (file->inode, buffer, size, file_ofs,
+                             &file->advice);
 }
 
 /* Writes SIZE bytes from BUFFER into FILE,
@@ -94,7 +100,8 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
 {
-  off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+  off_t bytes_written = inode_write_advised (file->inode, buffer, size,
+                                             file->pos, &file->advice);
   file->pos += bytes_written;
   return bytes_written;
 }
@@ -110,7 +117,74 @@ off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
                off_t file_ofs) 
 {
-  return inode_write_at (file->inode, buffer, size, file_ofs);
+  return inode_write_advised (file->inode, buffer, size, file_ofs,
+                              &file->advice);
+}
+
+/* Copies SIZE bytes from SRC, starting at its current position,
+   into DST at its current position, without passing the data
+   through a caller's buffer.
+   Returns the number of bytes actually copied, which may be less
+   than SIZE if end of SRC is reached or an error occurs.
+   Advances both files' positions by the number of bytes copied. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size)
+{
+  off_t bytes_copied = inode_copy (dst->inode, dst->pos,
+                                   src->inode, src->pos, size);
+  dst->pos += bytes_copied;
+  src->pos += bytes_copied;
+  return bytes_copied;
+}
+
+/* Allocates disk space for SIZE bytes of FILE starting at byte
+   offset START, without writing anything or changing the file's
+   length, so that later writes there do not have to allocate.
+   The file's current position is unaffected.
+   Returns true if successful, false if the disk is full or the
+   range is negative or ends past the largest possible file. */
+bool
+file_preallocate (struct file *file, off_t size, off_t start)
+{
+  ASSERT (file != NULL);
+  if (size < 0 || start < 0 || size > inode_max_length () - start)
+    return false;
+  return inode_preallocate (file->inode, start + size);
+}
+
+/* Writes FILE's data and, unless DATA_ONLY is true and they are
+   not needed to read the data back, its metadata to disk.
+   Returns true if successful. */
+bool
+file_sync (struct file *file, bool data_only)
+{
+  ASSERT (file != NULL);
+  return inode_sync (file->inode, data_only);
+}
+
+/* Applies ADVICE, one of the POSIX_FADV_* hints in <fadvise.h>, to
+   LEN bytes of FILE starting at OFFSET, or to the rest of the file
+   if LEN is 0.  NORMAL, RANDOM, SEQUENTIAL and NOREUSE set how
+   this opener reads and caches the data from now on, without
+   affecting other openers of the same inode; WILLNEED and DONTNEED
+   act on the range right away.
+   Returns false if ADVICE is not a known hint. */
+bool
+file_advise (struct file *file, off_t offset, off_t len, int advice)
+{
+  ASSERT (file != NULL);
+  switch (advice)
+    {
+    case POSIX_FADV_NORMAL:
+    case POSIX_FADV_RANDOM:
+    case POSIX_FADV_SEQUENTIAL:
+    case POSIX_FADV_NOREUSE:
+      file->advice.advice = advice;
+      file->advice.ahead = 0;
+      return true;
+    default:
+      return inode_advise (file->inode, offset, len, advice);
+    }
 }
 
 /* Prevents write operations on FILE's underlying inode
@@ -1,6 +1,7 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
 
 struct inode;
@@ -16,6 +17,10 @@ off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+off_t file_copy (struct file *dst, struct file *src, off_t size);
+bool file_preallocate (struct file *, off_t size, off_t start);
+bool file_sync (struct file *, bool data_only);
+bool file_advise (struct file *, off_t offset, off_t len, int advice);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
@@ -1,10 +1,12 @@
 #include "filesys/filesys.h"
 #include <debug.h>
+#include <dirent.h>
 #include <stdio.h>
 #include <string.h>
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "filesys/directory.h"
 #include "filesys/path.h"
 #include "threads/malloc.h"
@@ -15,7 +17,33 @@
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+size_t fs_block_sectors = 1;
+
+/* Sectors per block for a file system formatted from now on. */
+static size_t format_block_sectors = 1;
+
+static bool valid_block_sectors (size_t);
+static void read_super (void);
+static void write_super (void);
 static void do_format (void);
+static bool create (const char *name, off_t initial_size, bool is_dir);
+static bool defrag_dir (struct dir *, bool compact);
+
+/* Makes a file system formatted from now on allocate disk space
+   in blocks of BYTES bytes, which must be 512, 1024, 2048 or 4096.
+   Larger blocks take fewer extents, free map bits and cache
+   lookups per file, at the cost of more slack at the end of each
+   file and around each inode.
+   Returns false, changing nothing, if BYTES is not allowed. */
+bool
+filesys_set_block_size (size_t bytes)
+{
+  if (bytes % BLOCK_SECTOR_SIZE != 0
+      || !valid_block_sectors (bytes / BLOCK_SECTOR_SIZE))
+    return false;
+  format_block_sectors = bytes / BLOCK_SECTOR_SIZE;
+  return true;
+}
 
 /**
  * Initializes the file system module. 
@@ -34,14 +62,23 @@ void filesys_init(bool format)
     inode_global_lock_init();
 #endif
 
+    /* The free map is sized in blocks, so the block size must be
+       known before anything else. */
+    if (format)
+        fs_block_sectors = format_block_sectors;
+    else
+        read_super();
+
     inode_init();
     free_map_init();
+    journal_init();
 
     if (format) 
     {
         do_format();
     }
 
+    journal_open();
     free_map_open();
 
     dir_init();
@@ -51,7 +88,13 @@ void filesys_init(bool format)
    to disk. */
 void filesys_done (void) 
 {
+    /* The root directory stays open as long as the file system is
+       up, so it is written back only here, with whatever else is
+       still open. */
+    inode_sync_all ();
+    dir_done ();
     free_map_close ();
+    journal_close ();
     #ifdef FILESYS_USE_CACHE
         cache_close();
     #endif
@@ -81,6 +124,17 @@ static bool create_inode(block_sector_t sector, size_t size, block_sector_t pare
    Fails if a file named NAME already exists,
    or if internal memory allocation fails. */
 bool filesys_create(const char *name, off_t initial_size, bool is_dir) 
+{
+    bool success;
+
+    journal_begin();
+    success = create(name, initial_size, is_dir);
+    journal_end();
+    return success;
+}
+
+/* Does the work of filesys_create(), as one journal operation. */
+static bool create(const char *name, off_t initial_size, bool is_dir)
 {
 #ifdef FILESYS_SUBDIRS
     // printf("filesys_create %s.\n", name);
@@ -104,16 +158,17 @@ bool filesys_create(const char *name, off_t initial_size, bool is_dir)
         // 2. Ensure prefix_path exists
         bool path_is_dir;
         struct inode *parent_inode = dir_open_from_path(path_prefix, &path_is_dir);
+        free(path_prefix);
         if(parent_inode == NULL)
         	return false;
+        if (!path_is_dir) {
+            inode_close(parent_inode);
+            return false;
+        }
         // printf("inode: %d\n", inode_get_inumber(parent_inode));
         parent_dir = dir_open(parent_inode);
-        if (parent_dir == NULL || !path_is_dir) {
-        	free(path_prefix);
+        if (parent_dir == NULL)
             return false;
-        }
-
-        free(path_prefix);
     }
 #else
     parent_dir = dir_open_root();
@@ -152,6 +207,7 @@ struct file *filesys_open_file(const char *name)
     bool is_dir;
     inode = dir_open_from_path(name, &is_dir);
     if (is_dir) {
+        inode_close(inode);
         return NULL;
     } else {
         return file_open(inode);
@@ -175,6 +231,7 @@ struct dir *filesys_open_dir(const char *path) {
         // printf("< filesys_open_dir %d %d", is_dir, inode_get_inumber(inode));
         return dir_open(inode);
     } else {
+        inode_close(inode);
         return NULL;
     }
 }
@@ -182,7 +239,9 @@ struct dir *filesys_open_dir(const char *path) {
 bool filesys_path_exists(const char *path) {
     // printf("> filesys_path_exists %s\n", path);
     bool is_dir;
-    bool exists = dir_open_from_path(path, &is_dir) != NULL;
+    struct inode *inode = dir_open_from_path(path, &is_dir);
+    bool exists = inode != NULL;
+    inode_close(inode);
     // printf("< filesys_path_exists %d\n", exists);
     return exists;
 }
@@ -190,12 +249,140 @@ bool filesys_path_exists(const char *path) {
 bool filesys_path_is_file(const char *path) {
     // printf("> filesys_path_is_file\n");
     bool is_dir;
-    dir_open_from_path(path, &is_dir);
+    inode_close(dir_open_from_path(path, &is_dir));
     // printf("< filesys_path_is_file: %d\n", !is_dir);
     return !is_dir;
 }
 #endif
 
+/* Creates a file named NEW_NAME holding the same data as the file
+   named OLD_NAME.  With FILESYS_EXTEND_FILES the two share their
+   data sectors until either is written, so this takes time in
+   proportion to the number of extents, not to the size.  Without
+   it, files cannot grow, so NEW_NAME is created at its final size
+   and gets a copy of the data.
+   Returns true if successful, false otherwise.
+   Fails if OLD_NAME does not exist or is a directory, or if
+   NEW_NAME already exists. */
+bool filesys_clone (const char *old_name, const char *new_name)
+{
+    struct file *src, *dst = NULL;
+    bool success = false;
+
+    src = filesys_open_file(old_name);
+    if (src == NULL)
+        return false;
+    journal_begin();
+#ifdef FILESYS_EXTEND_FILES
+    if (filesys_create(new_name, 0, false))
+    {
+        dst = filesys_open_file(new_name);
+        success = dst != NULL
+                  && inode_clone(file_get_inode(dst), file_get_inode(src));
+#else
+    off_t length = file_length(src);
+    if (filesys_create(new_name, length, false))
+    {
+        dst = filesys_open_file(new_name);
+        success = dst != NULL
+                  && inode_copy(file_get_inode(dst), 0,
+                                file_get_inode(src), 0, length) == length;
+#endif
+        /* NEW_NAME cannot be removed while it is open. */
+        if (!success)
+        {
+            file_close(dst);
+            dst = NULL;
+            filesys_remove(new_name);
+        }
+    }
+    file_close(dst);
+    file_close(src);
+    journal_end();
+    return success;
+}
+
+/* Moves the data of the file named NAME, or of every file in the
+   tree below the directory named NAME, into one run per file, as
+   close after its inode as free space allows.  A tree then gets a
+   second pass that moves each file to the lowest free run that
+   holds it, which packs the files towards the start of the disk
+   and merges the free space between them into fewer, longer runs.
+   Returns false if NAME does not exist or a file could not be
+   moved. */
+bool filesys_defrag (const char *name)
+{
+    struct inode *inode = NULL;
+    bool is_dir, success;
+
+#ifdef FILESYS_SUBDIRS
+    inode = dir_open_from_path(name, &is_dir);
+#else
+    struct dir *root = dir_open_root();
+    is_dir = strcmp(name, "/") == 0;
+    if (root != NULL)
+    {
+        if (is_dir)
+            inode = inode_reopen(dir_get_inode(root));
+        else
+            dir_lookup(root, name, &inode);
+    }
+    dir_close(root);
+#endif
+    /* INODE is a reference of our own in either case, which
+       defrag_dir() hands to the dir it closes. */
+    if (inode == NULL)
+        return false;
+    if (is_dir)
+    {
+        success = defrag_dir(dir_open(inode_reopen(inode)), false);
+        return defrag_dir(dir_open(inode), true) && success;
+    }
+    success = inode_defrag(inode);
+    inode_close(inode);
+    return success;
+}
+
+/* Defragments every file in the tree below DIR, or moves each to
+   the lowest free run that holds it if COMPACT, then closes DIR. */
+static bool defrag_dir (struct dir *dir, bool compact)
+{
+    struct dirent entries[8];
+    bool success = true;
+    int cnt, i;
+
+    if (dir == NULL)
+        return false;
+    while ((cnt = dir_readdir_batch(dir, entries, 8)) > 0)
+        for (i = 0; i < cnt; i++)
+        {
+            struct inode *inode = inode_open(entries[i].inumber);
+            if (inode == NULL)
+                success = false;
+            else if (entries[i].is_dir)
+                success = defrag_dir(dir_open(inode), compact) && success;
+            else
+            {
+                success = (compact ? inode_compact(inode)
+                           : inode_defrag(inode)) && success;
+                inode_close(inode);
+            }
+        }
+    dir_close(dir);
+    return success;
+}
+
+/* Writes everything the file system has in memory to disk: the
+   data of open files, their metadata and the free map through the
+   journal, and whatever else is dirty in the buffer cache. */
+void filesys_sync (void)
+{
+    inode_sync_all();
+#ifdef FILESYS_USE_CACHE
+    cache_sync();
+#endif
+}
+
 /* Deletes the file named NAME.
    Returns true if successful, false on failure.
    Fails if no file named NAME exists,
@@ -235,16 +422,61 @@ bool filesys_remove(const char *name)
 //     }
 //     printf("removing file ")
 // #else
+    journal_begin ();
     struct dir *dir = dir_open_root ();
     bool success = dir != NULL && dir_remove(dir, name);
     dir_close (dir); 
+    journal_end ();
     return success;
 // #endif
 }
 
+/* Returns true if a block of CNT sectors is allowed: a power of
+   two no larger than FS_BLOCK_MAX_SECTORS. */
+static bool valid_block_sectors (size_t cnt)
+{
+    return cnt > 0 && cnt <= FS_BLOCK_MAX_SECTORS && (cnt & (cnt - 1)) == 0;
+}
+
+/* Reads the block size from the superblock.  A file system without
+   one predates it and was allocated a sector at a time. */
+static void read_super (void)
+{
+    struct super_disk *super = malloc (sizeof *super);
+
+    if (super == NULL)
+        PANIC ("can't allocate superblock");
+    block_read (fs_device, SUPER_SECTOR, super);
+    if (super->magic == SUPER_MAGIC
+        && valid_block_sectors (super->block_sectors))
+        fs_block_sectors = super->block_sectors;
+    else
+    {
+        printf ("filesys: no superblock, assuming %d-byte blocks\n",
+                BLOCK_SECTOR_SIZE);
+        fs_block_sectors = 1;
+    }
+    free (super);
+}
+
+/* Writes the superblock of a newly formatted file system. */
+static void write_super (void)
+{
+    struct super_disk *super = calloc (1, sizeof *super);
+
+    if (super == NULL)
+        PANIC ("can't allocate superblock");
+    super->magic = SUPER_MAGIC;
+    super->block_sectors = fs_block_sectors;
+    block_write (fs_device, SUPER_SECTOR, super);
+    free (super);
+}
+
 /* Formats the file system. */
 static void do_format (void)
 {
+    write_super ();
+    journal_create ();
     free_map_create ();
     if (!dir_create (ROOT_DIR_SECTOR, 16, true)) {
         PANIC ("root directory creation failed");
@@ -2,20 +2,29 @@
 #define FILESYS_FILESYS_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include "filesys/layout.h"
 #include "filesys/off_t.h"
 
-/* Sectors of system file inodes. */
-#define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
-#define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+/* Largest file system block, in sectors: one page. */
+#define FS_BLOCK_MAX_SECTORS 8
+
+/* Sectors per file system block, the unit in which disk space is
+   allocated.  Chosen when the file system is formatted. */
+extern size_t fs_block_sectors;
 
 /* Block device that contains the file system. */
 struct block *fs_device;
 
+bool filesys_set_block_size (size_t bytes);
 void filesys_init (bool format);
 void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size, bool is_dir);
 struct file *filesys_open_file (const char *name);
 bool filesys_remove (const char *name);
+bool filesys_clone (const char *old_name, const char *new_name);
+bool filesys_defrag (const char *name);
+void filesys_sync (void);
 
 #ifdef FILESYS_SUBDIRS
 struct dir *filesys_open_dir(const char *path);
@@ -1,76 +1,583 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <hash.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
-static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct bitmap *free_map;      /* Free map, one bit per block. */
+
+/* Disk space is handed out in whole file system blocks of
+   fs_block_sectors sectors, which keeps the bitmap, the share map
+   and the free run index that much smaller.  The interface still
+   counts sectors: a request is rounded up to whole blocks, and
+   every sector number it returns or takes starts a block. */
+
+/* A run of free sectors.  The bitmap stays the authoritative,
+   persistent record; the runs are an in-memory index over it,
+   rebuilt whenever the bitmap is loaded, so that allocation does
+   not scan the bitmap bit by bit from sector 0.  Runs always
+   cover whole blocks, and are as long as they can be: the blocks
+   on either side of a run are in use or held. */
+struct free_extent
+  {
+    block_sector_t start;               /* First free sector. */
+    size_t length;                      /* Number of free sectors. */
+    struct hash_elem start_elem;        /* Element in free_by_start. */
+    struct hash_elem end_elem;          /* Element in free_by_end. */
+    struct list_elem size_elem;         /* Element in free_by_size[]. */
+  };
+
+/* Number of size classes.  Class K holds runs of 2**K to
+   2**(K+1) - 1 sectors. */
+#define SIZE_CLASS_CNT 32
+
+/* Free runs by their first sector and by the sector just past
+   their end.  Releasing sectors finds the runs to merge them with,
+   and an allocation near a goal sector finds the run there, with
+   one lookup each instead of a walk over every run before it. */
+static struct hash free_by_start;
+static struct hash free_by_end;
+
+/* How many blocks past its goal free_map_allocate_near() looks
+   for a run that holds a whole request, before it settles for any
+   run that does.  Keeps the search short however many runs there
+   are. */
+#define NEAR_WINDOW_BLOCKS 1024
+
+/* Free runs grouped by size class, for finding a run that is
+   large enough without walking all of them. */
+static struct list free_by_size[SIZE_CLASS_CNT];
+
+/* Number of free sectors, and how many of those are held back by
+   free_map_reserve() for data that has no sectors yet. */
+static size_t free_cnt;
+static size_t reserved_cnt;
+
+/* Sectors of the free map file that differ from their disk copy,
+   one bit per sector of the file.  Only these are rewritten by
+   free_map_flush(), instead of the whole bitmap on every
+   allocation and release. */
+static struct bitmap *dirty_sectors;
+
+/* Blocks released while the journal still holds an image of a
+   sector in them.  They stay out of the free run index until a
+   checkpoint has written the images home and emptied the log, so
+   that neither can later overwrite a sector that has found a new
+   owner. */
+static struct bitmap *held;
+
+/* Protects free_map and dirty_sectors.  The cache dump thread
+   flushes the free map concurrently with allocations. */
+static struct lock free_map_lock;
+
+#ifdef FILESYS_EXTEND_FILES
+/* Blocks owned by more than one file, after cloning, are only
+   freed when their last owner lets go.  SHARE_CNT holds, for each
+   block, the number of owners beyond the first; it is kept on
+   disk in the share map file, one byte per block, and written
+   back the same way as the free map. */
+static struct file *share_file;       /* Share map file. */
+static uint8_t *share_cnt;            /* Extra owners of each block. */
+static struct bitmap *share_dirty;    /* Sectors of share_file to write. */
+
+static void share_mark_dirty (size_t);
+#endif
+
+static size_t block_cnt (void);
+static size_t to_blocks (size_t);
+static void release_run (size_t, size_t);
+static void mark_dirty (size_t, size_t);
+static void free_map_flush_locked (void);
+static void index_build (void);
+static void index_insert (block_sector_t, size_t);
+static void index_take (struct free_extent *, block_sector_t, size_t);
+static struct free_extent *run_starting_at (block_sector_t);
+static struct free_extent *index_find_fit (size_t);
+static struct free_extent *index_find_largest (void);
+static struct free_extent *index_find_near (block_sector_t, size_t,
+                                            bool *);
+static size_t take_run (struct free_extent *, block_sector_t, size_t,
+                        block_sector_t *);
 
 /* Initializes the free map. */
 void
-free_map_init (void) 
+free_map_init (void)
 {
-  free_map = bitmap_create (block_size (fs_device));
+  struct bitmap *dirty;
+
+  lock_init (&free_map_lock);
+  free_map = bitmap_create (block_cnt ());
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
-  bitmap_mark (free_map, FREE_MAP_SECTOR);
-  bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_mark (free_map, FREE_MAP_SECTOR / fs_block_sectors);
+  bitmap_mark (free_map, ROOT_DIR_SECTOR / fs_block_sectors);
+  bitmap_mark (free_map, JOURNAL_SECTOR / fs_block_sectors);
+  bitmap_mark (free_map, SUPER_SECTOR / fs_block_sectors);
+  held = bitmap_create (block_cnt ());
+  if (held == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+#ifdef FILESYS_EXTEND_FILES
+  bitmap_mark (free_map, SHARE_MAP_SECTOR / fs_block_sectors);
+  share_cnt = calloc (block_cnt (), 1);
+  share_dirty = bitmap_create (DIV_ROUND_UP (block_cnt (),
+                                             BLOCK_SECTOR_SIZE));
+  if (share_cnt == NULL || share_dirty == NULL)
+    PANIC ("share map creation failed--file system device is too large");
+#endif
+  index_build ();
+
+  /* Published last: the cache dump thread may already be
+     calling free_map_flush(). */
+  dirty = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+                                       BLOCK_SECTOR_SIZE));
+  if (dirty == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+  dirty_sectors = dirty;
 }
 
-/* Allocates CNT consecutive sectors from the free map and stores
-   the first into *SECTORP.
+/* Allocates CNT consecutive sectors, rounded up to whole blocks,
+   from the free map and stores the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available.
+   The change reaches the free map file through free_map_flush(),
+   which runs along with the periodic cache write-back. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  struct free_extent *fe;
+  bool success = false;
+
+  lock_acquire (&free_map_lock);
+  if (cnt == 0)
+    {
+      /* Nothing to allocate; callers treat sector 0 as none. */
+      *sectorp = 0;
+      success = true;
+    }
+  else
+    {
+      cnt = to_blocks (cnt) * fs_block_sectors;
+      if (cnt <= free_cnt - reserved_cnt
+          && (fe = index_find_fit (cnt)) != NULL)
+        success = take_run (fe, fe->start, cnt, sectorp) == cnt;
+    }
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Allocates up to CNT consecutive sectors, rounded up to whole
+   blocks, preferring a run that starts at GOAL, then the nearest
+   run after GOAL, within NEAR_WINDOW_BLOCKS, that holds all CNT
+   sectors, then any run that does.  GOAL is rounded up to the start of a block.  If no free
+   run is CNT sectors long, the largest one is used.  Stores the
+   first sector into *SECTORP.
+   Returns the number of sectors allocated, always whole blocks,
+   which is less than CNT if free space is fragmented and 0 if the
+   disk is full.  Sectors reserved by free_map_reserve() count as
+   in use. */
+size_t
+free_map_allocate_near (size_t cnt, block_sector_t goal,
+                        block_sector_t *sectorp)
+{
+  struct free_extent *fe = NULL;
+  size_t allocated = 0;
+  bool at_goal;
+
+  ASSERT (cnt > 0);
+
+  cnt = to_blocks (cnt) * fs_block_sectors;
+  goal = to_blocks (goal) * fs_block_sectors;
+  lock_acquire (&free_map_lock);
+  if (cnt > free_cnt - reserved_cnt)
+    cnt = (free_cnt - reserved_cnt) / fs_block_sectors * fs_block_sectors;
+  if (cnt > 0)
+    fe = index_find_near (goal, cnt, &at_goal);
+  if (fe != NULL && at_goal)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      /* GOAL itself is free: continue right where the caller left
+         off, even if the run is short. */
+      allocated = take_run (fe, goal, cnt, sectorp);
     }
-  if (sector != BITMAP_ERROR)
-    *sectorp = sector;
-  return sector != BITMAP_ERROR;
+  else if (cnt > 0)
+    {
+      if (fe == NULL)
+        fe = index_find_fit (cnt);
+      if (fe == NULL)
+        fe = index_find_largest ();
+      if (fe != NULL)
+        allocated = take_run (fe, fe->start, cnt, sectorp);
+    }
+  lock_release (&free_map_lock);
+  return allocated;
+}
+
+/* Allocates CNT consecutive sectors, rounded up to whole blocks,
+   from the free run with the lowest address that holds them all,
+   if that run starts before sector LIMIT, and stores the first
+   into *SECTORP.  Scans the bitmap from the start of the disk, so
+   it is meant for compacting free space, not for every
+   allocation.
+   Returns true if successful, false if there is no such run. */
+bool
+free_map_allocate_below (size_t cnt, block_sector_t limit,
+                         block_sector_t *sectorp)
+{
+  size_t limit_block, block;
+  bool success = false;
+
+  ASSERT (cnt > 0);
+
+  cnt = to_blocks (cnt) * fs_block_sectors;
+  limit_block = to_blocks (limit);
+  lock_acquire (&free_map_lock);
+  if (limit_block > bitmap_size (free_map))
+    limit_block = bitmap_size (free_map);
+  if (cnt <= free_cnt - reserved_cnt)
+    for (block = 0; block < limit_block; block++)
+      if (!bitmap_test (free_map, block))
+        {
+          struct free_extent *fe = run_starting_at (block * fs_block_sectors);
+          if (fe == NULL)
+            continue;
+          if (fe->length >= cnt)
+            {
+              success = take_run (fe, fe->start, cnt, sectorp) == cnt;
+              break;
+            }
+          block = (fe->start + fe->length) / fs_block_sectors;
+        }
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Sets aside CNT free sectors for data that has not been given
+   sectors yet, so that other allocations cannot use them up and
+   the data is sure to find room when it is finally placed.
+   Returns false if fewer than CNT sectors are free and not
+   already reserved. */
+bool
+free_map_reserve (size_t cnt)
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  success = cnt <= free_cnt - reserved_cnt;
+  if (success)
+    reserved_cnt += cnt;
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Gives back CNT sectors reserved by free_map_reserve(), either
+   right before allocating them or because the data they were
+   held for has been dropped. */
+void
+free_map_unreserve (size_t cnt)
+{
+  lock_acquire (&free_map_lock);
+  ASSERT (cnt <= reserved_cnt);
+  reserved_cnt -= cnt;
+  lock_release (&free_map_lock);
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT sectors starting at SECTOR, which must start a block,
+   available for use, along with the rest of the last block they
+   reach into.  A block that other files still share only loses
+   one owner. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
-  ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  size_t block, blocks;
+
+  if (cnt == 0)
+    return;
+  ASSERT (sector % fs_block_sectors == 0);
+  block = sector / fs_block_sectors;
+  blocks = to_blocks (cnt);
+  lock_acquire (&free_map_lock);
+#ifdef FILESYS_EXTEND_FILES
+  while (blocks > 0)
+    {
+      size_t run = 0;
+
+      while (run < blocks && share_cnt[block + run] == 0)
+        run++;
+      release_run (block, run);
+      block += run;
+      blocks -= run;
+      if (blocks > 0)
+        {
+          share_cnt[block]--;
+          share_mark_dirty (block);
+          block++;
+          blocks--;
+        }
+    }
+#else
+  release_run (block, blocks);
+#endif
+  lock_release (&free_map_lock);
+}
+
+/* Returns true if the journal holds an image of a sector in
+   BLOCK. */
+static bool
+block_held (size_t block)
+{
+  size_t i;
+
+  for (i = 0; i < fs_block_sectors; i++)
+    if (journal_holds (block * fs_block_sectors + i))
+      return true;
+  return false;
+}
+
+/* Frees CNT blocks starting at BLOCK, which nobody else owns.
+   The caller holds free_map_lock. */
+static void
+release_run (size_t block, size_t cnt)
+{
+  size_t i, run = 0;
+
+  if (cnt == 0)
+    return;
+  ASSERT (bitmap_all (free_map, block, cnt));
+  bitmap_set_multiple (free_map, block, cnt, false);
+  mark_dirty (block, cnt);
+  for (i = 0; i <= cnt; i++)
+    if (i < cnt && !block_held (block + i))
+      run++;
+    else
+      {
+        if (run > 0)
+          index_insert ((block + i - run) * fs_block_sectors,
+                        run * fs_block_sectors);
+        if (i < cnt)
+          bitmap_mark (held, block + i);
+        run = 0;
+      }
+}
+
+/* Makes the blocks released while the journal held images of
+   sectors in them available again, once it no longer does.
+   Called after a journal checkpoint. */
+void
+free_map_unhold (void)
+{
+  size_t block = 0;
+
+  lock_acquire (&free_map_lock);
+  while ((block = bitmap_scan (held, block, 1, true)) != BITMAP_ERROR)
+    {
+      if (!block_held (block))
+        {
+          bitmap_reset (held, block);
+          index_insert (block * fs_block_sectors, fs_block_sectors);
+        }
+      block++;
+    }
+  lock_release (&free_map_lock);
+}
+
+#ifdef FILESYS_EXTEND_FILES
+/* Adds an owner to each block of the CNT sectors starting at
+   SECTOR, which must be in use and start a block, so that they
+   stay allocated until every owner has released them.
+   Returns false, changing nothing, if a block already has as many
+   owners as can be counted. */
+bool
+free_map_share (block_sector_t sector, size_t cnt)
+{
+  size_t block = sector / fs_block_sectors, blocks = to_blocks (cnt);
+  size_t i;
+
+  ASSERT (sector % fs_block_sectors == 0);
+  lock_acquire (&free_map_lock);
+  ASSERT (bitmap_all (free_map, block, blocks));
+  for (i = 0; i < blocks; i++)
+    if (share_cnt[block + i] == UINT8_MAX)
+      {
+        lock_release (&free_map_lock);
+        return false;
+      }
+  for (i = 0; i < blocks; i++)
+    {
+      share_cnt[block + i]++;
+      share_mark_dirty (block + i);
+    }
+  lock_release (&free_map_lock);
+  return true;
+}
+
+/* Returns true if the block holding SECTOR belongs to more than
+   one file, so that a file must copy it before writing to it. */
+bool
+free_map_shared (block_sector_t sector)
+{
+  /* A byte read needs no lock; a count can only drop below 1 when
+     the block's other owners release it, which does not race with
+     this owner's writes. */
+  return share_cnt[sector / fs_block_sectors] > 0;
+}
+
+/* Records that the share count of BLOCK changed. */
+static void
+share_mark_dirty (size_t block)
+{
+  bitmap_mark (share_dirty, block / BLOCK_SECTOR_SIZE);
+#ifndef FILESYS_USE_CACHE
+  free_map_flush_locked ();
+#endif
+}
+#endif
+
+/* Allocates up to CNT sectors of run FE, starting at SECTOR,
+   which must lie within FE.  SECTOR and CNT must be whole blocks.
+   Stores SECTOR into *SECTORP and returns the number of sectors
+   allocated. */
+static size_t
+take_run (struct free_extent *fe, block_sector_t sector, size_t cnt,
+          block_sector_t *sectorp)
+{
+  size_t avail = fe->start + fe->length - sector;
+  if (cnt > avail)
+    cnt = avail;
+
+  ASSERT (sector % fs_block_sectors == 0 && cnt % fs_block_sectors == 0);
+  ASSERT (bitmap_none (free_map, sector / fs_block_sectors,
+                       cnt / fs_block_sectors));
+  bitmap_set_multiple (free_map, sector / fs_block_sectors,
+                       cnt / fs_block_sectors, true);
+  mark_dirty (sector / fs_block_sectors, cnt / fs_block_sectors);
+  index_take (fe, sector, cnt);
+  *sectorp = sector;
+  return cnt;
+}
+
+/* Records that the bits for CNT blocks starting at BLOCK
+   changed.  Without the buffer cache there is no write-back to
+   piggyback on, so the dirty sectors are written at once. */
+static void
+mark_dirty (size_t block, size_t cnt)
+{
+  size_t first, last;
+
+  if (cnt == 0)
+    return;
+  first = block / 8 / BLOCK_SECTOR_SIZE;
+  last = (block + cnt - 1) / 8 / BLOCK_SECTOR_SIZE;
+  bitmap_set_multiple (dirty_sectors, first, last - first + 1, true);
+
+#ifndef FILESYS_USE_CACHE
+  free_map_flush_locked ();
+#endif
+}
+
+/* Writes the dirty sectors of the free map to the free map file.
+   With the buffer cache this only hands them to the journal; each
+   journal commit calls this, so that the free map is committed
+   along with the metadata that points into it. */
+void
+free_map_flush (void)
+{
+  if (dirty_sectors == NULL)
+    return;
+  journal_begin ();
+  lock_acquire (&free_map_lock);
+  free_map_flush_locked ();
+  lock_release (&free_map_lock);
+  journal_end ();
+}
+
+/* Does the work of free_map_flush(); the caller holds
+   free_map_lock. */
+static void
+free_map_flush_locked (void)
+{
+  off_t file_size = bitmap_file_size (free_map);
+  size_t i;
+
+  if (free_map_file == NULL)
+    return;
+
+  for (i = 0; i < bitmap_size (dirty_sectors); i++)
+    if (bitmap_test (dirty_sectors, i))
+      {
+        off_t ofs = i * BLOCK_SECTOR_SIZE;
+        off_t size = file_size - ofs < BLOCK_SECTOR_SIZE
+                     ? file_size - ofs : BLOCK_SECTOR_SIZE;
+        if (bitmap_write_partial (free_map, free_map_file, ofs, size))
+          bitmap_reset (dirty_sectors, i);
+      }
+
+#ifdef FILESYS_EXTEND_FILES
+  if (share_file == NULL)
+    return;
+  for (i = 0; i < bitmap_size (share_dirty); i++)
+    if (bitmap_test (share_dirty, i))
+      {
+        off_t ofs = i * BLOCK_SECTOR_SIZE;
+        off_t size = (off_t) block_cnt () - ofs < BLOCK_SECTOR_SIZE
+                     ? (off_t) block_cnt () - ofs : BLOCK_SECTOR_SIZE;
+        if (file_write_at (share_file, share_cnt + ofs, size, ofs) == size)
+          bitmap_reset (share_dirty, i);
+      }
+#endif
 }
 
 /* Opens the free map file and reads it from disk. */
 void
-free_map_open (void) 
+free_map_open (void)
 {
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_set_metadata (file_get_inode (free_map_file), CACHE_BITMAP);
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  bitmap_set_all (dirty_sectors, false);
+  bitmap_set_all (held, false);
+#ifdef FILESYS_EXTEND_FILES
+  share_file = file_open (inode_open (SHARE_MAP_SECTOR));
+  if (share_file == NULL)
+    PANIC ("can't open share map");
+  inode_set_metadata (file_get_inode (share_file), CACHE_BITMAP);
+  if (file_read_at (share_file, share_cnt, block_cnt (), 0)
+      != (off_t) block_cnt ())
+    PANIC ("can't read share map");
+  bitmap_set_all (share_dirty, false);
+#endif
+  lock_acquire (&free_map_lock);
+  index_build ();
+  lock_release (&free_map_lock);
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
-free_map_close (void) 
+free_map_close (void)
 {
+  free_map_flush ();
   file_close (free_map_file);
+  free_map_file = NULL;
+#ifdef FILESYS_EXTEND_FILES
+  file_close (share_file);
+  share_file = NULL;
+#endif
 }
 
 /* Creates a new free map file on disk and writes the free map to
    it. */
 void
-free_map_create (void) 
+free_map_create (void)
 {
   /* Create inode. */
 #ifdef FILESYS_SUBDIRS
@@ -85,6 +592,359 @@ free_map_create (void)
     free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
     if (free_map_file == NULL)
         PANIC ("can't open free map");
+    inode_set_metadata (file_get_inode (free_map_file), CACHE_BITMAP);
     if (!bitmap_write (free_map, free_map_file))
         PANIC ("can't write free map");
+    bitmap_set_all (dirty_sectors, false);
+
+#ifdef FILESYS_EXTEND_FILES
+    /* The share map starts out all zeros, which inode_create()
+       writes already; the file only needs its sectors. */
+#ifdef FILESYS_SUBDIRS
+    if (!inode_create (SHARE_MAP_SECTOR, block_cnt (), SHARE_MAP_SECTOR))
+#else
+    if (!inode_create (SHARE_MAP_SECTOR, block_cnt ()))
+#endif
+        PANIC ("share map creation failed");
+    share_file = file_open (inode_open (SHARE_MAP_SECTOR));
+    if (share_file == NULL)
+        PANIC ("can't open share map");
+    inode_set_metadata (file_get_inode (share_file), CACHE_BITMAP);
+    memset (share_cnt, 0, block_cnt ());
+    bitmap_set_all (share_dirty, false);
+#endif
+}
+
+/* Returns the number of whole blocks on the file system device.
+   Sectors past the last of them are never used. */
+static size_t
+block_cnt (void)
+{
+  return block_size (fs_device) / fs_block_sectors;
+}
+
+/* Returns the number of blocks needed for CNT sectors. */
+static size_t
+to_blocks (size_t cnt)
+{
+  return DIV_ROUND_UP (cnt, fs_block_sectors);
+}
+
+/* Free extent index. */
+
+/* Returns the size class of a run of LENGTH sectors. */
+static int
+size_class (size_t length)
+{
+  int class = 0;
+  while (length >>= 1)
+    class++;
+  return class < SIZE_CLASS_CNT ? class : SIZE_CLASS_CNT - 1;
+}
+
+/* Files FE under the size class of its current length. */
+static void
+classify (struct free_extent *fe)
+{
+  list_push_front (&free_by_size[size_class (fe->length)], &fe->size_elem);
+}
+
+/* Returns the run that starts at SECTOR, or a null pointer if
+   there is none. */
+static struct free_extent *
+run_starting_at (block_sector_t sector)
+{
+  struct free_extent key;
+  struct hash_elem *e;
+
+  key.start = sector;
+  e = hash_find (&free_by_start, &key.start_elem);
+  return e != NULL ? hash_entry (e, struct free_extent, start_elem) : NULL;
+}
+
+/* Returns the run that ends just before SECTOR, or a null pointer
+   if there is none. */
+static struct free_extent *
+run_ending_at (block_sector_t sector)
+{
+  struct free_extent key;
+  struct hash_elem *e;
+
+  key.start = sector;
+  key.length = 0;
+  e = hash_find (&free_by_end, &key.end_elem);
+  return e != NULL ? hash_entry (e, struct free_extent, end_elem) : NULL;
+}
+
+/* Enters FE into the index under its current start and length. */
+static void
+index_add (struct free_extent *fe)
+{
+  hash_insert (&free_by_start, &fe->start_elem);
+  hash_insert (&free_by_end, &fe->end_elem);
+  classify (fe);
+}
+
+/* Removes FE from the index, before its start or length
+   changes. */
+static void
+index_remove (struct free_extent *fe)
+{
+  hash_delete (&free_by_start, &fe->start_elem);
+  hash_delete (&free_by_end, &fe->end_elem);
+  list_remove (&fe->size_elem);
+}
+
+/* Hash and comparison functions for free_by_start and
+   free_by_end. */
+static unsigned
+start_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct free_extent, start_elem)->start);
+}
+
+static bool
+start_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct free_extent, start_elem)->start
+          < hash_entry (b, struct free_extent, start_elem)->start);
+}
+
+static block_sector_t
+run_end (const struct hash_elem *e)
+{
+  const struct free_extent *fe = hash_entry (e, struct free_extent, end_elem);
+  return fe->start + fe->length;
+}
+
+static unsigned
+end_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (run_end (e));
+}
+
+static bool
+end_less (const struct hash_elem *a, const struct hash_elem *b,
+          void *aux UNUSED)
+{
+  return run_end (a) < run_end (b);
+}
+
+/* Frees a run, for hash_clear(). */
+static void
+run_destroy (struct hash_elem *e, void *aux UNUSED)
+{
+  free (hash_entry (e, struct free_extent, start_elem));
+}
+
+/* Discards the index and rebuilds it from the bitmap. */
+static void
+index_build (void)
+{
+  size_t i, cnt = bitmap_size (free_map);
+
+  static bool index_ready;
+
+  if (index_ready)
+    {
+      hash_clear (&free_by_end, NULL);
+      hash_clear (&free_by_start, run_destroy);
+    }
+  else if (!hash_init (&free_by_start, start_hash, start_less, NULL)
+           || !hash_init (&free_by_end, end_hash, end_less, NULL))
+    PANIC ("out of memory for the free extent index");
+  index_ready = true;
+  free_cnt = 0;
+  for (i = 0; i < SIZE_CLASS_CNT; i++)
+    list_init (&free_by_size[i]);
+
+  i = 0;
+  while ((i = bitmap_scan (free_map, i, 1, false)) != BITMAP_ERROR)
+    {
+      size_t start = i;
+      while (i < cnt && !bitmap_test (free_map, i))
+        i++;
+      index_insert (start * fs_block_sectors,
+                    (i - start) * fs_block_sectors);
+    }
+}
+
+/* Adds the CNT free sectors starting at START to the index,
+   merging them with adjacent runs. */
+static void
+index_insert (block_sector_t start, size_t cnt)
+{
+  struct free_extent *prev = run_ending_at (start);
+  struct free_extent *next = run_starting_at (start + cnt);
+  struct free_extent *fe;
+
+  free_cnt += cnt;
+  if (prev != NULL)
+    index_remove (prev);
+  if (next != NULL)
+    index_remove (next);
+
+  if (prev != NULL)
+    {
+      fe = prev;
+      fe->length += cnt;
+      if (next != NULL)
+        {
+          fe->length += next->length;
+          free (next);
+        }
+    }
+  else if (next != NULL)
+    {
+      fe = next;
+      fe->start = start;
+      fe->length += cnt;
+    }
+  else
+    {
+      fe = malloc (sizeof *fe);
+      if (fe == NULL)
+        PANIC ("out of memory for the free extent index");
+      fe->start = start;
+      fe->length = cnt;
+    }
+  index_add (fe);
+}
+
+/* Removes the CNT sectors starting at SECTOR from run FE, which
+   must contain them, splitting FE if they lie in its middle. */
+static void
+index_take (struct free_extent *fe, block_sector_t sector, size_t cnt)
+{
+  block_sector_t end = fe->start + fe->length;
+
+  ASSERT (fe->start <= sector && sector + cnt <= end);
+
+  free_cnt -= cnt;
+  index_remove (fe);
+  if (sector + cnt < end && sector > fe->start)
+    {
+      /* Split: FE keeps the front, a new run gets the back. */
+      struct free_extent *back = malloc (sizeof *back);
+      if (back == NULL)
+        PANIC ("out of memory for the free extent index");
+      back->start = sector + cnt;
+      back->length = end - back->start;
+      index_add (back);
+      fe->length = sector - fe->start;
+      index_add (fe);
+    }
+  else if (sector + cnt < end)
+    {
+      fe->start += cnt;
+      fe->length -= cnt;
+      index_add (fe);
+    }
+  else if (sector > fe->start)
+    {
+      fe->length = sector - fe->start;
+      index_add (fe);
+    }
+  else
+    free (fe);
+}
+
+/* Returns the run that holds GOAL, which must start a block, and
+   sets *AT_GOAL to true; failing that, returns the first run that
+   starts after GOAL, no more than NEAR_WINDOW_BLOCKS past it, and
+   holds CNT sectors, and sets *AT_GOAL to false.  Returns a null
+   pointer if there is neither.
+
+   The bitmap tells which blocks are free, and a free block whose
+   neighbour before it is not in a run starts one, so only the
+   blocks within the window are looked at, however many runs there
+   are elsewhere.  A goal in the middle of a run, which callers
+   that continue a file rarely ask for, is found by walking back to
+   the run's start within the same window. */
+static struct free_extent *
+index_find_near (block_sector_t goal, size_t cnt, bool *at_goal)
+{
+  size_t goal_block = goal / fs_block_sectors;
+  size_t limit = bitmap_size (free_map);
+  size_t block;
+
+  if (limit > goal_block + NEAR_WINDOW_BLOCKS)
+    limit = goal_block + NEAR_WINDOW_BLOCKS;
+
+  *at_goal = true;
+  if (goal_block < limit && !bitmap_test (free_map, goal_block)
+      && !bitmap_test (held, goal_block))
+    {
+      size_t first;
+
+      for (first = goal_block; goal_block - first < NEAR_WINDOW_BLOCKS;
+           first--)
+        {
+          struct free_extent *fe = run_starting_at (first * fs_block_sectors);
+          if (fe != NULL)
+            return fe;
+          if (first == 0)
+            break;
+        }
+    }
+
+  *at_goal = false;
+  for (block = goal_block + 1; block < limit; block++)
+    if (!bitmap_test (free_map, block))
+      {
+        struct free_extent *fe = run_starting_at (block * fs_block_sectors);
+        if (fe != NULL)
+          {
+            if (fe->length >= cnt)
+              return fe;
+            block = (fe->start + fe->length) / fs_block_sectors;
+          }
+      }
+  return NULL;
+}
+
+/* Returns a run of at least CNT sectors from the smallest size
+   class that has one, or a null pointer if there is none. */
+static struct free_extent *
+index_find_fit (size_t cnt)
+{
+  int class;
+  for (class = size_class (cnt); class < SIZE_CLASS_CNT; class++)
+    {
+      struct list_elem *e;
+      for (e = list_begin (&free_by_size[class]);
+           e != list_end (&free_by_size[class]); e = list_next (e))
+        {
+          struct free_extent *fe = list_entry (e, struct free_extent,
+                                               size_elem);
+          if (fe->length >= cnt)
+            return fe;
+        }
+    }
+  return NULL;
+}
+
+/* Returns the largest free run, or a null pointer if the disk is
+   full. */
+static struct free_extent *
+index_find_largest (void)
+{
+  int class;
+  for (class = SIZE_CLASS_CNT - 1; class >= 0; class--)
+    if (!list_empty (&free_by_size[class]))
+      {
+        struct free_extent *largest = NULL;
+        struct list_elem *e;
+        for (e = list_begin (&free_by_size[class]);
+             e != list_end (&free_by_size[class]); e = list_next (e))
+          {
+            struct free_extent *fe = list_entry (e, struct free_extent,
+                                                 size_elem);
+            if (largest == NULL || fe->length > largest->length)
+              largest = fe;
+          }
+        return largest;
+      }
+  return NULL;
 }
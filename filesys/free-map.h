@@ -10,8 +10,18 @@ void free_map_read (void);
 void free_map_create (void);
 void free_map_open (void);
 void free_map_close (void);
+void free_map_flush (void);
+void free_map_unhold (void);
 
 bool free_map_allocate (size_t, block_sector_t *);
+size_t free_map_allocate_near (size_t, block_sector_t goal, block_sector_t *);
+bool free_map_allocate_below (size_t, block_sector_t limit, block_sector_t *);
 void free_map_release (block_sector_t, size_t);
+bool free_map_reserve (size_t);
+void free_map_unreserve (size_t);
+#ifdef FILESYS_EXTEND_FILES
+bool free_map_share (block_sector_t, size_t);
+bool free_map_shared (block_sector_t);
+#endif
 
 #endif /* filesys/free-map.h */
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ustar.h>
+#include "devices/shutdown.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -220,3 +221,37 @@ fsutil_append (char **argv)
   file_close (src);
   free (buffer);
 }
+
+/* Creates file ARGV[2] as a clone of file ARGV[1], sharing its
+   data sectors. */
+void
+fsutil_clone (char **argv)
+{
+  const char *file_name = argv[1];
+  const char *new_name = argv[2];
+
+  printf ("Cloning '%s' to '%s'...\n", file_name, new_name);
+  if (!filesys_clone (file_name, new_name))
+    PANIC ("%s: clone failed", new_name);
+}
+
+/* Moves the data of file ARGV[1], or of every file below directory
+   ARGV[1], into one run per file. */
+void
+fsutil_defrag (char **argv)
+{
+  const char *name = argv[1];
+
+  printf ("Defragmenting '%s'...\n", name);
+  if (!filesys_defrag (name))
+    printf ("%s: some data could not be moved\n", name);
+}
+
+/* Powers off without writing back what the file system holds in
+   memory, so that the next mount has to replay the journal. */
+void
+fsutil_crash (char **argv UNUSED)
+{
+  printf ("Crashing...\n");
+  shutdown_power_fail ();
+}
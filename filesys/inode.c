@@ -1,55 +1,65 @@
 #include "filesys/inode.h"
 #include <list.h>
 #include <debug.h>
+#include <fadvise.h>
+#include <lz.h>
 #include <round.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
+#include "filesys/layout.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 #ifdef FILESYS_USE_CACHE
   #include "filesys/cache.h"
 #endif
-#ifdef FILESYS_SYNC
-  #include "threads/synch.h"
-#endif
 
-/* Identifies an inode. */
-#define INODE_MAGIC 0x494e4f44
 #define NULL_SECTOR 0
-#define INODE_DISK_ARRAY_SIZE 62
-
-//#define FILESYS_USE_CACHE
-//#undef FILESYS
-
-/* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
-struct inode_disk
-{
-#ifdef FILESYS_EXTEND_FILES
-    block_sector_t start[ INODE_DISK_ARRAY_SIZE ];           /* First data sector. */
-    off_t length[ INODE_DISK_ARRAY_SIZE ];                   /* File size in sectors. */
-    off_t file_total_size;              /* total size of the file */
-    block_sector_t next_sector;         /* Address of the next inode_disk */
-    // 504 bytes
-#else
-    block_sector_t start;               /* First data sector. */
-    off_t length;                       /* File size in bytes. */
-    int32_t unused[124];
-    // 504 bytes
-#endif
+#define HOLE_SECTOR ((block_sector_t) -1)  /* Start of an unallocated run. */
+
+/* Data sectors per cluster, the unit a compressed file is
+   compressed in.  Cluster N of the file is data sectors
+   N * CLUSTER_SECTORS onward.  It is stored in three ways: as
+   CLUSTER_SECTORS sectors holding the data as is, if it does not
+   shrink by at least a block; as a hole, if it is all zeros; or
+   as a few sectors holding a 32-bit size and that many bytes of
+   compressed data, followed by a hole to the end of the cluster.
+   A multiple of every file system block size. */
+#define CLUSTER_SECTORS 16
+#define CLUSTER_SIZE (CLUSTER_SECTORS * BLOCK_SECTOR_SIZE)
+
+/* Most sectors of appended data an open inode holds in memory
+   before giving them disk sectors. */
+#define DELALLOC_MAX_SECTORS 64
+
+/* Transfers of at least this many sectors move their whole,
+   aligned sectors between the disk and the caller's buffer
+   directly, instead of through the buffer cache, so that streaming
+   a large file neither evicts the cached metadata nor costs an
+   extra copy per sector. */
+#define DIRECT_IO_MIN_SECTORS 16
+
+/* Sectors inode_copy() moves per step. */
+#define COPY_CHUNK_SECTORS 32
+
+/* Sectors kept queued for the buffer cache ahead of a file read
+   with POSIX_FADV_SEQUENTIAL.  At most COPY_CHUNK_SECTORS, the
+   most prefetch_range() queues at once. */
+#define READ_AHEAD_SECTORS 32
+
+/* Most sectors one POSIX_FADV_WILLNEED fetches, an eighth of the
+   buffer cache, so that a large range does not push out the start
+   of itself before it is read. */
+#define WILLNEED_MAX_SECTORS 32
+
+/* Most sectors allocated past end of file, at a time, for a file
+   that keeps growing. */
+#define PREALLOC_MAX_SECTORS 1024
 
-#ifdef FILESYS_SUBDIRS
-    block_sector_t parent_dir_inode;
-    // 4 bytes
-#else
-    int32_t unused_;
-    // 4 bytes
-#endif
-
-    unsigned magic;                     /* Magic number. */
-    // 4 bytes
-
-};
 #ifdef FILESYS_SYNC
   struct lock global_inode_lock;
 #endif
@@ -61,27 +71,122 @@ struct inode
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
+    bool closing;                       /* Last opener is writing it back. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /* Inode content. */
+    struct rwlock rw;                   /* Shared for I/O within the
+                                           file, exclusive for changes
+                                           to its size or extents. */
+    bool metadata;                      /* Data is journaled like the
+                                           inode itself. */
+    enum cache_class cache_class;       /* What the data is to the
+                                           buffer cache. */
 #ifdef FILESYS_SYNC
     struct lock inode_lock;					/* lock for inode concurrent ops */
 #endif
+#ifdef FILESYS_EXTEND_FILES
+    struct inode_extent *extents;       /* Data extents, in file order. */
+    size_t extent_cnt;                  /* Number of extents in use. */
+    size_t extent_cap;                  /* Number of extents allocated. */
+    size_t sector_cnt;                  /* Data sectors over all extents. */
+    bool extents_dirty;                 /* Extents differ from disk copy. */
+    uint8_t *delalloc;                  /* Appended sectors not yet placed. */
+    size_t delalloc_cnt;                /* Sectors in use in delalloc. */
+    size_t delalloc_cap;                /* Sectors allocated for delalloc. */
+    size_t spec_cnt;                    /* Speculative sectors at the end. */
+    uint8_t *cluster;                   /* Decompressed data of a cluster. */
+    size_t cluster_idx;                 /* Cluster it holds, or SIZE_MAX. */
+    bool cluster_dirty;                 /* Differs from the disk copy. */
+#endif
 
 };
 
 #ifdef FILESYS_EXTEND_FILES
-block_sector_t get_sector( const struct inode_disk* , int );
-struct inode_disk* get_last_inode_disk( struct inode_disk* );
-bool extend_inode( struct inode*, off_t );
-bool try_allocate( struct inode_disk*, size_t );
-void init_disk_inode( struct inode_disk* disk_inode );
-static block_sector_t byte_to_sector (const struct inode *inode, off_t pos, off_t file_size);
+/* A run of contiguous data sectors, or a hole of sectors that were
+   never written and read as zeros, if START is HOLE_SECTOR.  The
+   on-disk inode keeps these as parallel start[] and length[]
+   arrays, chained through next_sector; an open inode keeps all of
+   them in one array so that lookups and growth never have to walk
+   the chain on disk.  Every extent starts on a file system block
+   boundary and covers whole blocks. */
+struct inode_extent
+  {
+    block_sector_t start;               /* First sector of the run. */
+    off_t length;                       /* Length of the run in sectors. */
+  };
+
+static bool extents_load (struct inode *);
+static bool extents_store (struct inode *);
+static bool extents_push (struct inode *, block_sector_t, off_t);
+static block_sector_t extents_lookup (const struct inode *, size_t);
+static void extents_truncate (struct inode *, size_t);
+static bool extents_reserve (struct inode *, size_t);
+static void extents_coalesce (struct inode *);
+static bool extent_continues (const struct inode_extent *, block_sector_t);
+static block_sector_t extents_goal (const struct inode *);
+static block_sector_t extents_fill (struct inode *, size_t);
+static block_sector_t extents_unshare (struct inode *, size_t);
+static block_sector_t extents_remap (struct inode *, size_t,
+                                     const uint8_t *);
+static bool inode_skip (struct inode *, size_t);
+static bool inode_allocate (struct inode *, size_t, const uint8_t *);
+static bool inode_extend (struct inode *, size_t);
+static void inode_speculate (struct inode *);
+static void zero_sectors (struct inode *, size_t, size_t);
+static bool delalloc_grow (struct inode *, size_t);
+static bool delalloc_flush (struct inode *);
+static void delalloc_drop (struct inode *);
+static uint8_t *delalloc_sector (const struct inode *, size_t);
+static void init_disk_inode (struct inode_disk *disk_inode);
+static bool inode_uninline (struct inode *);
+static bool extents_replace (struct inode *, size_t, size_t,
+                             const struct inode_extent *, size_t);
+static off_t share_range (struct inode *, off_t, struct inode *, off_t,
+                          off_t);
+static size_t cluster_real (const struct inode *, size_t);
+static bool cluster_load (struct inode *, size_t);
+static bool cluster_store (struct inode *);
+static void cluster_drop (struct inode *);
+static off_t compressed_read (struct inode *, uint8_t *, off_t, off_t);
+static off_t compressed_write (struct inode *, const uint8_t *, off_t,
+                               off_t);
+static void move_sectors (block_sector_t, block_sector_t, size_t,
+                          uint8_t *);
+#endif
+static bool inode_move (struct inode *, bool compact);
+static void sector_read (block_sector_t, void *, enum cache_class);
+static void meta_write (block_sector_t, const void *, enum cache_class);
+#ifdef FILESYS_EXTEND_FILES
+static void sector_write (block_sector_t, const void *);
+static void data_write (const struct inode *, block_sector_t, const void *);
+#endif
+static off_t read_at (struct inode *, void *, off_t, off_t,
+                      struct inode_advice *);
+static off_t write_at (struct inode *, const void *, off_t, off_t,
+                       const struct inode_advice *);
+static bool write_is_exclusive (const struct inode *, off_t, off_t);
+static void meta_written (struct inode *);
+static void read_lock (struct inode *);
+static void read_unlock (struct inode *);
+#ifdef FILESYS_USE_CACHE
+static int range_sectors (const struct inode *, off_t, off_t, sid_t *);
+static size_t direct_run (const struct inode *, block_sector_t, off_t,
+                          off_t, off_t, bool);
+static void prefetch_range (const struct inode *, off_t, off_t);
+static void read_ahead (struct inode *, struct inode_advice *, off_t);
+static int cache_hints (const struct inode *, int advice);
+static bool owns_sector (sid_t, void *);
 #endif
+static bool flush_data (struct inode *);
+static bool flush_meta (struct inode *);
+static bool meta_changed (struct inode *);
+static bool write_back (struct inode *, bool data_only, bool *commit);
 
-/* Returns the number of sectors to allocate for an inode SIZE bytes long. */
+/* Returns the number of sectors to allocate for an inode SIZE bytes
+   long, which is always a whole number of file system blocks. */
 static inline size_t bytes_to_sectors (off_t size)
 {
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+  return ROUND_UP (DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE), fs_block_sectors);
 }
 
 /* Returns the block device sector that contains byte offset POS
@@ -94,8 +199,8 @@ byte_to_sector (const struct inode *inode, off_t pos, off_t file_size)
   ASSERT (inode != NULL);
 
 #ifdef FILESYS_EXTEND_FILES
-  if (pos <= file_size) // length holds the total size of the file
-    return get_sector( &inode->data, pos / BLOCK_SECTOR_SIZE );
+  if (pos < file_size) // length holds the total size of the file
+    return extents_lookup (inode, pos / BLOCK_SECTOR_SIZE);
 #else
   if (pos < inode->data.length) // length holds the total size of the file
   	return inode->data.start + pos / BLOCK_SECTOR_SIZE;
@@ -108,12 +213,23 @@ byte_to_sector (const struct inode *inode, off_t pos, off_t file_size)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and the open counts of its inodes.  Held
+   while an inode is read in, so that nobody opens a copy of an
+   inode that is half loaded.  An inode being written back by its
+   last close stays on the list, marked closing, without it. */
+static struct lock open_inodes_lock;
+
+/* Signaled when a closing inode leaves open_inodes. */
+static struct condition inode_closed;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   printf("Initializing INODE\n");
   list_init (&open_inodes);
+  lock_init (&open_inodes_lock);
+  cond_init (&inode_closed);
 }
 
 /**
@@ -138,55 +254,78 @@ bool inode_create (block_sector_t sector, off_t length)
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
+  journal_begin ();
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
   {
       size_t sectors = bytes_to_sectors (length);
+#ifndef FILESYS_EXTEND_FILES
+      bool allocated;
+#endif
 
 #ifdef FILESYS_SUBDIRS
       disk_inode->parent_dir_inode = parent_sector;
 #endif
 
 #ifdef FILESYS_EXTEND_FILES
+      /* Write out an empty inode, then grow it the same way a
+         write past end of file does, so that its data lands right
+         after the inode sector whenever there is room. */
       init_disk_inode( disk_inode );
-      disk_inode->file_total_size = length;
-      disk_inode->length[0] = sectors;
-      if (free_map_allocate (sectors, &disk_inode->start[0]))
+      if (length <= (off_t) INODE_INLINE_SIZE)
+        {
+          /* Small files and directories are kept in the inode
+             sector, which saves a data sector and a disk read. */
+          disk_inode->flags = INODE_INLINE;
+          disk_inode->file_total_size = length;
+        }
+      meta_write (sector, disk_inode, CACHE_INODE);
+      success = true;
+      if (!(disk_inode->flags & INODE_INLINE))
+        {
+          struct inode *inode = inode_open (sector);
+          success = inode != NULL && inode_allocate (inode, sectors, NULL);
+          if (success)
+            {
+              zero_sectors (inode, 0, sectors);
+              inode->data.file_total_size = length;
+            }
+          inode_close (inode);
+        }
 #else
 	  disk_inode->magic = INODE_MAGIC;
       disk_inode->length = length;
-      if (free_map_allocate (sectors, &disk_inode->start))
-#endif
+      if (length <= (off_t) INODE_INLINE_SIZE)
+        {
+          /* Small files and directories are kept in the inode
+             sector, which saves a data sector and a disk read. */
+          disk_inode->flags = INODE_INLINE;
+          sectors = 0;
+          allocated = true;
+        }
+      else
+        allocated = free_map_allocate (sectors, &disk_inode->start);
+      if (allocated)
         {
-	#ifdef FILESYS_USE_CACHE
-    	  cache_write(sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
-	#else
-          block_write (fs_device, sector, disk_inode);
-	#endif
+          meta_write (sector, disk_inode, CACHE_INODE);
           if (sectors > 0) 
             {
               static char zeros[BLOCK_SECTOR_SIZE];
               size_t i;
               
               for (i = 0; i < sectors; i++) 
-  #ifdef FILESYS_EXTEND_FILES
-		#ifdef FILESYS_USE_CACHE
-            	cache_write(disk_inode->start[0] + i, zeros, 0, BLOCK_SECTOR_SIZE );
-		#else
-                block_write (fs_device, disk_inode->start[0] + i, zeros);
-		#endif
-  #else
     #ifdef FILESYS_USE_CACHE
               cache_write(disk_inode->start + i, zeros, 0, BLOCK_SECTOR_SIZE );
     #else
                 block_write (fs_device, disk_inode->start + i, zeros);
     #endif
-  #endif
             }
           success = true; 
         } 
+#endif
       free (disk_inode);
   }
+  journal_end ();
 
   return success;
 }
@@ -201,15 +340,25 @@ inode_open (block_sector_t sector)
   struct inode *inode;
 
   // printf("[i] opening for sector %d\n", sector);
+  lock_acquire (&open_inodes_lock);
+
   /* Check whether this inode is already open. */
+ retry:
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
     {
       inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
+          if (inode->closing)
+            {
+              /* Read it back in once it is on disk. */
+              cond_wait (&inode_closed, &open_inodes_lock);
+              goto retry;
+            }
           // printf("[i] reopening for sector %d\n", sector);
-          inode_reopen (inode);
+          inode->open_cnt++;
+          lock_release (&open_inodes_lock);
           return inode; 
         }
     }
@@ -217,7 +366,10 @@ inode_open (block_sector_t sector)
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
@@ -225,14 +377,34 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->closing = false;
+  inode->metadata = false;
+  inode->cache_class = CACHE_DATA;
+  rwlock_init (&inode->rw, RWLOCK_PREFER_WRITERS);
 #ifdef FILESYS_SYNC
   lock_init(&inode->inode_lock);
 #endif
 #ifdef FILESYS_USE_CACHE
-  cache_read(inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+  cache_read_hint (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE,
+                   CACHE_HINT_CLASS (CACHE_INODE));
 #else
   block_read (fs_device, inode->sector, &inode->data);
 #endif
+#ifdef FILESYS_EXTEND_FILES
+  inode->delalloc = NULL;
+  inode->delalloc_cnt = inode->delalloc_cap = 0;
+  inode->spec_cnt = 0;
+  inode->cluster = NULL;
+  inode->cluster_idx = SIZE_MAX;
+  inode->cluster_dirty = false;
+  if (!extents_load (inode))
+    {
+      list_remove (&inode->elem);
+      free (inode);
+      inode = NULL;
+    }
+#endif
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -241,7 +413,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -268,50 +444,75 @@ inode_close (struct inode *inode)
   if (inode == NULL)
     return;
 
-  /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  journal_begin ();
+  lock_acquire (&open_inodes_lock);
+  if (--inode->open_cnt > 0)
     {
-      /* Remove from inode list and release lock. */
-#ifndef FILESYS_USE_CACHE
-      block_write( fs_device, inode->sector, &inode->data );
-#else
-      cache_write(inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE );
-#endif
-      list_remove (&inode->elem);
- 
-      /* Deallocate blocks if removed. */
-      if (inode->removed) 
-        {
-          free_map_release (inode->sector, 1);
-#ifdef FILESYS_EXTEND_FILES
-          struct inode_disk disk_inode = inode->data;
-          //Release for every inode_disk
+      lock_release (&open_inodes_lock);
+      journal_end ();
+      return;
+    }
 
-          size_t contor = 0;
-          while ( disk_inode.start[contor] != NULL_SECTOR )
-          {
-             //First it release every data sector from inode
-             free_map_release ( disk_inode.start[contor], disk_inode.length[contor] );
-             contor++;
-             if ( contor == INODE_DISK_ARRAY_SIZE )
-             {
-              contor = 0;
-              //If contor reach the size of the array
-              //Then read next_sector
-#ifndef FILESYS_USE_CACHE
-              block_read( fs_device, disk_inode.next_sector, &disk_inode );
-#else
-              cache_read( disk_inode.next_sector, &disk_inode, 0, BLOCK_SECTOR_SIZE );
-#endif
-             }
-          }
-#else
-          free_map_release (inode->data.start, bytes_to_sectors (inode->data.length));
+  /* This was the last opener.  Writing INODE back may allocate,
+     compress and write a lot of data, so it is done under INODE's
+     own lock only; whoever opens INODE meanwhile waits for it to
+     leave the list and reads it back in. */
+  inode->closing = true;
+  lock_release (&open_inodes_lock);
+  rwlock_acquire_write (&inode->rw);
+#ifdef FILESYS_EXTEND_FILES
+  /* A removed inode gives back its data sectors here; storing
+     the then empty extent list releases the chain sectors.
+     Otherwise delayed data gets its sectors now, when the
+     file's final size is known. */
+  if (inode->removed)
+    {
+      free_map_unreserve (inode->delalloc_cnt);
+      inode->delalloc_cnt = 0;
+      extents_truncate (inode, 0);
+    }
+  else
+    {
+      /* Give back speculative sectors the file did not grow
+         into.  A compressed file keeps whole clusters. */
+      size_t keep = bytes_to_sectors (inode_length (inode));
+      if (inode->data.flags & INODE_COMPRESSED)
+        keep = ROUND_UP (keep, CLUSTER_SECTORS);
+      if (keep < inode->sector_cnt - inode->spec_cnt)
+        keep = inode->sector_cnt - inode->spec_cnt;
+      if (!cluster_store (inode))
+        cluster_drop (inode);
+      if (!delalloc_flush (inode))
+        delalloc_drop (inode);
+      extents_truncate (inode, keep);
+    }
+  if (inode->extents_dirty)
+    extents_store (inode);
+  free (inode->cluster);
+  free (inode->delalloc);
+  free (inode->extents);
 #endif
-        }
+  meta_write (inode->sector, &inode->data, CACHE_INODE);
 
-      free (inode); 
+  /* Deallocate blocks if removed. */
+  if (inode->removed) 
+    {
+      free_map_release (inode->sector, 1);
+#ifndef FILESYS_EXTEND_FILES
+      if (!(inode->data.flags & INODE_INLINE))
+        free_map_release (inode->data.start,
+                          bytes_to_sectors (inode->data.length));
+#endif
     }
+  rwlock_release_write (&inode->rw);
+
+  /* Remove from inode list. */
+  lock_acquire (&open_inodes_lock);
+  list_remove (&inode->elem);
+  cond_broadcast (&inode_closed, &open_inodes_lock);
+  lock_release (&open_inodes_lock);
+  free (inode); 
+  journal_end ();
 }
 
 int inode_open_cnt(struct inode *inode) {
@@ -329,14 +530,98 @@ inode_remove (struct inode *inode)
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
-   than SIZE if an error occurs or end of file is reached. */
+   than SIZE if an error occurs or end of file is reached.
+   Any number of reads and in-place writes of INODE may run at
+   once. */
+off_t
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset)
+{
+  return inode_read_advised (inode, buffer, size, offset, NULL);
+}
+
+/* Like inode_read_at(), for an opener that has given ADVICE on how
+   it reads INODE's data, or a null pointer for none. */
 off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
+inode_read_advised (struct inode *inode, void *buffer, off_t size,
+                    off_t offset, struct inode_advice *advice)
+{
+  off_t bytes_read;
+
+  read_lock (inode);
+  bytes_read = read_at (inode, buffer, size, offset, advice);
+  read_unlock (inode);
+  return bytes_read;
+}
+
+/* Acquires INODE's lock for reading its data: shared, except for a
+   compressed file, whose reads go through its one decompressed
+   cluster and so must have INODE to themselves.  Such a read may
+   write back the cluster it replaces, so it is a journal operation
+   as well.  A file only ever becomes compressed with the lock held
+   exclusively, and never stops being compressed, so checking once
+   the shared lock is held is enough. */
+static void
+read_lock (struct inode *inode)
+{
+  rwlock_acquire_read (&inode->rw);
+#ifdef FILESYS_EXTEND_FILES
+  if (inode->data.flags & INODE_COMPRESSED)
+    {
+      rwlock_release_read (&inode->rw);
+      journal_begin ();
+      rwlock_acquire_write (&inode->rw);
+    }
+#endif
+}
+
+/* Releases INODE's lock acquired by read_lock(). */
+static void
+read_unlock (struct inode *inode)
+{
+#ifdef FILESYS_EXTEND_FILES
+  if (inode->data.flags & INODE_COMPRESSED)
+    {
+      rwlock_release_write (&inode->rw);
+      journal_end ();
+      return;
+    }
+#endif
+  rwlock_release_read (&inode->rw);
+}
+
+/* Does the work of inode_read_advised() with INODE's lock held. */
+static off_t
+read_at (struct inode *inode, void *buffer_, off_t size, off_t offset,
+         struct inode_advice *advice UNUSED)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
 #ifndef FILESYS_USE_CACHE
   uint8_t *bounce = NULL;
+#else
+  int pattern = advice != NULL ? advice->advice : POSIX_FADV_NORMAL;
+  /* Data used only once does not go into the cache at all.
+     Metadata always does, as the cache keeps it with the
+     journal. */
+  bool direct = (!inode->metadata
+                 && (size >= DIRECT_IO_MIN_SECTORS * BLOCK_SECTOR_SIZE
+                     || pattern == POSIX_FADV_NOREUSE));
+  int hints = cache_hints (inode, pattern);
+#endif
+
+  if (inode->data.flags & INODE_INLINE)
+    {
+      off_t inode_left = inode_length (inode) - offset;
+      if (inode_left <= 0)
+        return 0;
+      if (size > inode_left)
+        size = inode_left;
+      memcpy (buffer, inode->data.inline_data + offset, size);
+      return size;
+    }
+#ifdef FILESYS_EXTEND_FILES
+  if (inode->data.flags & INODE_COMPRESSED)
+    return compressed_read (inode, buffer, size, offset);
 #endif
 
   while (size > 0) 
@@ -355,6 +640,14 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
+#ifdef FILESYS_EXTEND_FILES
+      uint8_t *pending = delalloc_sector (inode, offset / BLOCK_SECTOR_SIZE);
+      if (pending != NULL)
+        memcpy (buffer + bytes_read, pending + sector_ofs, chunk_size);
+      else if (sector_idx == HOLE_SECTOR)
+        memset (buffer + bytes_read, 0, chunk_size);
+      else
+#endif
 #ifndef FILESYS_USE_CACHE
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
@@ -376,7 +669,16 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
           memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
 #else
-      cache_read(sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
+      if (direct && chunk_size == BLOCK_SECTOR_SIZE)
+        {
+          size_t cnt = direct_run (inode, sector_idx, offset, size,
+                                   inode_length (inode), false);
+          cache_read_direct (sector_idx, cnt, buffer + bytes_read);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
+        }
+      else
+        cache_read_hint (sector_idx, buffer + bytes_read, sector_ofs,
+                         chunk_size, hints);
 #endif
 
       
@@ -387,6 +689,9 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
     }
 #ifndef FILESYS_USE_CACHE
   free (bounce);
+#else
+  if (pattern == POSIX_FADV_SEQUENTIAL && bytes_read > 0)
+    read_ahead (inode, advice, offset);
 #endif
 
   return bytes_read;
@@ -395,45 +700,172 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
    less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   With FILESYS_EXTEND_FILES a write past end of file extends the
+   inode instead.
+   A write that stays within the file shares INODE with reads and
+   other such writes; one that extends the file or fills a hole
+   has it to itself. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
-                off_t offset) 
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+                off_t offset)
+{
+  return inode_write_advised (inode, buffer, size, offset, NULL);
+}
+
+/* Like inode_write_at(), for an opener that has given ADVICE on
+   how it uses INODE's data, or a null pointer for none. */
+off_t
+inode_write_advised (struct inode *inode, const void *buffer, off_t size,
+                     off_t offset, const struct inode_advice *advice)
+{
+  off_t bytes_written;
+
+  journal_begin ();
+  rwlock_acquire_read (&inode->rw);
+  if (!write_is_exclusive (inode, size, offset))
+    {
+      bytes_written = write_at (inode, buffer, size, offset, advice);
+      rwlock_release_read (&inode->rw);
+      journal_end ();
+      return bytes_written;
+    }
+  rwlock_release_read (&inode->rw);
+
+  /* The size and extents can only have grown meanwhile, which
+     does not hurt a write that holds the lock exclusively. */
+  rwlock_acquire_write (&inode->rw);
+  bytes_written = write_at (inode, buffer, size, offset, advice);
+  rwlock_release_write (&inode->rw);
+  journal_end ();
+  return bytes_written;
+}
+
+/* Returns true if writing SIZE bytes at OFFSET in INODE changes
+   more than the data, so that the writer must hold INODE's lock
+   exclusively: it grows the file, fills a hole, or has to copy a
+   sector shared with a clone first.  Without the buffer cache, partial sector writes
+   are read-modify-write cycles on a private bounce buffer, so
+   they cannot share the lock either.  Nor can any write to a
+   compressed file, which goes through its decompressed cluster. */
+static bool
+write_is_exclusive (const struct inode *inode, off_t size, off_t offset)
+{
+#ifdef FILESYS_EXTEND_FILES
+  size_t n;
+#endif
+
+  if (offset + size > inode_length (inode))
+    return true;
+#ifndef FILESYS_USE_CACHE
+  if (offset % BLOCK_SECTOR_SIZE != 0 || size % BLOCK_SECTOR_SIZE != 0)
+    return true;
+#endif
+#ifdef FILESYS_EXTEND_FILES
+  if (inode->data.flags & INODE_COMPRESSED)
+    return true;
+  if (!(inode->data.flags & INODE_INLINE) && size > 0)
+    for (n = offset / BLOCK_SECTOR_SIZE;
+         n <= (size_t) (offset + size - 1) / BLOCK_SECTOR_SIZE; n++)
+      {
+        block_sector_t sector = extents_lookup (inode, n);
+        if (sector == HOLE_SECTOR
+            || (sector != NULL_SECTOR && free_map_shared (sector)))
+          return true;
+      }
+#endif
+  return false;
+}
+
+/* Does the work of inode_write_advised() with INODE's lock held. */
+static off_t
+write_at (struct inode *inode, const void *buffer_, off_t size,
+          off_t offset, const struct inode_advice *advice UNUSED)
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
 #ifndef FILESYS_USE_CACHE
   uint8_t *bounce = NULL;
+#else
+  int pattern = advice != NULL ? advice->advice : POSIX_FADV_NORMAL;
+  bool direct = (size >= DIRECT_IO_MIN_SECTORS * BLOCK_SECTOR_SIZE
+                 || pattern == POSIX_FADV_NOREUSE);
+  int hints = cache_hints (inode, pattern);
 #endif
 
   if (inode->deny_write_cnt)
     return 0;
 
-      //Updates the size of file and the length of the data sector
+  if (inode->data.flags & INODE_INLINE)
+    {
+#ifdef FILESYS_EXTEND_FILES
+      off_t inline_end = INODE_INLINE_SIZE;
+#else
+      off_t inline_end = inode_length (inode);
+#endif
+      if (offset + size <= inline_end)
+        {
+          if (size <= 0)
+            return 0;
+          memcpy (inode->data.inline_data + offset, buffer, size);
+#ifdef FILESYS_EXTEND_FILES
+          if (offset + size > inode->data.file_total_size)
+            inode->data.file_total_size = offset + size;
+#endif
+          meta_written (inode);
+          return size;
+        }
 #ifdef FILESYS_EXTEND_FILES
-    // If the inode doesn't contains the sector
-    off_t file_size = inode->data.file_total_size;
+      /* The file outgrows the inode sector: move its data out to
+         a data sector and carry on as a regular file. */
+      if (!inode_uninline (inode))
+        return 0;
+#else
+      /* Files cannot grow; write up to end of file. */
+      if (offset >= inline_end)
+        return 0;
+      size = inline_end - offset;
+      memcpy (inode->data.inline_data + offset, buffer, size);
+      meta_written (inode);
+      return size;
+#endif
+    }
+
+#ifdef FILESYS_EXTEND_FILES
+  if (inode->data.flags & INODE_COMPRESSED)
+    return compressed_write (inode, buffer, size, offset);
 
-    off_t end = offset + size;
-    off_t start = file_size;
-    volatile int gap = end - start;
+  /* Make room for any sectors the write needs past end of file
+     before writing, so that the loop below always has a sector,
+     possibly a delayed one, to fill. */
+  off_t file_size = inode->data.file_total_size;
+  bool grow = offset + size > file_size;
 
-    if ( gap > 0 )
-    {
-	#ifdef FILESYS_SYNC
-    	lock_acquire(&inode->inode_lock);
-	#endif
+  /* Sectors from here on may have been allocated ahead of time and
+     never written, so they hold whatever was on disk before.  That
+     includes the rest of the block holding end of file. */
+  size_t fresh = DIV_ROUND_UP (file_size, BLOCK_SECTOR_SIZE);
 
-      //printf( "Gap larger then 0\n");
-        if ( !extend_inode( inode, gap ) )
+  if (grow)
+    {
+#ifdef FILESYS_SYNC
+      lock_acquire(&inode->inode_lock);
+#endif
+      if (!inode_skip (inode, offset / BLOCK_SECTOR_SIZE)
+          || !inode_extend (inode, bytes_to_sectors (offset + size)))
         {
-		#ifdef FILESYS_SYNC
-			lock_release(&inode->inode_lock);
-		#endif
+#ifdef FILESYS_SYNC
+          lock_release(&inode->inode_lock);
+#endif
           return 0;
         }
-        file_size += gap;
+      file_size = offset + size;
+
+      /* Sectors skipped over between the old end of file and
+         OFFSET become part of the file, so they must read as zeros.
+         Most of them are a hole by now; only sectors allocated
+         ahead of time need zeroing. */
+      if ((size_t) offset / BLOCK_SECTOR_SIZE > fresh)
+        zero_sectors (inode, fresh, offset / BLOCK_SECTOR_SIZE - fresh);
     }
 #endif
 
@@ -462,6 +894,28 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
+#ifdef FILESYS_EXTEND_FILES
+      uint8_t *pending = delalloc_sector (inode, offset / BLOCK_SECTOR_SIZE);
+      if (sector_idx == HOLE_SECTOR)
+        {
+          sector_idx = extents_fill (inode, offset / BLOCK_SECTOR_SIZE);
+          if (sector_idx == NULL_SECTOR)
+            break;
+        }
+      else if (pending == NULL && free_map_shared (sector_idx))
+        {
+          /* Copy on write: the sector also belongs to a clone. */
+          sector_idx = extents_unshare (inode, offset / BLOCK_SECTOR_SIZE);
+          if (sector_idx == NULL_SECTOR)
+            break;
+        }
+      else if (pending == NULL && (size_t) offset / BLOCK_SECTOR_SIZE >= fresh
+               && chunk_size < BLOCK_SECTOR_SIZE)
+        zero_sectors (inode, offset / BLOCK_SECTOR_SIZE, 1);
+      if (pending != NULL)
+        memcpy (pending + sector_ofs, buffer + bytes_written, chunk_size);
+      else
+#endif
 #ifndef FILESYS_USE_CACHE
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
@@ -490,7 +944,24 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
           block_write (fs_device, sector_idx, bounce);
         }
 #else
-      cache_write(sector_idx, buffer + bytes_written, sector_ofs, chunk_size);
+      if (inode->metadata)
+        cache_write_meta (sector_idx, buffer + bytes_written, sector_ofs,
+                          chunk_size, hints);
+      else if (direct && chunk_size == BLOCK_SECTOR_SIZE)
+        {
+#ifdef FILESYS_EXTEND_FILES
+          size_t cnt = direct_run (inode, sector_idx, offset, size,
+                                   file_size, true);
+#else
+          size_t cnt = direct_run (inode, sector_idx, offset, size,
+                                   inode_length (inode), true);
+#endif
+          cache_write_direct (sector_idx, cnt, buffer + bytes_written);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
+        }
+      else
+        cache_write_hint (sector_idx, buffer + bytes_written, sector_ofs,
+                          chunk_size, hints);
 #endif
       /* Advance. */
       size -= chunk_size;
@@ -503,225 +974,1979 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 #endif
 
 #ifdef FILESYS_EXTEND_FILES
-  if(gap > 0)
-  {
-	  inode->data.file_total_size += gap;
-	#ifdef FILESYS_SYNC
-    	lock_release(&inode->inode_lock);
-	#endif
-  }
+  if (grow)
+    {
+      if (offset > inode->data.file_total_size)
+        inode->data.file_total_size = offset;
+      meta_written (inode);
+#ifdef FILESYS_SYNC
+      lock_release(&inode->inode_lock);
+#endif
+    }
 #endif
 
   return bytes_written;
 }
 
-/* Disables writes to INODE.
-   May be called at most once per inode opener. */
-void
-inode_deny_write (struct inode *inode) 
-{
-  inode->deny_write_cnt++;
-  ASSERT (inode->deny_write_cnt <= inode->open_cnt);
-}
-
-/* Re-enables writes to INODE.
-   Must be called once by each inode opener who has called
-   inode_deny_write() on the inode, before closing the inode. */
-void
-inode_allow_write (struct inode *inode) 
+/* Journals what a write to INODE changed in its inode sector and
+   extents, with any delayed sectors placed first, if INODE holds
+   metadata such as a directory.  Its data goes to the journal
+   with the rest of the write, which must not refer to an inode
+   that never gets there; an inode that stays open, like the root
+   directory, would otherwise keep inline data or growth in memory
+   until it is closed.  A regular file's are written when it is
+   synced or closed. */
+static void
+meta_written (struct inode *inode)
 {
-  ASSERT (inode->deny_write_cnt > 0);
-  ASSERT (inode->deny_write_cnt <= inode->open_cnt);
-  inode->deny_write_cnt--;
+  if (!inode->metadata)
+    return;
+#ifdef FILESYS_EXTEND_FILES
+  if (!delalloc_flush (inode))
+    return;
+#endif
+  flush_meta (inode);
 }
 
-/* Returns the length, in bytes, of INODE's data. */
+/* Copies SIZE bytes of SRC, starting at SRC_OFS, into DST at
+   DST_OFS, entirely inside the kernel.  Where both offsets start a
+   block, the whole blocks of SRC are shared with DST instead of
+   copied, as by inode_clone().  The rest goes through a kernel
+   buffer COPY_CHUNK_SECTORS sectors at a time; with the buffer
+   cache, the source sectors of each chunk are fetched in the
+   background while the chunk before is being written.  The two
+   ranges must not overlap if SRC and DST are the same inode.
+   Returns the number of bytes copied, which may be less than SIZE
+   at end of SRC or if an error occurs. */
 off_t
-inode_length (const struct inode *inode)
+inode_copy (struct inode *dst, off_t dst_ofs, struct inode *src,
+            off_t src_ofs, off_t size)
 {
+  const off_t chunk_max = COPY_CHUNK_SECTORS * BLOCK_SECTOR_SIZE;
+  uint8_t *buffer;
+  off_t copied = 0;
+
+  ASSERT (dst != src || src_ofs + size <= dst_ofs
+          || dst_ofs + size <= src_ofs);
+
 #ifdef FILESYS_EXTEND_FILES
-	return inode->data.file_total_size;
-#else
-	return inode->data.length;
+  copied = share_range (dst, dst_ofs, src, src_ofs, size);
+  src_ofs += copied;
+  dst_ofs += copied;
+  size -= copied;
+  if (size == 0)
+    return copied;
 #endif
-}
 
+  buffer = malloc (chunk_max);
+  if (buffer == NULL)
+    return copied;
 
+  while (size > 0)
+    {
+      /* Keep the writes to DST sector aligned after the first, so
+         that they replace whole cached sectors. */
+      off_t chunk = chunk_max - dst_ofs % BLOCK_SECTOR_SIZE;
+      off_t bytes_read, bytes_written;
 
-#ifdef FILESYS_EXTEND_FILES
+      if (chunk > size)
+        chunk = size;
 
-void copy_inode_disk(struct inode_disk *to, const struct inode_disk *from)
-{
-	int i = 0;
-	for( ; i < INODE_DISK_ARRAY_SIZE; ++i) {
-		to->start[i] = from->start[i];
-		to->length[i] = from->length[i];
-	}
-	to->file_total_size = from->file_total_size;
-	to->next_sector = from->next_sector;
-	to->magic = from->magic;
+      read_lock (src);
+      bytes_read = read_at (src, buffer, chunk, src_ofs, NULL);
+#ifdef FILESYS_USE_CACHE
+      if (bytes_read == chunk)
+        prefetch_range (src, src_ofs + chunk,
+                        size - chunk < chunk_max ? size - chunk : chunk_max);
+#endif
+      read_unlock (src);
+      if (bytes_read <= 0)
+        break;
+
+      bytes_written = inode_write_at (dst, buffer, bytes_read, dst_ofs);
+      copied += bytes_written;
+      if (bytes_written < chunk)
+        break;
+      src_ofs += chunk;
+      dst_ofs += chunk;
+      size -= chunk;
+    }
+
+  free (buffer);
+  return copied;
 }
 
-/* Returns the n sector */
-block_sector_t get_sector( const struct inode_disk* disk_inode, int n )
+#ifdef FILESYS_USE_CACHE
+/* Stores in SECTORS, which has room for COPY_CHUNK_SECTORS, the
+   disk sectors behind the first COPY_CHUNK_SECTORS sectors of the
+   SIZE bytes of INODE starting at OFFSET.  Holes and sectors not
+   on disk yet are left out.  Returns the number stored.  INODE's
+   lock must be held. */
+static int
+range_sectors (const struct inode *inode, off_t offset, off_t size,
+               sid_t *sectors)
 {
- struct inode_disk* aux = calloc( 1, sizeof * disk_inode );
- copy_inode_disk(aux, disk_inode);
+  off_t length = inode_length (inode);
+  size_t n, end;
+  int cnt = 0;
 
- int contor = 0;
+  if (inode->data.flags & INODE_INLINE || size <= 0 || offset >= length)
+    return 0;
+#ifdef FILESYS_EXTEND_FILES
+  /* The sectors of a compressed file do not map to its bytes. */
+  if (inode->data.flags & INODE_COMPRESSED)
+    return 0;
+#endif
+  if (offset + size > length)
+    size = length - offset;
 
- while ( aux->length[contor] < n )
- {
-    //In case it reach a sector that don't store any address
-    //Then n is greater then the hole file
-    if ( aux->start[contor] == NULL_SECTOR )
+  end = bytes_to_sectors (offset + size);
+  for (n = offset / BLOCK_SECTOR_SIZE; n < end && cnt < COPY_CHUNK_SECTORS;
+       n++)
     {
-      free(aux);
-      return NULL_SECTOR;
+      block_sector_t sector;
+#ifdef FILESYS_EXTEND_FILES
+      if (delalloc_sector (inode, n) != NULL)
+        continue;
+#endif
+      sector = byte_to_sector (inode, n * BLOCK_SECTOR_SIZE, length);
+      if (sector != HOLE_SECTOR)
+        sectors[cnt++] = sector;
     }
+  return cnt;
+}
 
-    if ( contor < INODE_DISK_ARRAY_SIZE )
-    {
-      //If doesn't reach the last data sector from inode_disk
-      n -= aux->length[contor];
-      contor++;
-    }
-    else
+/* Returns the number of whole sectors of INODE, the first of them
+   SECTOR at byte OFFSET, that follow each other on disk within the
+   next SIZE bytes and the FILE_SIZE bytes of the file, so that a
+   transfer that bypasses the cache can move them as one request.
+   A delayed sector or a hole ends the run, and so does a sector
+   shared with a clone if WRITING. */
+static size_t
+direct_run (const struct inode *inode, block_sector_t sector, off_t offset,
+            off_t size, off_t file_size, bool writing UNUSED)
+{
+  size_t cnt = 1;
+
+  ASSERT (offset % BLOCK_SECTOR_SIZE == 0);
+  while ((off_t) (cnt + 1) * BLOCK_SECTOR_SIZE <= size
+         && offset + (off_t) (cnt + 1) * BLOCK_SECTOR_SIZE <= file_size)
     {
-      //In case it pass over all data sector, it starts to read from next inode_disk
-      contor = 0;
-#ifndef FILESYS_USE_CACHE
-      block_read( fs_device, aux->next_sector, aux );
-#else
-      cache_read( aux->next_sector, aux, 0, BLOCK_SECTOR_SIZE );
+      off_t pos = offset + cnt * BLOCK_SECTOR_SIZE;
+      if (byte_to_sector (inode, pos, file_size) != sector + cnt)
+        break;
+#ifdef FILESYS_EXTEND_FILES
+      if (delalloc_sector (inode, pos / BLOCK_SECTOR_SIZE) != NULL
+          || (writing && free_map_shared (sector + cnt)))
+        break;
 #endif
+      cnt++;
     }
- }
-
- // In case it doesn't contains any data
- if ( aux->start[contor] != NULL_SECTOR )
- {
-    block_sector_t sector =  aux->start[contor] + n;
-    free(aux);
-    return sector;
- }
- else
- {
-	 free(aux);
-    return NULL_SECTOR;
- }
+  return cnt;
 }
 
-/* Get last inode_disk */
-struct inode_disk* get_last_inode_disk( struct inode_disk* disk_inode )
+/* Queues the data sectors behind SIZE bytes of INODE, starting at
+   OFFSET, to be read into the buffer cache.  INODE's lock must be
+   held. */
+static void
+prefetch_range (const struct inode *inode, off_t offset, off_t size)
 {
-  struct inode_disk aux;
+  sid_t sectors[COPY_CHUNK_SECTORS];
+  int cnt = range_sectors (inode, offset, size, sectors);
 
-  while ( disk_inode->next_sector != NULL_SECTOR )
-  {
+  if (cnt > 0)
+    cache_prefetch (sectors, cnt);
+}
 
-#ifndef FILESYS_USE_CACHE
-    block_read( fs_device, disk_inode->next_sector, &aux );
-#else
-    cache_read( disk_inode->next_sector, &aux, 0, BLOCK_SECTOR_SIZE );
-#endif
-    disk_inode = &aux;
-  }
+/* Keeps READ_AHEAD_SECTORS sectors of INODE past OFFSET, where a
+   sequential read by the opener that gave ADVICE just ended,
+   queued for the buffer cache.  The window is topped up once the
+   reader is halfway through it, and starts over after a seek.
+   Threads sharing an open file may race on ADVICE->ahead; the
+   worst that happens is a slot queued twice or a little late. */
+static void
+read_ahead (struct inode *inode, struct inode_advice *advice, off_t offset)
+{
+  const off_t window = READ_AHEAD_SECTORS * BLOCK_SECTOR_SIZE;
+  off_t ahead = advice->ahead;
 
-  return disk_inode;
+  if (ahead < offset || ahead > offset + window)
+    ahead = offset;
+  if (ahead - offset < window / 2)
+    {
+      prefetch_range (inode, ahead, offset + window - ahead);
+      ahead = offset + window;
+    }
+  advice->ahead = ahead;
 }
 
-bool extend_inode( struct inode* inode, off_t gap )
+/* Returns the CACHE_* hints for reading and writing INODE's data
+   through the buffer cache, for an opener whose access pattern is
+   ADVICE. */
+static int
+cache_hints (const struct inode *inode, int advice)
 {
-  ASSERT( gap > 0);
-  //Get the last of disk_inode because this disk_inode should 
-  //store the new sectors that would be added.
-  struct inode_disk* last_disk_inode = get_last_inode_disk( &inode->data );
-  //Add the new sectors, in case the disk_inode consume all
-  //the sectors, try_allocate also creates a new disk_inode and
-  //stores the remain data in it and connect the sectors.
-  volatile off_t file_size = inode->data.file_total_size;
-  volatile off_t sector_ofs = file_size % BLOCK_SECTOR_SIZE;
-  volatile off_t sectors = DIV_ROUND_UP( sector_ofs + gap, BLOCK_SECTOR_SIZE );
-  if(sector_ofs > 0)
-	  sectors --;
-  //printf( "Sectors %d \n", sectors );
-  return sectors > 0 ? try_allocate( last_disk_inode, sectors ) : true;
-}
+  int hints = CACHE_HINT_CLASS (inode->cache_class);
 
+  switch (advice)
+    {
+    case POSIX_FADV_RANDOM:
+      return hints | CACHE_NO_READ_AHEAD;
+    case POSIX_FADV_NOREUSE:
+      return hints | CACHE_COLD;
+    default:
+      return hints;
+    }
+}
+#endif
 
-bool try_allocate( struct inode_disk* disk_inode, size_t blocks_number )
+/* Applies ADVICE, POSIX_FADV_WILLNEED or POSIX_FADV_DONTNEED, to
+   LEN bytes of INODE starting at OFFSET, or to the rest of the file
+   if LEN is 0.  WILLNEED queues up to WILLNEED_MAX_SECTORS sectors
+   of the range to be read into the buffer cache in the background;
+   DONTNEED writes the range back and drops it from the cache.  The
+   other hints describe one opener's access pattern and are kept
+   with its open file instead; see file_advise().
+   Returns false if ADVICE is neither of the two. */
+bool
+inode_advise (struct inode *inode UNUSED, off_t offset, off_t len,
+              int advice)
 {
-  struct inode_disk* disk_aux = disk_inode;
-  size_t contor = 0;
+  ASSERT (offset >= 0 && len >= 0);
 
-  //Finds first sector data that is free
-  while( disk_aux->start[contor] != NULL_SECTOR )
-  {
-    contor++;
-  }
+  if (advice != POSIX_FADV_WILLNEED && advice != POSIX_FADV_DONTNEED)
+    return false;
 
-  size_t numberOfBlocksToAllocate = blocks_number;
-  size_t numberOfBlocksAllocated = 0;
-  while( numberOfBlocksAllocated != blocks_number )
-  {
-    if ( free_map_allocate( numberOfBlocksToAllocate, &disk_aux->start[contor] ) )
+#ifdef FILESYS_USE_CACHE
+  const off_t chunk = COPY_CHUNK_SECTORS * BLOCK_SECTOR_SIZE;
+  off_t end;
+
+  rwlock_acquire_read (&inode->rw);
+  end = inode_length (inode);
+  if (len != 0 && len < end - offset)
+    end = offset + len;
+  if (advice == POSIX_FADV_WILLNEED
+      && end - offset > WILLNEED_MAX_SECTORS * BLOCK_SECTOR_SIZE)
+    end = offset + WILLNEED_MAX_SECTORS * BLOCK_SECTOR_SIZE;
+  for (; offset < end; offset += chunk)
     {
-      //Updates the size of the data sector
-      disk_aux->length[contor] = numberOfBlocksToAllocate;
+      sid_t sectors[COPY_CHUNK_SECTORS];
+      int cnt = range_sectors (inode, offset,
+                               end - offset < chunk ? end - offset : chunk,
+                               sectors);
+      if (cnt == 0)
+        continue;
+      if (advice == POSIX_FADV_WILLNEED)
+        cache_prefetch (sectors, cnt);
+      else
+        cache_discard (sectors, cnt);
+    }
+  rwlock_release_read (&inode->rw);
+#endif
+  return true;
+}
 
-      numberOfBlocksAllocated += numberOfBlocksToAllocate;
+#ifdef FILESYS_EXTEND_FILES
+/* Makes DST, which must be an empty file, a clone of SRC: DST
+   gets SRC's length and extents, and the data sectors are shared
+   rather than copied, so cloning costs the same however large SRC
+   is.  Whichever file writes to a shared sector later gets its own
+   copy of just that sector.
+   Returns false, leaving DST empty, if memory or disk allocation
+   fails or a sector already has too many clones. */
+bool
+inode_clone (struct inode *dst, struct inode *src)
+{
+  size_t sectors, i, left;
+  bool success = true;
 
-      if ( numberOfBlocksAllocated != blocks_number )
-      {
-    	contor++;
+  ASSERT (dst != src);
 
-        if ( contor == INODE_DISK_ARRAY_SIZE )
-        {
-          //In case it reach the maximum number of data sectors
-          //We have to create another inode_disk, and continue to add data in it.
-          struct inode_disk* new_inode_disk = NULL;
-          new_inode_disk = calloc( 1, sizeof * new_inode_disk );
-          init_disk_inode( new_inode_disk );
-          free_map_allocate( 1, &disk_aux->next_sector );
-#ifndef FILESYS_USE_CACHE
-          block_write( fs_device, disk_aux->next_sector, new_inode_disk );
-#else
-          cache_write( disk_aux->next_sector, new_inode_disk, 0, BLOCK_SECTOR_SIZE );
-#endif
+  journal_begin ();
+  rwlock_acquire_write (&src->rw);
+  rwlock_acquire_write (&dst->rw);
+  ASSERT (inode_length (dst) == 0 && dst->sector_cnt == 0);
 
-          free( new_inode_disk );
+  if (src->data.flags & INODE_INLINE)
+    {
+      /* Nothing to share: the data is in the inode sector. */
+      memcpy (dst->data.inline_data, src->data.inline_data,
+              INODE_INLINE_SIZE);
+      dst->data.flags |= src->data.flags & INODE_COMPRESSED;
+      dst->data.file_total_size = src->data.file_total_size;
+      goto done;
+    }
 
-#ifndef FILESYS_USE_CACHE
-          block_read( fs_device, disk_aux->next_sector, disk_aux );
-#else
-          cache_read( disk_aux->next_sector, disk_aux, 0, BLOCK_SECTOR_SIZE );
-#endif
+  /* Delayed data, and a changed cluster of a compressed file,
+     have no sectors to share yet. */
+  if (!delalloc_flush (src) || !cluster_store (src))
+    {
+      success = false;
+      goto done;
+    }
+
+  /* Speculative sectors past end of file stay with SRC. */
+  sectors = bytes_to_sectors (inode_length (src));
+  if (src->data.flags & INODE_COMPRESSED)
+    sectors = ROUND_UP (sectors, CLUSTER_SECTORS);
+  left = sectors;
+  for (i = 0; i < src->extent_cnt && left > 0; i++)
+    {
+      struct inode_extent *e = &src->extents[i];
+      size_t len = (size_t) e->length < left ? (size_t) e->length : left;
+
+      if (e->start != HOLE_SECTOR && !free_map_share (e->start, len))
+        {
+          success = false;
+          break;
         }
+      if (!extents_push (dst, e->start, len))
+        {
+          if (e->start != HOLE_SECTOR)
+            free_map_release (e->start, len);
+          success = false;
+          break;
+        }
+      left -= len;
+    }
+
+  if (success)
+    {
+      dst->data.flags &= ~INODE_INLINE;
+      dst->data.flags |= src->data.flags & INODE_COMPRESSED;
+      dst->data.file_total_size = src->data.file_total_size;
+    }
+  else
+    extents_truncate (dst, 0);
+
+ done:
+  rwlock_release_write (&dst->rw);
+  rwlock_release_write (&src->rw);
+  journal_end ();
+  return success;
+}
+#endif
+
+#ifdef FILESYS_EXTEND_FILES
+/* Makes the whole blocks among the SIZE bytes of DST at DST_OFS
+   share the sectors behind the same bytes of SRC at SRC_OFS,
+   releasing what DST had there, as inode_clone() does for a whole
+   file.  Only blocks that end within SRC are shared.
+   Returns the number of bytes shared, which is 0 unless both
+   offsets start a block, DST_OFS is within DST, and neither file
+   is compressed, or if memory, disk space or a share count runs
+   out. */
+static off_t
+share_range (struct inode *dst, off_t dst_ofs, struct inode *src,
+             off_t src_ofs, off_t size)
+{
+  const off_t block_bytes = fs_block_sectors * BLOCK_SECTOR_SIZE;
+  struct inode *first = dst->sector < src->sector ? dst : src;
+  struct inode *second = first == dst ? src : dst;
+  struct inode_extent *pieces = NULL;
+  size_t dst_first, src_first, old_cnt, pos, i, cnt = 0, piece_cnt = 0;
+
+  if (dst == src || dst_ofs % block_bytes != 0 || src_ofs % block_bytes != 0)
+    return 0;
+
+  /* Locked in inode sector order, so that copies in opposite
+     directions cannot deadlock. */
+  journal_begin ();
+  rwlock_acquire_write (&first->rw);
+  rwlock_acquire_write (&second->rw);
+  if (dst->deny_write_cnt > 0 || dst_ofs > inode_length (dst)
+      || src_ofs >= inode_length (src)
+      || (src->data.flags | dst->data.flags) & INODE_COMPRESSED
+      || src->data.flags & INODE_INLINE)
+    goto done;
+  if (size > inode_length (src) - src_ofs)
+    size = inode_length (src) - src_ofs;
+  cnt = size / block_bytes * fs_block_sectors;
+  if (cnt == 0
+      || (dst->data.flags & INODE_INLINE && !inode_uninline (dst))
+      || !delalloc_flush (src) || !delalloc_flush (dst))
+    {
+      cnt = 0;
+      goto done;
+    }
+
+  /* SRC's extents over the range, each sector taking on DST as
+     another owner. */
+  pieces = malloc (src->extent_cnt * sizeof *pieces);
+  if (pieces == NULL)
+    goto unshare;
+  src_first = src_ofs / BLOCK_SECTOR_SIZE;
+  for (i = 0, pos = 0; i < src->extent_cnt && pos < src_first + cnt;
+       pos += src->extents[i++].length)
+    {
+      struct inode_extent e = src->extents[i];
+      size_t lo = pos > src_first ? pos : src_first;
+      size_t hi = pos + e.length < src_first + cnt
+                  ? pos + e.length : src_first + cnt;
+
+      if (hi <= lo)
+        continue;
+      pieces[piece_cnt].start = e.start == HOLE_SECTOR
+                                ? HOLE_SECTOR : e.start + (lo - pos);
+      pieces[piece_cnt].length = hi - lo;
+      if (e.start != HOLE_SECTOR
+          && !free_map_share (pieces[piece_cnt].start, hi - lo))
+        goto unshare;
+      piece_cnt++;
+    }
+
+  /* A range that runs past DST's sectors is made to end inside
+     them first. */
+  dst_first = dst_ofs / BLOCK_SECTOR_SIZE;
+  old_cnt = dst->sector_cnt;
+  if (dst_first < old_cnt && dst_first + cnt > old_cnt
+      && !extents_push (dst, HOLE_SECTOR, dst_first + cnt - old_cnt))
+    goto unshare;
+  if (!extents_replace (dst, dst_first, cnt, pieces, piece_cnt))
+    {
+      extents_truncate (dst, old_cnt);
+      goto unshare;
+    }
+
+  /* Speculative sectors the range covered are gone. */
+  if (dst->spec_cnt > 0
+      && dst_first + cnt > dst->sector_cnt - dst->spec_cnt)
+    dst->spec_cnt = dst_first + cnt < dst->sector_cnt
+                    ? dst->sector_cnt - (dst_first + cnt) : 0;
+  if (dst_ofs + (off_t) (cnt * BLOCK_SECTOR_SIZE) > inode_length (dst))
+    dst->data.file_total_size = dst_ofs + cnt * BLOCK_SECTOR_SIZE;
+  goto done;
+
+ unshare:
+  while (piece_cnt-- > 0)
+    if (pieces[piece_cnt].start != HOLE_SECTOR)
+      free_map_release (pieces[piece_cnt].start, pieces[piece_cnt].length);
+  cnt = 0;
+ done:
+  free (pieces);
+  rwlock_release_write (&second->rw);
+  rwlock_release_write (&first->rw);
+  journal_end ();
+  return cnt * BLOCK_SECTOR_SIZE;
+}
+#endif
+
+/* Writes INODE's dirty data to disk, then, unless DATA_ONLY is
+   true and the data can be read back without it, commits its inode
+   sector and extent chain through the journal.  The free map is
+   part of the same commit, so that after a crash no file refers
+   to sectors the free map calls free.
+   Returns false if delayed data could not be given sectors. */
+bool
+inode_sync (struct inode *inode, bool data_only)
+{
+  bool commit;
+  bool success = write_back (inode, data_only, &commit);
+
+  if (commit)
+    journal_commit ();
+  return success;
+}
+
+/* Marks INODE as holding file system metadata, such as a
+   directory or the free map, whose data must be journaled along
+   with the inode and is kept in the buffer cache as CLASS. */
+void
+inode_set_metadata (struct inode *inode, enum cache_class class)
+{
+  inode->metadata = true;
+  inode->cache_class = class;
+}
+
+/* Syncs every open inode to disk, in one journal commit.  The
+   free map's own files are left out; the commit writes them. */
+void
+inode_sync_all (void)
+{
+  struct inode **inodes;
+  struct list_elem *e;
+  size_t cnt = 0, i;
+  bool commit;
+
+  /* Work from a snapshot, so that syncing, which may allocate,
+     does not happen under open_inodes_lock. */
+  lock_acquire (&open_inodes_lock);
+  inodes = malloc (list_size (&open_inodes) * sizeof *inodes);
+  if (inodes != NULL)
+    for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+         e = list_next (e))
+      {
+        struct inode *inode = list_entry (e, struct inode, elem);
+        if (inode->sector == FREE_MAP_SECTOR
+            || inode->sector == SHARE_MAP_SECTOR || inode->closing)
+          continue;
+        inode->open_cnt++;
+        inodes[cnt++] = inode;
       }
+  lock_release (&open_inodes_lock);
+
+  for (i = 0; i < cnt; i++)
+    {
+      write_back (inodes[i], false, &commit);
+      inode_close (inodes[i]);
     }
-    else
+  free (inodes);
+  journal_commit ();
+}
+
+/* Does the work of inode_sync(), except for the commit.  Sets
+   *COMMIT to true if INODE's metadata was written and needs one. */
+static bool
+write_back (struct inode *inode, bool data_only, bool *commit)
+{
+  bool success;
+
+  journal_begin ();
+  rwlock_acquire_write (&inode->rw);
+  success = flush_data (inode);
+  *commit = success && (!data_only || meta_changed (inode));
+  if (*commit)
+    success = flush_meta (inode);
+  rwlock_release_write (&inode->rw);
+  journal_end ();
+  return success;
+}
+
+/* Gives INODE's delayed data its sectors, compresses its changed
+   cluster, and writes INODE's dirty data sectors to disk.  INODE's
+   lock must be held exclusively.
+   Returns false if the delayed data or the cluster could not be
+   placed. */
+static bool
+flush_data (struct inode *inode UNUSED)
+{
+#ifdef FILESYS_EXTEND_FILES
+  if (!delalloc_flush (inode) || !cluster_store (inode))
+    return false;
+#endif
+#ifdef FILESYS_USE_CACHE
+  if (!(inode->data.flags & INODE_INLINE))
+    cache_flush_if (owns_sector, inode);
+#endif
+  return true;
+}
+
+/* Writes INODE's extent chain and inode sector to the journal,
+   or to disk without the buffer cache.  INODE's lock must be held
+   exclusively.
+   Returns false if the extent chain could not be stored. */
+static bool
+flush_meta (struct inode *inode)
+{
+#ifdef FILESYS_EXTEND_FILES
+  if (inode->extents_dirty && !extents_store (inode))
+    return false;
+#endif
+  meta_write (inode->sector, &inode->data, CACHE_INODE);
+  return true;
+}
+
+/* Returns true if INODE's metadata in memory differs from its
+   copy on disk, so that its data cannot be found or its length
+   is wrong without writing the metadata.  INODE's lock must be
+   held. */
+static bool
+meta_changed (struct inode *inode)
+{
+  struct inode_disk *disk_inode;
+  bool changed;
+
+#ifdef FILESYS_EXTEND_FILES
+  if (inode->extents_dirty)
+    return true;
+#endif
+  disk_inode = malloc (sizeof *disk_inode);
+  if (disk_inode == NULL)
+    return true;
+  sector_read (inode->sector, disk_inode, CACHE_INODE);
+  changed = memcmp (disk_inode, &inode->data, sizeof *disk_inode) != 0;
+  free (disk_inode);
+  return changed;
+}
+
+#ifdef FILESYS_USE_CACHE
+/* Returns true if SECTOR holds data of INODE_, an inode. */
+static bool
+owns_sector (sid_t sector, void *inode_)
+{
+  struct inode *inode = inode_;
+#ifdef FILESYS_EXTEND_FILES
+  size_t i;
+
+  for (i = 0; i < inode->extent_cnt; i++)
+    {
+      struct inode_extent *e = &inode->extents[i];
+      if (e->start != HOLE_SECTOR && (block_sector_t) sector >= e->start
+          && (block_sector_t) sector < e->start + e->length)
+        return true;
+    }
+  return false;
+#else
+  return (block_sector_t) sector >= inode->data.start
+         && (block_sector_t) sector < inode->data.start
+                                      + bytes_to_sectors (inode->data.length);
+#endif
+}
+#endif
+
+/* Disables writes to INODE.
+   May be called at most once per inode opener. */
+void
+inode_deny_write (struct inode *inode) 
+{
+  inode->deny_write_cnt++;
+  ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+}
+
+/* Re-enables writes to INODE.
+   Must be called once by each inode opener who has called
+   inode_deny_write() on the inode, before closing the inode. */
+void
+inode_allow_write (struct inode *inode) 
+{
+  ASSERT (inode->deny_write_cnt > 0);
+  ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  inode->deny_write_cnt--;
+}
+
+/* Allocates disk sectors for the first LENGTH bytes of INODE, in
+   as few extents as free space allows, without writing them and
+   without changing INODE's length.  Later writes up to LENGTH
+   then never have to allocate.
+   Returns true if INODE has sectors for all LENGTH bytes, false
+   if LENGTH is negative or more than inode_max_length(). */
+bool
+inode_preallocate (struct inode *inode, off_t length)
+{
+#ifdef FILESYS_EXTEND_FILES
+  size_t sectors;
+  bool success = true;
+
+  if (length < 0 || length > inode_max_length ())
+    return false;
+  sectors = bytes_to_sectors (length);
+  if (inode->deny_write_cnt)
+    return false;
+  journal_begin ();
+  rwlock_acquire_write (&inode->rw);
+#ifdef FILESYS_SYNC
+  lock_acquire(&inode->inode_lock);
+#endif
+  /* How many sectors a compressed file needs is only known once
+     its data is. */
+  if (inode->data.flags & INODE_COMPRESSED)
+    success = length <= inode_length (inode);
+  else if (inode->data.flags & INODE_INLINE)
+    {
+      if (length <= (off_t) INODE_INLINE_SIZE)
+        success = true;
+      else
+        success = inode_uninline (inode);
+    }
+  if (success && !(inode->data.flags & (INODE_INLINE | INODE_COMPRESSED))
+      && sectors > inode->sector_cnt)
+    success = delalloc_flush (inode)
+              && (sectors <= inode->sector_cnt
+                  || inode_allocate (inode, sectors - inode->sector_cnt,
+                                     NULL));
+
+  /* Holes in the range get sectors too. */
+  if (success && !(inode->data.flags & (INODE_INLINE | INODE_COMPRESSED)))
+    {
+      size_t n;
+      for (n = 0; success && n < sectors && n < inode->sector_cnt; n++)
+        if (extents_lookup (inode, n) == HOLE_SECTOR)
+          success = extents_fill (inode, n) != NULL_SECTOR;
+    }
+
+  /* Speculative sectors the caller asked for are no longer
+     speculative. */
+  if (success && inode->spec_cnt > 0)
     {
-      //In case it doesn't succed to allocate then 
-      //reduce the number of consecutive blocks to allocate
-      numberOfBlocksToAllocate--;
-      if ( numberOfBlocksToAllocate == 0 )
+      size_t spec_first = inode->sector_cnt - inode->spec_cnt;
+      if (sectors > spec_first)
+        inode->spec_cnt = sectors < inode->sector_cnt
+                          ? inode->sector_cnt - sectors : 0;
+    }
+#ifdef FILESYS_SYNC
+  lock_release(&inode->inode_lock);
+#endif
+  rwlock_release_write (&inode->rw);
+  journal_end ();
+  return success;
+#else
+  /* Files cannot grow, so all of their sectors exist already. */
+  return length >= 0 && length <= inode_length (inode);
+#endif
+}
+
+/* Moves the data sectors of INODE into one run, as close after the
+   inode sector as free space allows.  Holes stay holes, so a
+   compressed file keeps its clusters, and a clone gets its own
+   copy of the sectors it shared.  The copy reaches the disk before
+   the new extent list is committed, and the old sectors are only
+   released after that, so that after a crash the file is found
+   whole in one place or the other.  Must not be called within a
+   journal operation.
+   Returns false, leaving INODE where it was, if no free run is
+   large enough or memory runs out. */
+bool
+inode_defrag (struct inode *inode)
+{
+  return inode_move (inode, false);
+}
+
+/* Moves the data sectors of INODE into the free run with the
+   lowest address that holds them all, if there is one before
+   them, the same way inode_defrag() does.  Done for every file in
+   turn, this packs the data towards the start of the disk, so
+   that the free space left between files comes together after
+   them.
+   Returns false, leaving INODE where it was, if memory runs out.
+   Having no lower run to move to is success. */
+bool
+inode_compact (struct inode *inode)
+{
+  return inode_move (inode, true);
+}
+
+/* Does the work of inode_defrag(), or of inode_compact() if
+   COMPACT. */
+static bool
+inode_move (struct inode *inode UNUSED, bool compact UNUSED)
+{
+#ifdef FILESYS_EXTEND_FILES
+  struct inode_extent *old = NULL;
+  size_t old_cnt = 0, real = 0, runs = 0, pos = 0, i, k;
+  uint8_t *buffer = NULL;
+  block_sector_t start, first = 0;
+  bool success = true;
+
+  journal_begin ();
+  rwlock_acquire_write (&inode->rw);
+
+  /* A directory's sectors belong to the journal until it writes
+     them back, so they cannot be copied behind its back. */
+  if (inode->metadata || inode->data.flags & INODE_INLINE)
+    goto done;
+  if (!delalloc_flush (inode) || !cluster_store (inode))
+    {
+      success = false;
+      goto done;
+    }
+
+  /* Speculative sectors would only be moved to be given back. */
+  extents_truncate (inode, inode->sector_cnt - inode->spec_cnt);
+  inode->spec_cnt = 0;
+
+  for (i = 0; i < inode->extent_cnt; i++)
+    if (inode->extents[i].start != HOLE_SECTOR)
       {
+        if (runs == 0)
+          first = inode->extents[i].start;
+        real += inode->extents[i].length;
+        runs++;
+      }
+  if (runs == 0 || (runs == 1 && !compact))
+    goto done;
+
+  if (compact)
+    {
+      /* Nothing lower to move to leaves the file where it is. */
+      if (!free_map_allocate_below (real, first, &start))
+        goto done;
+    }
+  else
+    {
+      /* Take the run right after the inode, or the nearest one
+         after it that holds the whole file, or any that does. */
+      k = free_map_allocate_near (real, inode->sector + 1, &start);
+      if (k < real)
+        {
+          if (k > 0)
+            free_map_release (start, k);
+          if (!free_map_allocate (real, &start))
+            {
+              success = false;
+              goto done;
+            }
+        }
+    }
+  old = malloc (inode->extent_cnt * sizeof *old);
+  buffer = malloc (COPY_CHUNK_SECTORS * BLOCK_SECTOR_SIZE);
+  if (old == NULL || buffer == NULL)
+    {
+      free_map_release (start, real);
+      success = false;
+      goto done;
+    }
+
+  for (i = 0; i < inode->extent_cnt; i++)
+    {
+      struct inode_extent *e = &inode->extents[i];
+
+      if (e->start == HOLE_SECTOR)
+        continue;
+      move_sectors (e->start, start + pos, e->length, buffer);
+      old[old_cnt++] = *e;
+      e->start = start + pos;
+      pos += e->length;
+    }
+  extents_coalesce (inode);
+  inode->extents_dirty = true;
+
+  /* The data first, then the extents that point to it. */
+  success = flush_data (inode) && flush_meta (inode);
+
+ done:
+  rwlock_release_write (&inode->rw);
+  journal_end ();
+  free (buffer);
+
+  /* If the new extents could not be stored, the old sectors stay
+     allocated rather than risk the disk copy pointing at reused
+     ones. */
+  if (old_cnt > 0 && success)
+    {
+      journal_commit ();
+      journal_begin ();
+      for (i = 0; i < old_cnt; i++)
+        free_map_release (old[i].start, old[i].length);
+      journal_end ();
+    }
+  free (old);
+  return success;
+#else
+  /* Files cannot grow, so each is one run already. */
+  return true;
+#endif
+}
+
+#ifdef FILESYS_EXTEND_FILES
+/* Copies CNT data sectors from FROM onward to TO onward, through
+   BUFFER, which holds COPY_CHUNK_SECTORS sectors, one request each
+   way per chunk.  Copies newer than the disk, in the buffer cache
+   or the journal, are read instead of the disk's. */
+static void
+move_sectors (block_sector_t from, block_sector_t to, size_t cnt,
+              uint8_t *buffer)
+{
+  while (cnt > 0)
+    {
+      size_t n = cnt < COPY_CHUNK_SECTORS ? cnt : COPY_CHUNK_SECTORS;
+#ifdef FILESYS_USE_CACHE
+      cache_read_direct (from, n, buffer);
+      cache_write_direct (to, n, buffer);
+#else
+      block_read_multiple (fs_device, from, n, buffer);
+      block_write_multiple (fs_device, to, n, buffer);
+#endif
+      from += n;
+      to += n;
+      cnt -= n;
+    }
+}
+#endif
+
+/* Makes INODE keep its data compressed from here on.  As with the
+   compression attribute of other file systems, this is meant for
+   a file that is about to be written: only one without data
+   sectors, which includes one whose data still fits in the inode
+   sector, can be switched.  Directories stay uncompressed.
+   Returns true if INODE is compressed. */
+bool
+inode_set_compressed (struct inode *inode UNUSED)
+{
+#ifdef FILESYS_EXTEND_FILES
+  bool success;
+
+  rwlock_acquire_write (&inode->rw);
+  success = (inode->data.flags & INODE_COMPRESSED)
+            || (!inode->metadata && inode->sector_cnt == 0
+                && inode->delalloc_cnt == 0);
+  if (success)
+    inode->data.flags |= INODE_COMPRESSED;
+  rwlock_release_write (&inode->rw);
+  return success;
+#else
+  return false;
+#endif
+}
+
+/* Returns the greatest length, in bytes, a file can have: what
+   the file system device holds, at most the largest off_t. */
+off_t
+inode_max_length (void)
+{
+  block_sector_t sectors = block_size (fs_device);
+
+  if (sectors > INT32_MAX / BLOCK_SECTOR_SIZE)
+    return INT32_MAX;
+  return sectors * BLOCK_SECTOR_SIZE;
+}
+
+/* Returns the length, in bytes, of INODE's data. */
+off_t
+inode_length (const struct inode *inode)
+{
+#ifdef FILESYS_EXTEND_FILES
+	return inode->data.file_total_size;
+#else
+	return inode->data.length;
+#endif
+}
+
+/* Returns the length, in bytes, of the inode stored in SECTOR
+   without opening it.  An open inode may hold a newer length
+   than its disk copy, so the open list is consulted first. */
+off_t
+inode_length_at (block_sector_t sector)
+{
+  struct list_elem *e;
+  off_t length;
+
+  lock_acquire (&open_inodes_lock);
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector)
+        {
+          length = inode_length (inode);
+          lock_release (&open_inodes_lock);
+          return length;
+        }
+    }
+  lock_release (&open_inodes_lock);
+
+#ifdef FILESYS_EXTEND_FILES
+  const int length_ofs = offsetof (struct inode_disk, file_total_size);
+#else
+  const int length_ofs = offsetof (struct inode_disk, length);
+#endif
+#ifdef FILESYS_USE_CACHE
+  cache_read_hint (sector, &length, length_ofs, sizeof length,
+                   CACHE_HINT_CLASS (CACHE_INODE));
+#else
+  struct inode_disk *disk_inode = malloc (sizeof *disk_inode);
+  if (disk_inode == NULL)
+    return 0;
+  block_read (fs_device, sector, disk_inode);
+  memcpy (&length, (uint8_t *) disk_inode + length_ofs, sizeof length);
+  free (disk_inode);
+#endif
+  return length;
+}
+
+
+
+/* Reads sector SECTOR, which holds CLASS, into BUFFER, through
+   the cache if in use. */
+static void
+sector_read (block_sector_t sector, void *buffer,
+             enum cache_class class UNUSED)
+{
+#ifndef FILESYS_USE_CACHE
+  block_read (fs_device, sector, buffer);
+#else
+  cache_read_hint (sector, buffer, 0, BLOCK_SECTOR_SIZE,
+                   CACHE_HINT_CLASS (class));
+#endif
+}
+
+/* Writes BUFFER to metadata sector SECTOR, which holds CLASS,
+   through the cache and the journal if the cache is in use. */
+static void
+meta_write (block_sector_t sector, const void *buffer,
+            enum cache_class class UNUSED)
+{
+#ifndef FILESYS_USE_CACHE
+  block_write (fs_device, sector, buffer);
+#else
+  cache_write_meta (sector, buffer, 0, BLOCK_SECTOR_SIZE,
+                    CACHE_HINT_CLASS (class));
+#endif
+}
+
+#ifdef FILESYS_EXTEND_FILES
+/* Writes BUFFER to sector SECTOR, through the cache if in use. */
+static void
+sector_write (block_sector_t sector, const void *buffer)
+{
+#ifndef FILESYS_USE_CACHE
+  block_write (fs_device, sector, buffer);
+#else
+  cache_write (sector, buffer, 0, BLOCK_SECTOR_SIZE);
+#endif
+}
+
+/* Writes BUFFER to SECTOR, a data sector of INODE. */
+static void
+data_write (const struct inode *inode, block_sector_t sector,
+            const void *buffer)
+{
+  if (inode->metadata)
+    meta_write (sector, buffer, inode->cache_class);
+  else
+    sector_write (sector, buffer);
+}
+
+/* Reads the extents of INODE, whose disk inode is already in
+   INODE->data, from the disk inode and its chain.
+   Returns false if out of memory. */
+static bool
+extents_load (struct inode *inode)
+{
+  const struct inode_disk *disk_inode = &inode->data;
+  struct inode_disk *chain = NULL;
+  bool success = true;
+  size_t i;
+
+  inode->extents = NULL;
+  inode->extent_cnt = inode->extent_cap = inode->sector_cnt = 0;
+  inode->extents_dirty = false;
+  if (disk_inode->flags & INODE_INLINE)
+    return true;
+
+  for (;;)
+    {
+      for (i = 0; i < INODE_DISK_ARRAY_SIZE
+                  && disk_inode->start[i] != NULL_SECTOR; i++)
+        if (!extents_push (inode, disk_inode->start[i],
+                           disk_inode->length[i]))
+          {
+            success = false;
+            break;
+          }
+      if (!success || disk_inode->next_sector == NULL_SECTOR)
+        break;
+      if (chain == NULL)
+        {
+          chain = malloc (sizeof *chain);
+          if (chain == NULL)
+            {
+              success = false;
+              break;
+            }
+        }
+      sector_read (disk_inode->next_sector, chain, CACHE_INDEX);
+      disk_inode = chain;
+    }
+  free (chain);
+
+  if (!success)
+    free (inode->extents);
+  inode->extents_dirty = false;
+  return success;
+}
+
+/* Writes the extents of INODE into INODE->data and as many chained
+   disk inodes as needed, allocating chain sectors near the inode
+   or releasing the ones no longer needed.
+   Returns false if a chain sector could not be allocated. */
+static bool
+extents_store (struct inode *inode)
+{
+  struct inode_disk *disk_inode = &inode->data;
+  struct inode_disk *chain;
+  block_sector_t *sectors = NULL;
+  size_t have = 0, need, i, k;
+  block_sector_t sector;
+  bool success = true;
+
+  chain = calloc (1, sizeof *chain);
+  if (chain == NULL)
+    return false;
+
+  /* Collect the chain sectors already on disk. */
+  for (sector = disk_inode->next_sector; sector != NULL_SECTOR;
+       sector = chain->next_sector)
+    {
+      block_sector_t *grown = realloc (sectors, (have + 1) * sizeof *sectors);
+      if (grown == NULL)
+        {
+          free (sectors);
+          free (chain);
+          return false;
+        }
+      sectors = grown;
+      sectors[have++] = sector;
+      sector_read (sector, chain, CACHE_INDEX);
+    }
+
+  /* Allocate or release chain sectors to match the extent count. */
+  need = inode->extent_cnt > INODE_DISK_ARRAY_SIZE
+         ? DIV_ROUND_UP (inode->extent_cnt - INODE_DISK_ARRAY_SIZE,
+                         INODE_DISK_ARRAY_SIZE)
+         : 0;
+  if (need > have)
+    {
+      block_sector_t *grown = realloc (sectors, need * sizeof *sectors);
+      if (grown == NULL)
+        success = false;
+      else
+        sectors = grown;
+      while (success && have < need)
+        {
+          block_sector_t goal = have > 0 ? sectors[have - 1] : inode->sector;
+          if (free_map_allocate_near (1, goal + 1, &sectors[have]) == 0)
+            success = false;
+          else
+            have++;
+        }
+      if (!success)
+        {
+          free (sectors);
+          free (chain);
+          return false;
+        }
+    }
+  while (have > need)
+    free_map_release (sectors[--have], 1);
+
+  /* Fill in the inode and its chain, one array's worth each. */
+  for (i = 0, k = 0; k <= need; k++)
+    {
+      struct inode_disk *d = k == 0 ? disk_inode : chain;
+      size_t j;
+
+      if (k > 0)
+        {
+          memset (chain, 0, sizeof *chain);
+          init_disk_inode (chain);
+        }
+      for (j = 0; j < INODE_DISK_ARRAY_SIZE; j++, i++)
+        {
+          d->start[j] = i < inode->extent_cnt
+                        ? inode->extents[i].start : NULL_SECTOR;
+          d->length[j] = i < inode->extent_cnt
+                         ? inode->extents[i].length : 0;
+        }
+      d->next_sector = k < need ? sectors[k] : NULL_SECTOR;
+      if (k > 0)
+        meta_write (sectors[k - 1], chain, CACHE_INDEX);
+    }
+
+  free (sectors);
+  free (chain);
+  inode->extents_dirty = false;
+  return true;
+}
+
+/* Appends LENGTH sectors starting at START to the extents of
+   INODE, merging them into the last extent when contiguous.
+   Returns false if out of memory. */
+static bool
+extents_push (struct inode *inode, block_sector_t start, off_t length)
+{
+  struct inode_extent *last;
+
+  if (length <= 0)
+    return true;
+
+  last = inode->extent_cnt > 0 ? &inode->extents[inode->extent_cnt - 1] : NULL;
+  if (last != NULL && extent_continues (last, start))
+    last->length += length;
+  else
+    {
+      if (!extents_reserve (inode, inode->extent_cnt + 1))
+        return false;
+      inode->extents[inode->extent_cnt].start = start;
+      inode->extents[inode->extent_cnt].length = length;
+      inode->extent_cnt++;
+    }
+  inode->sector_cnt += length;
+  inode->extents_dirty = true;
+  return true;
+}
+
+/* Returns true if a run starting at START continues extent E:
+   both are holes, or START is the sector right after E. */
+static bool
+extent_continues (const struct inode_extent *e, block_sector_t start)
+{
+  if (e->start == HOLE_SECTOR || start == HOLE_SECTOR)
+    return e->start == start;
+  return e->start + e->length == start;
+}
+
+/* Makes room for at least CNT extents in INODE.
+   Returns false if out of memory. */
+static bool
+extents_reserve (struct inode *inode, size_t cnt)
+{
+  if (cnt > inode->extent_cap)
+    {
+      size_t cap = inode->extent_cap > 0 ? inode->extent_cap * 2 : 8;
+      struct inode_extent *extents;
+
+      if (cap < cnt)
+        cap = cnt;
+      extents = realloc (inode->extents, cap * sizeof *extents);
+      if (extents == NULL)
         return false;
+      inode->extents = extents;
+      inode->extent_cap = cap;
+    }
+  return true;
+}
+
+/* Merges neighbouring extents of INODE that continue each other. */
+static void
+extents_coalesce (struct inode *inode)
+{
+  size_t i, j = 0;
+
+  for (i = 0; i < inode->extent_cnt; i++)
+    if (j > 0 && extent_continues (&inode->extents[j - 1],
+                                   inode->extents[i].start))
+      inode->extents[j - 1].length += inode->extents[i].length;
+    else
+      inode->extents[j++] = inode->extents[i];
+  inode->extent_cnt = j;
+}
+
+/* Returns the sector where new data for INODE should go: right
+   after its last allocated sector, or right after the inode
+   sector if none is allocated yet. */
+static block_sector_t
+extents_goal (const struct inode *inode)
+{
+  size_t i;
+
+  for (i = inode->extent_cnt; i-- > 0; )
+    if (inode->extents[i].start != HOLE_SECTOR)
+      return inode->extents[i].start + inode->extents[i].length;
+  return inode->sector + 1;
+}
+
+/* Gives the block holding data sector N of INODE, which lies in a
+   hole, zeroed disk sectors of its own, splitting the hole around
+   it.
+   Returns the new sector of N, or NULL_SECTOR if the disk is full
+   or memory runs out. */
+static block_sector_t
+extents_fill (struct inode *inode, size_t n)
+{
+  static uint8_t zeros[FS_BLOCK_MAX_SECTORS * BLOCK_SECTOR_SIZE];
+
+  return extents_remap (inode, n, zeros);
+}
+
+/* Gives the block holding data sector N of INODE, which it shares
+   with a clone, a private copy, and drops INODE's share of the old
+   block.
+   Returns the new sector of N, or NULL_SECTOR if the disk is full
+   or memory runs out. */
+static block_sector_t
+extents_unshare (struct inode *inode, size_t n)
+{
+  block_sector_t old = extents_lookup (inode, n) - n % fs_block_sectors;
+  block_sector_t sector;
+  uint8_t *copy;
+  size_t k;
+
+  copy = malloc (fs_block_sectors * BLOCK_SECTOR_SIZE);
+  if (copy == NULL)
+    return NULL_SECTOR;
+  for (k = 0; k < fs_block_sectors; k++)
+    sector_read (old + k, copy + k * BLOCK_SECTOR_SIZE,
+                 inode->cache_class);
+  sector = extents_remap (inode, n, copy);
+  if (sector != NULL_SECTOR)
+    free_map_release (old, fs_block_sectors);
+  free (copy);
+  return sector;
+}
+
+/* Moves the block holding data sector N of INODE to a newly
+   allocated block filled from DATA, splitting the extent that held
+   it around it.  The block is placed after the last allocated
+   sector before N when possible, so that filling a hole front to
+   back produces one extent.  The old block, if any, is left to the
+   caller.
+   Returns the new sector of N, or NULL_SECTOR if the disk is full
+   or memory runs out. */
+static block_sector_t
+extents_remap (struct inode *inode, size_t n, const uint8_t *data)
+{
+  struct inode_extent piece[3], old;
+  block_sector_t goal, sector;
+  size_t i, j, k, ofs = n - n % fs_block_sectors, parts = 0;
+
+  for (i = 0; i < inode->extent_cnt
+              && ofs >= (size_t) inode->extents[i].length; i++)
+    ofs -= inode->extents[i].length;
+  ASSERT (i < inode->extent_cnt);
+
+  goal = inode->sector + 1;
+  for (j = i; j-- > 0; )
+    if (inode->extents[j].start != HOLE_SECTOR)
+      {
+        goal = inode->extents[j].start + inode->extents[j].length;
+        break;
       }
+  if (free_map_allocate_near (fs_block_sectors, goal, &sector) == 0)
+    return NULL_SECTOR;
+  if (!extents_reserve (inode, inode->extent_cnt + 2))
+    {
+      free_map_release (sector, fs_block_sectors);
+      return NULL_SECTOR;
     }
-  }
 
+  old = inode->extents[i];
+  if (ofs > 0)
+    {
+      piece[parts].start = old.start;
+      piece[parts++].length = ofs;
+    }
+  piece[parts].start = sector;
+  piece[parts++].length = fs_block_sectors;
+  if (ofs + fs_block_sectors < (size_t) old.length)
+    {
+      piece[parts].start = old.start == HOLE_SECTOR
+                           ? HOLE_SECTOR : old.start + ofs + fs_block_sectors;
+      piece[parts++].length = old.length - ofs - fs_block_sectors;
+    }
+  memmove (&inode->extents[i + parts], &inode->extents[i + 1],
+           (inode->extent_cnt - i - 1) * sizeof *inode->extents);
+  memcpy (&inode->extents[i], piece, parts * sizeof *piece);
+  inode->extent_cnt += parts - 1;
+  extents_coalesce (inode);
+  inode->extents_dirty = true;
+
+  for (k = 0; k < fs_block_sectors; k++)
+    data_write (inode, sector + k, data + k * BLOCK_SECTOR_SIZE);
+  return sector + n % fs_block_sectors;
+}
+
+/* Returns the disk sector holding data sector N of INODE,
+   HOLE_SECTOR if N lies in a hole, or NULL_SECTOR if INODE has
+   fewer than N + 1 data sectors. */
+static block_sector_t
+extents_lookup (const struct inode *inode, size_t n)
+{
+  size_t i;
+
+  for (i = 0; i < inode->extent_cnt; i++)
+    {
+      if (n < (size_t) inode->extents[i].length)
+        return inode->extents[i].start == HOLE_SECTOR
+               ? HOLE_SECTOR : inode->extents[i].start + n;
+      n -= inode->extents[i].length;
+    }
+  return NULL_SECTOR;
+}
+
+/* Releases the data sectors of INODE past the first KEEP,
+   including holes. */
+static void
+extents_truncate (struct inode *inode, size_t keep)
+{
+  while (inode->sector_cnt > keep)
+    {
+      struct inode_extent *last = &inode->extents[inode->extent_cnt - 1];
+      size_t excess = inode->sector_cnt - keep;
+      size_t drop = excess < (size_t) last->length ? excess : (size_t) last->length;
+
+      if (last->start != HOLE_SECTOR)
+        free_map_release (last->start + last->length - drop, drop);
+      last->length -= drop;
+      inode->sector_cnt -= drop;
+      if (last->length == 0)
+        inode->extent_cnt--;
+      inode->extents_dirty = true;
+    }
+}
+
+/* Adds CNT data sectors to the end of INODE, filled from DATA.  If
+   DATA is a null pointer the sectors are not written at all, and
+   it is up to the caller to write or zero them before they become
+   part of the file.
+   Each run is asked for right after the current last extent, or
+   right after the inode sector for an empty file, so that a file
+   growing by appends stays in one extent close to its inode and
+   the free map only splits it when the disk is fragmented.
+   CNT must be a whole number of blocks.
+   Returns false, leaving INODE unchanged, if the disk is full. */
+static bool
+inode_allocate (struct inode *inode, size_t cnt, const uint8_t *data)
+{
+  size_t old_cnt = inode->sector_cnt;
+
+  ASSERT (cnt % fs_block_sectors == 0);
+
+  while (cnt > 0)
+    {
+      block_sector_t start;
+      size_t got, i;
+
+      got = free_map_allocate_near (cnt, extents_goal (inode), &start);
+      if (got == 0 || !extents_push (inode, start, got))
+        {
+          if (got > 0)
+            free_map_release (start, got);
+          extents_truncate (inode, old_cnt);
+          return false;
+        }
+      for (i = 0; data != NULL && i < got; i++)
+        {
+          data_write (inode, start + i, data);
+          data += BLOCK_SECTOR_SIZE;
+        }
+      cnt -= got;
+    }
   return true;
 }
 
-void init_disk_inode( struct inode_disk* disk_inode )
+/* Makes data sectors of INODE from its current end up to, but not
+   including, the block holding sector FIRST a hole, for a write
+   that starts past end of file.  Sectors already allocated or
+   delayed are kept.
+   Returns false if out of memory or disk space. */
+static bool
+inode_skip (struct inode *inode, size_t first)
+{
+  first -= first % fs_block_sectors;
+  if (first <= inode->sector_cnt + inode->delalloc_cnt)
+    return true;
+  return delalloc_flush (inode)
+         && extents_push (inode, HOLE_SECTOR, first - inode->sector_cnt);
+}
+
+/* Gives INODE SECTORS data sectors in all, counting delayed ones.
+   Small appends are held in memory, against a reservation in the
+   free map, so that a file written a little at a time is placed
+   in one piece once its size is known instead of a sector at a
+   time.  Writes too large to hold back get sectors at once, and
+   so does a file that outgrows the buffer, together with room to
+   grow into.
+   Returns false if the disk is full or memory runs out. */
+static bool
+inode_extend (struct inode *inode, size_t sectors)
+{
+  if (sectors <= inode->sector_cnt + inode->delalloc_cnt)
+    return true;
+  if (sectors - inode->sector_cnt > DELALLOC_MAX_SECTORS)
+    {
+      if (!delalloc_flush (inode))
+        return false;
+      if (sectors - inode->sector_cnt > DELALLOC_MAX_SECTORS
+          && !inode_allocate (inode, sectors - inode->sector_cnt, NULL))
+        return false;
+      inode_speculate (inode);
+      if (sectors <= inode->sector_cnt)
+        return true;
+    }
+  return delalloc_grow (inode, sectors - inode->sector_cnt);
+}
+
+/* Allocates sectors past the end of INODE, which keeps growing,
+   so that the next appends find room right behind the file even
+   if other files are being written at the same time.  Each round
+   asks for as many sectors as the file already has, up to
+   PREALLOC_MAX_SECTORS, and only takes them if they continue the
+   last extent.  What the file does not grow into is given back
+   when it is closed. */
+static void
+inode_speculate (struct inode *inode)
+{
+  block_sector_t goal, start;
+  size_t want, got;
+
+  /* Called only once the file has grown past all its sectors, so
+     earlier speculative ones are all in use by now. */
+  inode->spec_cnt = 0;
+  if (inode->extent_cnt == 0
+      || inode->extents[inode->extent_cnt - 1].start == HOLE_SECTOR)
+    return;
+  goal = extents_goal (inode);
+  want = inode->sector_cnt < PREALLOC_MAX_SECTORS
+         ? inode->sector_cnt : PREALLOC_MAX_SECTORS;
+
+  got = free_map_allocate_near (want, goal, &start);
+  if (got == 0)
+    return;
+  if (start != goal || !extents_push (inode, start, got))
+    {
+      free_map_release (start, got);
+      return;
+    }
+  inode->spec_cnt = got;
+}
+
+/* Writes zeros over CNT data sectors of INODE starting at data
+   sector FIRST, skipping delayed ones and holes, which read as
+   zeros already. */
+static void
+zero_sectors (struct inode *inode, size_t first, size_t cnt)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  size_t n;
+
+  for (n = first; n < first + cnt && n < inode->sector_cnt; n++)
+    {
+      block_sector_t sector = extents_lookup (inode, n);
+      if (sector != HOLE_SECTOR)
+        data_write (inode, sector, zeros);
+    }
+}
+
+/* Grows the delayed data of INODE to CNT zeroed sectors, reserving
+   free space for the new ones.
+   Returns false if the disk is full or memory runs out. */
+static bool
+delalloc_grow (struct inode *inode, size_t cnt)
+{
+  size_t more = cnt - inode->delalloc_cnt;
+
+  ASSERT (cnt > inode->delalloc_cnt && cnt <= DELALLOC_MAX_SECTORS);
+
+  if (cnt > inode->delalloc_cap)
+    {
+      size_t cap = inode->delalloc_cap * 2;
+      uint8_t *delalloc;
+
+      if (cap < cnt)
+        cap = cnt;
+      if (cap > DELALLOC_MAX_SECTORS)
+        cap = DELALLOC_MAX_SECTORS;
+      delalloc = realloc (inode->delalloc, cap * BLOCK_SECTOR_SIZE);
+      if (delalloc == NULL)
+        return false;
+      inode->delalloc = delalloc;
+      inode->delalloc_cap = cap;
+    }
+  if (!free_map_reserve (more))
+    return false;
+  memset (inode->delalloc + inode->delalloc_cnt * BLOCK_SECTOR_SIZE, 0,
+          more * BLOCK_SECTOR_SIZE);
+  inode->delalloc_cnt = cnt;
+  return true;
+}
+
+/* Places the delayed data of INODE on disk, all in one allocation
+   so that it ends up contiguous with the rest of the file.
+   Returns false if the sectors could not be allocated, in which
+   case the data stays delayed. */
+static bool
+delalloc_flush (struct inode *inode)
+{
+  size_t cnt = inode->delalloc_cnt;
+
+  if (cnt == 0)
+    return true;
+  free_map_unreserve (cnt);
+  if (!inode_allocate (inode, cnt, inode->delalloc))
+    {
+      free_map_reserve (cnt);
+      return false;
+    }
+  inode->delalloc_cnt = 0;
+  return true;
+}
+
+/* Gives up the delayed data of INODE, for when its last opener
+   closes it and delalloc_flush() could not place it.  The file is
+   cut back to the data it has on disk, the free space held for the
+   data is released, and the loss is reported, since no caller is
+   left to see an error. */
+static void
+delalloc_drop (struct inode *inode)
+{
+  off_t on_disk = inode->sector_cnt * BLOCK_SECTOR_SIZE;
+
+  if (inode->data.file_total_size > on_disk)
+    {
+      printf ("inode %"PRDSNu": out of space, %"PROTd" bytes lost\n",
+              inode->sector, inode->data.file_total_size - on_disk);
+      inode->data.file_total_size = on_disk;
+    }
+  free_map_unreserve (inode->delalloc_cnt);
+  inode->delalloc_cnt = 0;
+}
+
+/* Returns the in-memory copy of data sector N of INODE if that
+   sector is delayed, otherwise a null pointer. */
+static uint8_t *
+delalloc_sector (const struct inode *inode, size_t n)
+{
+  if (n < inode->sector_cnt || n - inode->sector_cnt >= inode->delalloc_cnt)
+    return NULL;
+  return inode->delalloc + (n - inode->sector_cnt) * BLOCK_SECTOR_SIZE;
+}
+
+/* Moves the data of an inline INODE out of the inode sector and
+   turns it into a regular, extent based inode.  The data becomes
+   a delayed block, placed along with whatever follows it, or the
+   first cluster of a compressed file.
+   Returns false if out of space or memory, in which case INODE is
+   left unchanged. */
+static bool
+inode_uninline (struct inode *inode)
+{
+  struct inode_disk *disk_inode = &inode->data;
+  off_t length = disk_inode->file_total_size;
+
+  ASSERT (disk_inode->flags & INODE_INLINE);
+  ASSERT (INODE_INLINE_SIZE <= BLOCK_SECTOR_SIZE);
+
+  if (length > 0 && disk_inode->flags & INODE_COMPRESSED)
+    {
+      /* A compressed file's data becomes its first cluster. */
+      if (!cluster_load (inode, 0))
+        return false;
+      memcpy (inode->cluster, disk_inode->inline_data, length);
+      inode->cluster_dirty = true;
+    }
+  else if (length > 0)
+    {
+      if (!delalloc_grow (inode, fs_block_sectors))
+        return false;
+      memcpy (inode->delalloc, disk_inode->inline_data, length);
+    }
+
+  memset (disk_inode->inline_data, 0, INODE_INLINE_SIZE);
+  init_disk_inode (disk_inode);
+  disk_inode->flags &= ~INODE_INLINE;
+  return true;
+}
+
+/* Replaces data sectors FIRST through FIRST + CNT - 1 of INODE
+   with the PIECE_CNT runs in PIECES, followed by a hole for the
+   rest of the CNT sectors, and releases the sectors they held.  A
+   range past the end of INODE is appended instead, after a hole
+   from the current end.  The range must lie wholly inside INODE
+   or wholly past its end, and cover whole blocks.
+   Returns false, leaving INODE unchanged, if out of memory. */
+static bool
+extents_replace (struct inode *inode, size_t first, size_t cnt,
+                 const struct inode_extent *pieces, size_t piece_cnt)
+{
+  struct inode_extent *extents;
+  size_t end = first + cnt, pos = 0, used = 0, cap, i, j = 0, k;
+
+  for (k = 0; k < piece_cnt; k++)
+    used += pieces[k].length;
+  ASSERT (used <= cnt);
+
+  /* At most one extent is split in two, and a hole follows the
+     pieces. */
+  cap = inode->extent_cnt + piece_cnt + 2;
+  if (first >= inode->sector_cnt)
+    {
+      if (!extents_reserve (inode, cap))
+        return false;
+      extents_push (inode, HOLE_SECTOR, first - inode->sector_cnt);
+      for (k = 0; k < piece_cnt; k++)
+        extents_push (inode, pieces[k].start, pieces[k].length);
+      extents_push (inode, HOLE_SECTOR, cnt - used);
+      return true;
+    }
+  ASSERT (end <= inode->sector_cnt);
+
+  extents = malloc (cap * sizeof *extents);
+  if (extents == NULL)
+    return false;
+  for (i = 0; i < inode->extent_cnt; pos += inode->extents[i++].length)
+    {
+      struct inode_extent e = inode->extents[i];
+      size_t e_end = pos + e.length;
+      size_t lo = pos > first ? pos : first;
+      size_t hi = e_end < end ? e_end : end;
+
+      if (e_end <= first || pos >= end)
+        {
+          extents[j++] = e;
+          continue;
+        }
+      if (pos < first)
+        {
+          extents[j].start = e.start;
+          extents[j++].length = first - pos;
+        }
+      if (pos <= first)
+        {
+          for (k = 0; k < piece_cnt; k++)
+            extents[j++] = pieces[k];
+          if (used < cnt)
+            {
+              extents[j].start = HOLE_SECTOR;
+              extents[j++].length = cnt - used;
+            }
+        }
+      if (e.start != HOLE_SECTOR)
+        free_map_release (e.start + (lo - pos), hi - lo);
+      if (e_end > end)
+        {
+          extents[j].start = e.start == HOLE_SECTOR
+                             ? HOLE_SECTOR : e.start + (end - pos);
+          extents[j++].length = e_end - end;
+        }
+    }
+
+  free (inode->extents);
+  inode->extents = extents;
+  inode->extent_cnt = j;
+  inode->extent_cap = cap;
+  extents_coalesce (inode);
+  inode->extents_dirty = true;
+  return true;
+}
+
+/* Returns how many sectors of the cluster of INODE starting at
+   data sector FIRST are on disk, that is, come before its hole or
+   the end of INODE's sectors. */
+static size_t
+cluster_real (const struct inode *inode, size_t first)
+{
+  size_t k;
+
+  for (k = 0; k < CLUSTER_SECTORS; k++)
+    {
+      block_sector_t sector = extents_lookup (inode, first + k);
+      if (sector == HOLE_SECTOR || sector == NULL_SECTOR)
+        break;
+    }
+  return k;
+}
+
+/* Makes cluster C the decompressed cluster of INODE, writing back
+   the one it held before if that changed.  A cluster past the end
+   of INODE's sectors reads as zeros.
+   Returns false if the old cluster could not be written back,
+   memory runs out, or C's data is corrupt. */
+static bool
+cluster_load (struct inode *inode, size_t c)
+{
+  size_t first = c * CLUSTER_SECTORS, real, k;
+  uint8_t *packed;
+  uint32_t size;
+  bool success;
+
+  if (inode->cluster_idx == c)
+    return true;
+  if (!cluster_store (inode))
+    return false;
+  if (inode->cluster == NULL)
+    {
+      inode->cluster = malloc (CLUSTER_SIZE);
+      if (inode->cluster == NULL)
+        return false;
+    }
+  inode->cluster_idx = SIZE_MAX;
+
+  real = cluster_real (inode, first);
+  if (real == 0)
+    memset (inode->cluster, 0, CLUSTER_SIZE);
+  else if (real == CLUSTER_SECTORS)
+    for (k = 0; k < CLUSTER_SECTORS; k++)
+      sector_read (extents_lookup (inode, first + k),
+                   inode->cluster + k * BLOCK_SECTOR_SIZE,
+                   inode->cache_class);
+  else
+    {
+      packed = malloc (real * BLOCK_SECTOR_SIZE);
+      if (packed == NULL)
+        return false;
+      for (k = 0; k < real; k++)
+        sector_read (extents_lookup (inode, first + k),
+                     packed + k * BLOCK_SECTOR_SIZE,
+                     inode->cache_class);
+      memcpy (&size, packed, sizeof size);
+      success = size <= real * BLOCK_SECTOR_SIZE - sizeof size
+                && lz_decompress (packed + sizeof size, size, inode->cluster,
+                                  CLUSTER_SIZE) == CLUSTER_SIZE;
+      free (packed);
+      if (!success)
+        return false;
+    }
+  inode->cluster_idx = c;
+  inode->cluster_dirty = false;
+  return true;
+}
+
+/* Writes the decompressed cluster of INODE back to disk if it
+   changed: compressed, if that saves at least a block; as it is,
+   otherwise; or not at all, if it is all zeros.  The cluster keeps
+   its sectors if it needs as many as before and no clone shares
+   them, and otherwise gets new ones near the end of the file.
+   Returns false, leaving the cluster dirty, if the disk is full or
+   memory runs out. */
+static bool
+cluster_store (struct inode *inode)
+{
+  const size_t max = (CLUSTER_SECTORS - fs_block_sectors) * BLOCK_SECTOR_SIZE;
+  size_t first = inode->cluster_idx * CLUSTER_SECTORS;
+  struct inode_extent pieces[CLUSTER_SECTORS];
+  size_t piece_cnt = 0, real = 0, k, i;
+  const uint8_t *data = inode->cluster;
+  block_sector_t goal;
+  uint8_t *packed;
+  bool in_place;
+
+  if (!inode->cluster_dirty)
+    return true;
+  packed = malloc (CLUSTER_SIZE + LZ_WORK_SIZE);
+  if (packed == NULL)
+    return false;
+
+  for (k = 0; k < CLUSTER_SIZE && inode->cluster[k] == 0; k++)
+    continue;
+  if (k < CLUSTER_SIZE)
+    {
+      uint32_t size = lz_compress (inode->cluster, CLUSTER_SIZE,
+                                   packed + sizeof size, max - sizeof size,
+                                   packed + CLUSTER_SIZE);
+      if (size > 0)
+        {
+          real = ROUND_UP (DIV_ROUND_UP (sizeof size + size, BLOCK_SECTOR_SIZE),
+                           fs_block_sectors);
+          memcpy (packed, &size, sizeof size);
+          memset (packed + sizeof size + size, 0,
+                  real * BLOCK_SECTOR_SIZE - sizeof size - size);
+          data = packed;
+        }
+      else
+        real = CLUSTER_SECTORS;
+    }
+
+  in_place = cluster_real (inode, first) == real;
+  for (k = 0; in_place && k < real; k += fs_block_sectors)
+    in_place = !free_map_shared (extents_lookup (inode, first + k));
+  if (in_place)
+    {
+      for (k = 0; k < real; k++)
+        data_write (inode, extents_lookup (inode, first + k),
+                    data + k * BLOCK_SECTOR_SIZE);
+      goto done;
+    }
+
+  /* Gather new sectors, in as few runs as free space allows. */
+  goal = extents_goal (inode);
+  for (k = 0; k < real; k += pieces[piece_cnt++].length)
+    {
+      size_t got = free_map_allocate_near (real - k, goal,
+                                           &pieces[piece_cnt].start);
+      if (got == 0)
+        goto fail;
+      pieces[piece_cnt].length = got;
+      goal = pieces[piece_cnt].start + got;
+    }
+  if (!extents_replace (inode, first, CLUSTER_SECTORS, pieces, piece_cnt))
+    goto fail;
+  for (i = 0, k = 0; i < piece_cnt; i++)
+    {
+      off_t n;
+      for (n = 0; n < pieces[i].length; n++, k++)
+        data_write (inode, pieces[i].start + n, data + k * BLOCK_SECTOR_SIZE);
+    }
+
+ done:
+  inode->cluster_dirty = false;
+  free (packed);
+  return true;
+
+ fail:
+  while (piece_cnt-- > 0)
+    free_map_release (pieces[piece_cnt].start, pieces[piece_cnt].length);
+  free (packed);
+  return false;
+}
+
+/* Gives up the changed cluster of INODE, for when its last opener
+   closes it and cluster_store() could not write it back.  The
+   cluster keeps what it had on disk.  If it is the file's last
+   cluster, the file is cut back to where the cluster starts, so
+   that its length does not claim data the disk never got.  The
+   loss is reported, since no caller is left to see an error. */
+static void
+cluster_drop (struct inode *inode)
+{
+  off_t start = inode->cluster_idx * CLUSTER_SIZE;
+
+  printf ("inode %"PRDSNu": out of space, changes at offset %"PROTd
+          " lost\n", inode->sector, start);
+  if (inode->data.file_total_size > start
+      && inode->data.file_total_size <= start + CLUSTER_SIZE)
+    inode->data.file_total_size = start;
+  inode->cluster_dirty = false;
+}
+
+/* Does the work of read_at() for a compressed INODE, a cluster at
+   a time. */
+static off_t
+compressed_read (struct inode *inode, uint8_t *buffer, off_t size,
+                 off_t offset)
+{
+  off_t bytes_read = 0;
+
+  if (size > inode_length (inode) - offset)
+    size = inode_length (inode) - offset;
+  while (size > 0)
+    {
+      size_t cluster_ofs = offset % CLUSTER_SIZE;
+      off_t chunk = CLUSTER_SIZE - cluster_ofs;
+
+      if (chunk > size)
+        chunk = size;
+      if (!cluster_load (inode, offset / CLUSTER_SIZE))
+        break;
+      memcpy (buffer + bytes_read, inode->cluster + cluster_ofs, chunk);
+
+      size -= chunk;
+      offset += chunk;
+      bytes_read += chunk;
+    }
+  return bytes_read;
+}
+
+/* Does the work of write_at() for a compressed INODE, a cluster at
+   a time.  The data only reaches the disk when the cluster is
+   written back, so a file that grows needs no sectors up front,
+   and the part of it skipped over by a write past end of file is
+   never stored at all. */
+static off_t
+compressed_write (struct inode *inode, const uint8_t *buffer, off_t size,
+                  off_t offset)
+{
+  off_t bytes_written = 0;
+
+  while (size > 0)
+    {
+      size_t cluster_ofs = offset % CLUSTER_SIZE;
+      off_t chunk = CLUSTER_SIZE - cluster_ofs;
+
+      if (chunk > size)
+        chunk = size;
+      if (!cluster_load (inode, offset / CLUSTER_SIZE))
+        break;
+      memcpy (inode->cluster + cluster_ofs, buffer + bytes_written, chunk);
+      inode->cluster_dirty = true;
+
+      size -= chunk;
+      offset += chunk;
+      bytes_written += chunk;
+    }
+  if (bytes_written > 0 && offset > inode->data.file_total_size)
+    inode->data.file_total_size = offset;
+  return bytes_written;
+}
+
+static void
+init_disk_inode( struct inode_disk* disk_inode )
 {
   int i = 0;
   for( i = 0; i < INODE_DISK_ARRAY_SIZE; ++i )
   {
     disk_inode->start[i] = NULL_SECTOR;
   }
+  disk_inode->next_sector = NULL_SECTOR;
   disk_inode->magic = INODE_MAGIC;
 }
 
@@ -4,10 +4,21 @@
 #include <stdbool.h>
 #include "filesys/off_t.h"
 #include "devices/block.h"
+#include "filesys/cache.h"
 
 struct bitmap;
 struct inode;
 
+/* How one opener of an inode uses its data, as set with
+   fadvise. */
+struct inode_advice
+  {
+    int advice;                 /* POSIX_FADV_NORMAL, _RANDOM,
+                                   _SEQUENTIAL or _NOREUSE. */
+    off_t ahead;                /* End of the read-ahead window of a
+                                   sequential reader. */
+  };
+
 void inode_init (void);
 #ifdef FILESYS_SUBDIRS
 bool inode_create (block_sector_t, off_t, block_sector_t);
@@ -21,9 +32,28 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_read_advised (struct inode *, void *, off_t size, off_t offset,
+                          struct inode_advice *);
+off_t inode_write_advised (struct inode *, const void *, off_t size,
+                           off_t offset, const struct inode_advice *);
+off_t inode_copy (struct inode *dst, off_t dst_ofs, struct inode *src,
+                  off_t src_ofs, off_t size);
+bool inode_preallocate (struct inode *, off_t length);
+bool inode_set_compressed (struct inode *);
+bool inode_defrag (struct inode *);
+bool inode_compact (struct inode *);
+bool inode_advise (struct inode *, off_t offset, off_t len, int advice);
+#ifdef FILESYS_EXTEND_FILES
+bool inode_clone (struct inode *dst, struct inode *src);
+#endif
+bool inode_sync (struct inode *, bool data_only);
+void inode_set_metadata (struct inode *, enum cache_class);
+void inode_sync_all (void);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
+off_t inode_max_length (void);
 off_t inode_length (const struct inode *);
+off_t inode_length_at (block_sector_t);
 
 struct inode *inode_parent(const struct inode *inode);
 
@@ -0,0 +1,653 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Write-ahead journal for file system metadata.
+
+   Metadata sectors -- inodes, extent chains, directories and the
+   free map -- are not written in place as they change.  The buffer
+   cache hands every new image of one to journal_record(), which
+   keeps a copy in the running transaction, and does not write the
+   sector back itself.  A commit appends all images of the
+   transaction to the log, one sequential run of sectors, and only
+   then may they go to their home sectors.  That happens lazily, at
+   a checkpoint, when the log fills up; until then the journal's
+   copy is the newest one, and the cache reads it back through
+   journal_read() if it has evicted the sector meanwhile.
+
+   Operations bracket their metadata changes with journal_begin()
+   and journal_end().  A commit lets the operations in progress
+   finish and holds off new ones while it takes its snapshot, so
+   that each operation reaches the log as a whole.  At mount,
+   journal_open() replays every complete transaction in the log.
+
+   File data is not journaled, but it is ordered: a commit writes
+   back every dirty data sector in the cache before its log
+   records, so that no committed inode or extent points at sectors
+   whose data is not on disk yet.
+
+   Without the buffer cache, metadata is written in place as
+   before and the journal stays empty. */
+
+/* Identifies log records. */
+#define RECORD_MAGIC 0x4a524543         /* "JREC" */
+
+/* Sectors one log record can list. */
+#define RECORD_MAX ((BLOCK_SECTOR_SIZE - 20) / sizeof (block_sector_t))
+
+/* A log record: a descriptor sector, followed in the log by the
+   images of the CNT sectors it lists.  A transaction is one or
+   more records with the same sequence number, the last of them
+   with MORE false.  Its descriptor is written after everything
+   else, so a transaction is in the log either completely or not
+   at all. */
+struct log_record
+  {
+    unsigned magic;                     /* RECORD_MAGIC. */
+    uint32_t seq;                       /* Transaction sequence number. */
+    uint32_t cnt;                       /* Number of sectors. */
+    uint32_t more;                      /* Nonzero if not the last record. */
+    uint32_t checksum;                  /* Over the fields above, SECTORS
+                                           and the images. */
+    block_sector_t sectors[RECORD_MAX]; /* Home sectors of the images. */
+  };
+
+/* A metadata sector the journal holds images of. */
+struct jblock
+  {
+    struct hash_elem hash_elem;         /* Element in blocks. */
+    struct list_elem running_elem;      /* Element in running. */
+    struct list_elem txn_elem;          /* Element in a commit's list. */
+    block_sector_t sector;              /* Home sector. */
+    uint8_t *running;                   /* Image in the running
+                                           transaction, or null. */
+    uint8_t *logging;                   /* Image being committed. */
+    uint8_t *committed;                 /* Newest committed image that
+                                           is not home yet. */
+  };
+
+/* Commit the running transaction once it is this many timer ticks
+   old, or once it holds this many sectors.  Set with the -jt and
+   -js kernel command line options. */
+static int64_t commit_interval = 100;
+static size_t commit_batch = 32;
+
+/* Sectors the journal holds images of, and those of them that
+   are in the running transaction. */
+static struct hash blocks;
+static struct list running;
+static size_t running_cnt;
+static int64_t running_since;       /* Time of the first image. */
+
+/* Operations in progress, and whether a commit is waiting for
+   them to finish before it takes its snapshot. */
+static int active;
+static bool quiescing;
+static struct condition drained;    /* Signaled when ACTIVE drops to 0. */
+static struct condition resumed;    /* Signaled when QUIESCING clears. */
+
+/* Protects the above.  Never held across disk I/O. */
+static struct lock journal_lock;
+
+/* Serializes commits and checkpoints, and protects the log
+   position below. */
+static struct lock commit_lock;
+
+/* The log, or LOG_LENGTH 0 if the file system has none, in which
+   case commits write their images in place. */
+static block_sector_t log_start;
+static size_t log_length;
+static size_t log_head;             /* Next free position in the log. */
+static uint32_t log_seq;            /* Next transaction's sequence number. */
+
+/* Buffers for log I/O, under commit_lock. */
+static struct log_record record;
+static uint8_t image[BLOCK_SECTOR_SIZE];
+
+/* Set once the above can be used; the cache dump thread may call
+   journal_tick() before the file system is up. */
+static bool initialized;
+
+static struct jblock *lookup (block_sector_t);
+static void release_if_idle (struct jblock *);
+static void log_write (struct list *);
+static void home_write (struct list *);
+static void checkpoint (void);
+static void replay (void);
+static size_t transaction_end (size_t pos);
+static void super_write (void);
+static uint32_t checksum (uint32_t, const void *, size_t);
+static unsigned jblock_hash (const struct hash_elem *, void *);
+static bool jblock_less (const struct hash_elem *, const struct hash_elem *,
+                         void *);
+static int sector_compare (const void *, const void *);
+
+/* Initializes the journal module. */
+void
+journal_init (void)
+{
+  hash_init (&blocks, jblock_hash, jblock_less, NULL);
+  list_init (&running);
+  cond_init (&drained);
+  cond_init (&resumed);
+  lock_init (&journal_lock);
+  lock_init (&commit_lock);
+  initialized = true;
+}
+
+/* Sets how old, in timer ticks, and how large, in sectors, the
+   running transaction may grow before it is committed.  Zero
+   leaves a setting as it is. */
+void
+journal_configure (int64_t interval, size_t batch)
+{
+  if (interval > 0)
+    commit_interval = interval;
+  if (batch > 0)
+    commit_batch = batch;
+}
+
+/* Allocates the log and writes an empty journal superblock, while
+   formatting the file system. */
+void
+journal_create (void)
+{
+  size_t length = block_size (fs_device) / LOG_FRACTION;
+
+  if (length < LOG_MIN_SECTORS)
+    length = LOG_MIN_SECTORS;
+  if (length > LOG_MAX_SECTORS)
+    length = LOG_MAX_SECTORS;
+  if (!free_map_allocate (length, &log_start))
+    PANIC ("journal creation failed");
+  log_length = length;
+  log_head = 0;
+  log_seq = 1;
+  super_write ();
+}
+
+/* Reads the journal superblock and replays the transactions left
+   in the log, which is empty afterwards.  Must run before any
+   metadata is read. */
+void
+journal_open (void)
+{
+  struct journal_super *super = (struct journal_super *) image;
+
+  lock_acquire (&commit_lock);
+  block_read (fs_device, JOURNAL_SECTOR, super);
+  if (super->magic != JOURNAL_MAGIC)
+    {
+      printf ("journal: none found, writing metadata in place\n");
+      log_length = 0;
+    }
+  else
+    {
+      log_start = super->start;
+      log_length = super->length;
+      log_seq = super->seq;
+      replay ();
+      log_head = 0;
+      super_write ();
+    }
+  lock_release (&commit_lock);
+}
+
+/* Commits the running transaction and writes everything the
+   journal holds to its home sectors, leaving the log empty. */
+void
+journal_close (void)
+{
+  journal_commit ();
+  lock_acquire (&commit_lock);
+  checkpoint ();
+  lock_release (&commit_lock);
+}
+
+/* Starts an operation that changes metadata.  Its changes are
+   committed together.  Operations nest; only the outermost one
+   counts.  Must be called before taking any file system lock,
+   because it waits for a commit in progress to take its
+   snapshot, which may need those locks. */
+void
+journal_begin (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->journal_depth++ > 0)
+    return;
+  lock_acquire (&journal_lock);
+  while (quiescing)
+    cond_wait (&resumed, &journal_lock);
+  active++;
+  lock_release (&journal_lock);
+}
+
+/* Ends an operation started with journal_begin().  Commits the
+   running transaction if it has grown large enough. */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+  bool full;
+
+  ASSERT (t->journal_depth > 0);
+  if (--t->journal_depth > 0)
+    return;
+  lock_acquire (&journal_lock);
+  if (--active == 0)
+    cond_signal (&drained, &journal_lock);
+  full = running_cnt >= commit_batch;
+  lock_release (&journal_lock);
+  if (full)
+    journal_commit ();
+}
+
+/* Records IMAGE, a full sector, as the new contents of metadata
+   sector SECTOR.  The journal owns writing it back from now on. */
+void
+journal_record (block_sector_t sector, const void *image_)
+{
+  struct jblock *b;
+
+  lock_acquire (&journal_lock);
+  b = lookup (sector);
+  if (b == NULL)
+    {
+      b = calloc (1, sizeof *b);
+      if (b == NULL)
+        PANIC ("out of memory for journal");
+      b->sector = sector;
+      hash_insert (&blocks, &b->hash_elem);
+    }
+  if (b->running == NULL)
+    {
+      b->running = malloc (BLOCK_SECTOR_SIZE);
+      if (b->running == NULL)
+        PANIC ("out of memory for journal");
+      if (running_cnt++ == 0)
+        running_since = timer_ticks ();
+      list_push_back (&running, &b->running_elem);
+    }
+  memcpy (b->running, image_, BLOCK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+}
+
+/* Copies the newest image of SECTOR that has not reached its home
+   sector yet into IMAGE_.  Returns false, leaving IMAGE_ alone, if
+   the disk copy is current. */
+bool
+journal_read (block_sector_t sector, void *image_)
+{
+  struct jblock *b;
+  const uint8_t *newest = NULL;
+
+  lock_acquire (&journal_lock);
+  b = lookup (sector);
+  if (b != NULL)
+    newest = b->running != NULL ? b->running
+             : b->logging != NULL ? b->logging : b->committed;
+  if (newest != NULL)
+    memcpy (image_, newest, BLOCK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+  return newest != NULL;
+}
+
+/* Returns true if the journal holds an image of SECTOR, so that
+   the sector may be written by a replay or a checkpoint. */
+bool
+journal_holds (block_sector_t sector)
+{
+  bool holds;
+
+  lock_acquire (&journal_lock);
+  holds = lookup (sector) != NULL;
+  lock_release (&journal_lock);
+  return holds;
+}
+
+/* Commits the running transaction to the log, along with the
+   free map as it stands once the operations in progress are
+   done.  Must not be called inside an operation. */
+void
+journal_commit (void)
+{
+  struct thread *t = thread_current ();
+  struct list txn;
+  struct list_elem *e;
+
+  ASSERT (t->journal_depth == 0);
+
+  lock_acquire (&commit_lock);
+  lock_acquire (&journal_lock);
+  quiescing = true;
+  while (active > 0)
+    cond_wait (&drained, &journal_lock);
+  lock_release (&journal_lock);
+
+  /* Writing out the free map is an operation of its own, which
+     must not wait for this commit. */
+  t->journal_depth++;
+  free_map_flush ();
+  t->journal_depth--;
+
+  lock_acquire (&journal_lock);
+  list_init (&txn);
+  while (!list_empty (&running))
+    {
+      struct jblock *b = list_entry (list_pop_front (&running),
+                                     struct jblock, running_elem);
+      b->logging = b->running;
+      b->running = NULL;
+      list_push_back (&txn, &b->txn_elem);
+    }
+  running_cnt = 0;
+  quiescing = false;
+  cond_broadcast (&resumed, &journal_lock);
+  lock_release (&journal_lock);
+
+  if (!list_empty (&txn))
+    {
+      size_t cnt = list_size (&txn);
+      size_t need = cnt + DIV_ROUND_UP (cnt, RECORD_MAX);
+
+      /* Data the snapshot's metadata points at goes first. */
+#ifdef FILESYS_USE_CACHE
+      cache_sync ();
+#endif
+      if (log_head + need > log_length)
+        checkpoint ();
+      if (need <= log_length)
+        log_write (&txn);
+      else
+        home_write (&txn);
+
+      lock_acquire (&journal_lock);
+      for (e = list_begin (&txn); e != list_end (&txn); )
+        {
+          struct jblock *b = list_entry (e, struct jblock, txn_elem);
+          e = list_next (e);
+          free (b->committed);
+          b->committed = need <= log_length ? b->logging : NULL;
+          if (b->committed == NULL)
+            free (b->logging);
+          b->logging = NULL;
+          release_if_idle (b);
+        }
+      lock_release (&journal_lock);
+    }
+  lock_release (&commit_lock);
+}
+
+/* Commits the running transaction if it is old enough.  Called
+   periodically by the cache dump thread. */
+void
+journal_tick (void)
+{
+  bool due;
+
+  if (!initialized)
+    return;
+  lock_acquire (&journal_lock);
+  due = running_cnt > 0 && timer_elapsed (running_since) >= commit_interval;
+  lock_release (&journal_lock);
+  if (due)
+    journal_commit ();
+}
+
+/* Returns the block for SECTOR, or a null pointer if the journal
+   holds no image of it.  The caller holds journal_lock. */
+static struct jblock *
+lookup (block_sector_t sector)
+{
+  struct jblock key;
+  struct hash_elem *e;
+
+  key.sector = sector;
+  e = hash_find (&blocks, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct jblock, hash_elem) : NULL;
+}
+
+/* Forgets B if it holds no images any more.  The caller holds
+   journal_lock. */
+static void
+release_if_idle (struct jblock *b)
+{
+  if (b->running == NULL && b->logging == NULL && b->committed == NULL)
+    {
+      hash_delete (&blocks, &b->hash_elem);
+      free (b);
+    }
+}
+
+/* Appends the images of TXN, a list of blocks, to the log as one
+   transaction.  The caller holds commit_lock and has made room. */
+static void
+log_write (struct list *txn)
+{
+  struct list_elem *e = list_begin (txn);
+  size_t left = list_size (txn);
+
+  while (left > 0)
+    {
+      size_t pos = log_head;
+      size_t cnt = left < RECORD_MAX ? left : RECORD_MAX;
+      uint32_t sum;
+      size_t i;
+
+      memset (&record, 0, sizeof record);
+      record.magic = RECORD_MAGIC;
+      record.seq = log_seq;
+      record.cnt = cnt;
+      record.more = left > cnt;
+      sum = checksum (2166136261u, &record.seq, 3 * sizeof (uint32_t));
+      for (i = 0; i < cnt; i++, e = list_next (e))
+        {
+          struct jblock *b = list_entry (e, struct jblock, txn_elem);
+          record.sectors[i] = b->sector;
+          sum = checksum (sum, &b->sector, sizeof b->sector);
+          sum = checksum (sum, b->logging, BLOCK_SECTOR_SIZE);
+          block_write (fs_device, log_start + pos + 1 + i, b->logging);
+        }
+      record.checksum = sum;
+      block_write (fs_device, log_start + pos, &record);
+      log_head += 1 + cnt;
+      left -= cnt;
+    }
+  log_seq++;
+}
+
+/* Writes the images of TXN, a transaction too large for the log
+   or a file system without one, straight to their home sectors,
+   in order.  Such a transaction is not atomic. */
+static void
+home_write (struct list *txn)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (txn); e != list_end (txn); e = list_next (e))
+    {
+      struct jblock *b = list_entry (e, struct jblock, txn_elem);
+      block_write (fs_device, b->sector, b->logging);
+    }
+}
+
+/* Writes every committed image to its home sector, in sector
+   order, and empties the log.  Sectors freed meanwhile become
+   available again.  The caller holds commit_lock. */
+static void
+checkpoint (void)
+{
+  struct jblock **home = NULL;
+  struct hash_iterator i;
+  size_t cnt = 0, k;
+
+  lock_acquire (&journal_lock);
+  if (hash_size (&blocks) > 0)
+    {
+      home = malloc (hash_size (&blocks) * sizeof *home);
+      if (home == NULL)
+        PANIC ("out of memory for journal");
+      hash_first (&i, &blocks);
+      while (hash_next (&i))
+        {
+          struct jblock *b = hash_entry (hash_cur (&i), struct jblock,
+                                         hash_elem);
+          if (b->committed != NULL)
+            home[cnt++] = b;
+        }
+    }
+  lock_release (&journal_lock);
+
+  /* Committed images only change under commit_lock, which we
+     hold, so they can be written without journal_lock. */
+  if (cnt > 1)
+    qsort (home, cnt, sizeof *home, sector_compare);
+  for (k = 0; k < cnt; k++)
+    block_write (fs_device, home[k]->sector, home[k]->committed);
+  if (log_length > 0)
+    {
+      log_head = 0;
+      super_write ();
+    }
+
+  lock_acquire (&journal_lock);
+  for (k = 0; k < cnt; k++)
+    {
+      free (home[k]->committed);
+      home[k]->committed = NULL;
+      release_if_idle (home[k]);
+    }
+  lock_release (&journal_lock);
+  free (home);
+
+  free_map_unhold ();
+}
+
+/* Writes the home sectors of every complete transaction in the
+   log, oldest first.  The caller holds commit_lock. */
+static void
+replay (void)
+{
+  size_t pos = 0, cnt = 0;
+
+  for (;;)
+    {
+      size_t end = transaction_end (pos);
+      if (end == pos)
+        break;
+      while (pos < end)
+        {
+          size_t i;
+
+          block_read (fs_device, log_start + pos, &record);
+          for (i = 0; i < record.cnt; i++)
+            {
+              block_read (fs_device, log_start + pos + 1 + i, image);
+              block_write (fs_device, record.sectors[i], image);
+            }
+          pos += 1 + record.cnt;
+        }
+      log_seq++;
+      cnt++;
+    }
+  if (cnt > 0)
+    printf ("journal: replayed %zu transactions\n", cnt);
+}
+
+/* Checks the transaction with sequence number log_seq whose first
+   record is at log position POS.  Returns the position just past
+   it if all of its records are in the log intact, otherwise POS. */
+static size_t
+transaction_end (size_t pos)
+{
+  size_t end = pos;
+
+  do
+    {
+      uint32_t sum;
+      size_t i;
+
+      if (end >= log_length)
+        return pos;
+      block_read (fs_device, log_start + end, &record);
+      if (record.magic != RECORD_MAGIC || record.seq != log_seq
+          || record.cnt > RECORD_MAX || end + 1 + record.cnt > log_length)
+        return pos;
+      sum = checksum (2166136261u, &record.seq, 3 * sizeof (uint32_t));
+      for (i = 0; i < record.cnt; i++)
+        {
+          block_read (fs_device, log_start + end + 1 + i, image);
+          sum = checksum (sum, &record.sectors[i], sizeof record.sectors[i]);
+          sum = checksum (sum, image, BLOCK_SECTOR_SIZE);
+        }
+      if (sum != record.checksum)
+        return pos;
+      end += 1 + record.cnt;
+    }
+  while (record.more);
+  return end;
+}
+
+/* Writes the journal superblock, describing an empty log whose
+   first transaction will be log_seq. */
+static void
+super_write (void)
+{
+  struct journal_super *super = (struct journal_super *) image;
+
+  memset (super, 0, sizeof *super);
+  super->magic = JOURNAL_MAGIC;
+  super->start = log_start;
+  super->length = log_length;
+  super->seq = log_seq;
+  block_write (fs_device, JOURNAL_SECTOR, super);
+}
+
+/* Folds SIZE bytes of DATA into SUM, FNV-1a style. */
+static uint32_t
+checksum (uint32_t sum, const void *data_, size_t size)
+{
+  const uint8_t *data = data_;
+
+  while (size-- > 0)
+    sum = (sum ^ *data++) * 16777619u;
+  return sum;
+}
+
+static unsigned
+jblock_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct jblock *b = hash_entry (e, struct jblock, hash_elem);
+  return hash_int (b->sector);
+}
+
+static bool
+jblock_less (const struct hash_elem *a, const struct hash_elem *b,
+             void *aux UNUSED)
+{
+  return hash_entry (a, struct jblock, hash_elem)->sector
+         < hash_entry (b, struct jblock, hash_elem)->sector;
+}
+
+/* qsort() comparison of two jblock pointers by sector. */
+static int
+sector_compare (const void *a_, const void *b_)
+{
+  const struct jblock *a = *(struct jblock * const *) a_;
+  const struct jblock *b = *(struct jblock * const *) b_;
+
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
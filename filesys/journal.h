@@ -0,0 +1,23 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/block.h"
+
+void journal_init (void);
+void journal_create (void);
+void journal_open (void);
+void journal_close (void);
+void journal_configure (int64_t interval, size_t batch);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_record (block_sector_t, const void *);
+bool journal_read (block_sector_t, void *);
+bool journal_holds (block_sector_t);
+void journal_commit (void);
+void journal_tick (void);
+
+#endif /* filesys/journal.h */
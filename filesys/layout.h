@@ -0,0 +1,133 @@
+#ifndef FILESYS_LAYOUT_H
+#define FILESYS_LAYOUT_H
+
+/* On-disk layout of the file system.
+
+   Shared by the kernel and by utils/pintos-mkfs, which builds
+   images on the host, so it uses only fixed-width types and
+   devices/block.h.  What it describes depends on
+   FILESYS_EXTEND_FILES and FILESYS_SUBDIRS; utils/Makefile builds
+   pintos-mkfs with the DEFINES of a project's Make.vars, so that
+   it writes the layout that project's kernel reads. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/block.h"
+
+/* Sectors of system file inodes. */
+#define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
+#define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+#define SHARE_MAP_SECTOR 2      /* Share count file inode sector. */
+#define JOURNAL_SECTOR 3        /* Journal superblock sector. */
+#define SUPER_SECTOR 4          /* File system superblock sector. */
+
+/* Maximum length of a file name component.
+   This is the traditional UNIX maximum length.
+   After directories are implemented, this maximum length may be
+   retained, but much longer full path names must be allowed. */
+#define NAME_MAX 16
+
+/* Identifies an inode. */
+#define INODE_MAGIC 0x494e4f44
+
+/* Extents in an on-disk inode. */
+#define INODE_DISK_ARRAY_SIZE 61
+
+/* Inode flags. */
+#define INODE_INLINE 0x1                /* Data lives in the inode sector. */
+#define INODE_COMPRESSED 0x2            /* Data is stored in compressed
+                                           clusters. */
+
+/* Number of data bytes that fit in the inode sector itself. */
+#ifdef FILESYS_EXTEND_FILES
+#define INODE_INLINE_SIZE (INODE_DISK_ARRAY_SIZE \
+                           * (sizeof (block_sector_t) + sizeof (int32_t)))
+#else
+#define INODE_INLINE_SIZE 492
+#endif
+
+/* On-disk inode.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct inode_disk
+{
+#ifdef FILESYS_EXTEND_FILES
+    union
+      {
+        struct
+          {
+            block_sector_t start[ INODE_DISK_ARRAY_SIZE ];   /* First data sector. */
+            int32_t length[ INODE_DISK_ARRAY_SIZE ];         /* File size in sectors. */
+          };
+        uint8_t inline_data[ INODE_INLINE_SIZE ];            /* Data, if INODE_INLINE. */
+      };
+    int32_t file_total_size;            /* total size of the file */
+    block_sector_t next_sector;         /* Address of the next inode_disk */
+    uint32_t flags;                     /* INODE_* flags. */
+    int32_t unused[1];
+    // 504 bytes
+#else
+    block_sector_t start;               /* First data sector. */
+    int32_t length;                     /* File size in bytes. */
+    uint32_t flags;                     /* INODE_* flags. */
+    uint8_t inline_data[ INODE_INLINE_SIZE ];  /* Data, if INODE_INLINE. */
+    // 504 bytes
+#endif
+
+#ifdef FILESYS_SUBDIRS
+    block_sector_t parent_dir_inode;
+    // 4 bytes
+#else
+    int32_t unused_;
+    // 4 bytes
+#endif
+
+    unsigned magic;                     /* Magic number. */
+    // 4 bytes
+
+};
+
+/**
+ *  Disk representation of a directory entry.
+ */
+struct dir_entry
+{
+    block_sector_t inode_sector;        /* Sector number of header. */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+    bool is_directory;                  /* Type of the entry. */
+    bool in_use;                        /* In use or free? */
+};
+
+/* Identifies the journal superblock. */
+#define JOURNAL_MAGIC 0x4a524e4c        /* "JRNL" */
+
+/* Log size, as a fraction of the file system device, and the
+   limits it is kept within.  Committed images stay in memory until
+   a checkpoint, so the log size also bounds that memory. */
+#define LOG_FRACTION 32
+#define LOG_MIN_SECTORS 32
+#define LOG_MAX_SECTORS 256
+
+/* Journal superblock, in JOURNAL_SECTOR. */
+struct journal_super
+  {
+    unsigned magic;                     /* JOURNAL_MAGIC. */
+    block_sector_t start;               /* First sector of the log. */
+    uint32_t length;                    /* Log size in sectors. */
+    uint32_t seq;                       /* Sequence number of the first
+                                           transaction in the log. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 16];
+  };
+
+/* Identifies the file system superblock. */
+#define SUPER_MAGIC 0x53555052          /* "SUPR" */
+
+/* File system superblock, in SUPER_SECTOR.  Records what was
+   chosen when the file system was formatted. */
+struct super_disk
+  {
+    unsigned magic;                     /* SUPER_MAGIC. */
+    uint32_t block_sectors;             /* Sectors per block. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 8];
+  };
+
+#endif /* filesys/layout.h */
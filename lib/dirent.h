@@ -0,0 +1,24 @@
+#ifndef __LIB_DIRENT_H
+#define __LIB_DIRENT_H
+
+/* Directory entries as returned by the getdents() system call.
+   Shared between the kernel and user programs, so the layout
+   here is part of the system call interface. */
+
+#include <stdbool.h>
+
+/* Maximum characters in a name stored in a struct dirent.
+   Matches NAME_MAX in filesys/directory.h. */
+#define DIRENT_NAME_MAX 16
+
+/* One directory entry together with the attributes of the
+   inode it names. */
+struct dirent
+  {
+    int inumber;                        /* Inode number (sector). */
+    bool is_dir;                        /* True if a directory. */
+    int size;                           /* Length in bytes. */
+    char name[DIRENT_NAME_MAX + 1];     /* Null terminated name. */
+  };
+
+#endif /* lib/dirent.h */
@@ -0,0 +1,15 @@
+#ifndef __LIB_FADVISE_H
+#define __LIB_FADVISE_H
+
+/* Access hints for the fadvise() system call.  Shared between the
+   kernel and user programs, so the values here are part of the
+   system call interface.  They match POSIX and Linux. */
+
+#define POSIX_FADV_NORMAL 0             /* No particular pattern. */
+#define POSIX_FADV_RANDOM 1             /* No read-ahead. */
+#define POSIX_FADV_SEQUENTIAL 2         /* Read ahead further. */
+#define POSIX_FADV_WILLNEED 3           /* Fetch the range now. */
+#define POSIX_FADV_DONTNEED 4           /* Drop the range from the cache. */
+#define POSIX_FADV_NOREUSE 5            /* Data is used once. */
+
+#endif /* lib/fadvise.h */
@@ -359,6 +359,18 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the SIZE bytes of B that start at byte offset OFS to
+   the same offset in FILE.  Return true if successful, false
+   otherwise. */
+bool
+bitmap_write_partial (const struct bitmap *b, struct file *file,
+                      off_t ofs, off_t size)
+{
+  ASSERT (ofs >= 0 && size >= 0);
+  ASSERT ((size_t) (ofs + size) <= byte_cnt (b->bit_cnt));
+  return file_write_at (file, (const uint8_t *) b->bits + ofs, size, ofs) == size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
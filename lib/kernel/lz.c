@@ -0,0 +1,160 @@
+#include "lz.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Hash table of recent input positions, in LZ_WORK_SIZE bytes. */
+#define HASH_BITS 12
+#define HASH_SIZE (1 << HASH_BITS)
+
+#define MAX_LITERAL 32                  /* Longest literal run. */
+#define MAX_OFFSET 8192                 /* Farthest back reference. */
+#define MAX_MATCH (7 + 255 + 2)         /* Longest back reference. */
+
+/* Returns the hash of the three bytes at P. */
+static inline unsigned
+hash (const uint8_t *p)
+{
+  uint32_t v = (uint32_t) p[0] << 16 | p[1] << 8 | p[2];
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Appends the CNT literal bytes at LIT to OUT, which holds *OP of
+   OUT_LEN bytes so far, in runs of at most MAX_LITERAL.
+   Returns false if they do not fit. */
+static bool
+put_literals (const uint8_t *lit, size_t cnt, uint8_t *out, size_t out_len,
+              size_t *op)
+{
+  while (cnt > 0)
+    {
+      size_t run = cnt < MAX_LITERAL ? cnt : MAX_LITERAL;
+
+      if (*op + 1 + run > out_len)
+        return false;
+      out[(*op)++] = run - 1;
+      memcpy (out + *op, lit, run);
+      *op += run;
+      lit += run;
+      cnt -= run;
+    }
+  return true;
+}
+
+/* Compresses the IN_LEN bytes at IN, which must be fewer than
+   65536, into OUT, using the LZ_WORK_SIZE bytes at WORK as
+   scratch.
+   Returns the compressed size, or 0 if it would exceed OUT_LEN. */
+size_t
+lz_compress (const void *in_, size_t in_len, void *out_, size_t out_len,
+             void *work)
+{
+  const uint8_t *in = in_;
+  uint8_t *out = out_;
+  uint16_t *table = work;
+  size_t ip = 0, op = 0, lit = 0;
+
+  ASSERT (in_len < 65536);
+  ASSERT (HASH_SIZE * sizeof *table <= LZ_WORK_SIZE);
+
+  /* Entries hold a position plus 1, so that 0 means none. */
+  memset (table, 0, HASH_SIZE * sizeof *table);
+  while (ip + 2 < in_len)
+    {
+      unsigned h = hash (in + ip);
+      size_t ref = table[h];
+
+      table[h] = ip + 1;
+      if (ref-- > 0 && ip - ref <= MAX_OFFSET
+          && in[ref] == in[ip] && in[ref + 1] == in[ip + 1]
+          && in[ref + 2] == in[ip + 2])
+        {
+          size_t max = in_len - ip < MAX_MATCH ? in_len - ip : MAX_MATCH;
+          size_t len = 3, off = ip - ref - 1, end;
+
+          while (len < max && in[ref + len] == in[ip + len])
+            len++;
+          if (!put_literals (in + ip - lit, lit, out, out_len, &op))
+            return 0;
+          lit = 0;
+
+          if (op + (len - 2 < 7 ? 2 : 3) > out_len)
+            return 0;
+          if (len - 2 < 7)
+            out[op++] = (len - 2) << 5 | off >> 8;
+          else
+            {
+              out[op++] = 7 << 5 | off >> 8;
+              out[op++] = len - 2 - 7;
+            }
+          out[op++] = off & 0xff;
+
+          /* Remember the positions inside the match too, so that
+             later repeats of them are found. */
+          end = ip + len;
+          for (ip++; ip < end; ip++)
+            if (ip + 2 < in_len)
+              table[hash (in + ip)] = ip + 1;
+        }
+      else
+        {
+          lit++;
+          ip++;
+        }
+    }
+  lit += in_len - ip;
+  if (!put_literals (in + in_len - lit, lit, out, out_len, &op))
+    return 0;
+  return op;
+}
+
+/* Decompresses the IN_LEN bytes at IN into OUT.
+   Returns the decompressed size, or 0 if it would exceed OUT_LEN
+   or IN is not valid compressed data. */
+size_t
+lz_decompress (const void *in_, size_t in_len, void *out_, size_t out_len)
+{
+  const uint8_t *in = in_;
+  uint8_t *out = out_;
+  size_t ip = 0, op = 0;
+
+  while (ip < in_len)
+    {
+      unsigned ctrl = in[ip++];
+
+      if (ctrl < MAX_LITERAL)
+        {
+          size_t run = ctrl + 1;
+
+          if (ip + run > in_len || op + run > out_len)
+            return 0;
+          memcpy (out + op, in + ip, run);
+          ip += run;
+          op += run;
+        }
+      else
+        {
+          size_t len = ctrl >> 5, back;
+
+          if (len == 7)
+            {
+              if (ip >= in_len)
+                return 0;
+              len += in[ip++];
+            }
+          if (ip >= in_len)
+            return 0;
+          back = ((ctrl & 0x1f) << 8 | in[ip++]) + 1;
+          len += 2;
+          if (back > op || op + len > out_len)
+            return 0;
+
+          /* The match may overlap the bytes it produces, so copy
+             one byte at a time. */
+          for (; len > 0; len--, op++)
+            out[op] = out[op - back];
+        }
+    }
+  return op;
+}
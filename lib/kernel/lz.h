@@ -0,0 +1,27 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* Lempel-Ziv compression in the LZF format.
+
+   The compressed stream is a sequence of runs.  A control byte C
+   below 32 is followed by C + 1 literal bytes.  Otherwise C is a
+   back reference: its top three bits hold the match length minus
+   2, with 7 meaning that the next byte holds the rest of it, and
+   its low five bits together with the byte after that hold the
+   distance back to the match minus 1.
+
+   This trades ratio for speed: one hash probe per input byte and
+   a single pass in either direction, which is cheap next to
+   moving a sector over the IDE bus. */
+
+#include <stddef.h>
+
+/* Bytes of scratch memory lz_compress() needs. */
+#define LZ_WORK_SIZE 8192
+
+size_t lz_compress (const void *in, size_t in_len, void *out, size_t out_len,
+                    void *work);
+size_t lz_decompress (const void *in, size_t in_len, void *out,
+                      size_t out_len);
+
+#endif /* lib/kernel/lz.h */
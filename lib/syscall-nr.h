@@ -28,7 +28,25 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_GETDENTS,               /* Reads many directory entries at once. */
+    SYS_FALLOCATE,              /* Allocates disk space for a file. */
+    SYS_PREAD,                  /* Reads at an offset. */
+    SYS_PWRITE,                 /* Writes at an offset. */
+    SYS_READV,                  /* Reads into many buffers. */
+    SYS_WRITEV,                 /* Writes from many buffers. */
+    SYS_COPY_FILE_RANGE,        /* Copies between files in the kernel. */
+    SYS_REFLINK,                /* Clones a file, sharing its data. */
+    SYS_FSYNC,                  /* Writes a file to disk. */
+    SYS_FDATASYNC,              /* Writes a file's data to disk. */
+    SYS_SYNC,                   /* Writes all file systems to disk. */
+    SYS_COMPRESS,               /* Stores a file compressed. */
+    SYS_DEFRAG,                 /* Makes a file's data contiguous. */
+    SYS_FADVISE,                /* Declares how a file will be used. */
+    SYS_CACHE_QUOTA             /* Limits a process's share of the
+                                   buffer cache. */
   };
 
 #endif /* lib/syscall-nr.h */
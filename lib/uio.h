@@ -0,0 +1,20 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+/* Scatter/gather buffers for the readv() and writev() system
+   calls.  Shared between the kernel and user programs, so the
+   layout here is part of the system call interface. */
+
+#include <stddef.h>
+
+/* Most buffers one readv() or writev() call accepts. */
+#define IOV_MAX 16
+
+/* One buffer of a scatter/gather list. */
+struct iovec
+  {
+    void *iov_base;                     /* Start of the buffer. */
+    size_t iov_len;                     /* Length in bytes. */
+  };
+
+#endif /* lib/uio.h */
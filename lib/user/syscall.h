@@ -3,6 +3,9 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <dirent.h>
+#include <fadvise.h>
+#include <uio.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +48,21 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int getdents (int fd, struct dirent *entries, unsigned max_entries);
+bool fallocate (int fd, unsigned offset, unsigned length);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+bool reflink (const char *file, const char *new_file);
+bool fsync (int fd);
+bool fdatasync (int fd);
+void sync (void);
+bool compress (int fd);
+bool defrag (int fd);
+bool fadvise (int fd, unsigned offset, unsigned length, int advice);
+bool cache_quota (pid_t, int slots);
+
 #endif /* lib/user/syscall.h */
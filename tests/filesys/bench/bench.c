@@ -0,0 +1,41 @@
+#include "tests/filesys/bench/bench.h"
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Prints one result line for the compare script: OPS operations
+   moving BYTES bytes in CYCLES time-stamp counter cycles.
+   The compare script derives throughput and latency from these. */
+void
+bench_report (const char *name, unsigned ops, unsigned long long bytes,
+              uint64_t cycles)
+{
+  bool was_quiet = quiet;
+
+  quiet = false;
+  msg ("result %s: %u ops, %llu bytes, %llu cycles",
+       name, ops, bytes, (unsigned long long) cycles);
+  quiet = was_quiet;
+}
+
+/* Creates FILE_NAME with SIZE bytes of random data, untimed. */
+void
+bench_make_file (const char *file_name, size_t size)
+{
+  static char buf[4096];
+  size_t ofs;
+  int fd;
+
+  CHECK (create (file_name, size), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (ofs = 0; ofs < size; ofs += sizeof buf)
+    {
+      size_t chunk = size - ofs < sizeof buf ? size - ofs : sizeof buf;
+
+      random_bytes (buf, chunk);
+      if (write (fd, buf, chunk) != (int) chunk)
+        fail ("write %zu bytes at offset %zu in \"%s\"",
+              chunk, ofs, file_name);
+    }
+  close (fd);
+}
@@ -0,0 +1,23 @@
+#ifndef TESTS_FILESYS_BENCH_BENCH_H
+#define TESTS_FILESYS_BENCH_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returns the CPU's time-stamp counter.  RDTSC is allowed in user
+   mode, so timing a run costs no system call that would itself
+   show up in the numbers.  Cycles are only comparable between
+   runs on the same simulator and host. */
+static inline uint64_t
+bench_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+void bench_report (const char *name, unsigned ops, unsigned long long bytes,
+                   uint64_t cycles);
+void bench_make_file (const char *file_name, size_t size);
+
+#endif /* tests/filesys/bench/bench.h */
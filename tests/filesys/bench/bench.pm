@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# check_bench (\@RESULTS, $EXPECTED)
+#
+# Like check_expected, but first takes out the "result" lines that
+# benchmarks print, whose numbers differ from run to run.  Fails
+# unless there is a well-formed result for each name in @RESULTS.
+sub check_bench {
+    my ($results, $expected) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+
+    my (%seen);
+    @output = grep {
+	my ($name) = /^\([a-zA-Z0-9-_]+\) result (\S+): \d+ ops, \d+ bytes, \d+ cycles$/;
+	$seen{$name}++ if defined $name;
+	!defined $name;
+    } @output;
+    foreach my $name (@$results) {
+	fail "Run produced no \"$name\" result\n" if !$seen{$name};
+    }
+    compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [$expected]);
+}
+
+1;
@@ -0,0 +1,53 @@
+/* Child process for conc-rw.
+   Reads the whole shared file or rewrites its own region of it,
+   depending on its index, and reports its own time. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/filesys/bench/conc-rw.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-conc-rw";
+
+static char buf[CHUNK_SIZE];
+
+int
+main (int argc, const char *argv[])
+{
+  bool reader;
+  size_t base, size, ofs;
+  unsigned long long bytes = 0;
+  uint64_t start;
+  char name[16];
+  int child_idx, pass, fd;
+
+  quiet = true;
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  reader = child_idx % 2 == 0;
+  base = reader ? 0 : child_idx * REGION_SIZE;
+  size = reader ? FILE_SIZE : REGION_SIZE;
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  start = bench_cycles ();
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (ofs = base; ofs < base + size; ofs += CHUNK_SIZE)
+      {
+        int n = (reader
+                 ? pread (fd, buf, CHUNK_SIZE, ofs)
+                 : pwrite (fd, buf, CHUNK_SIZE, ofs));
+        if (n != CHUNK_SIZE)
+          fail ("%s %d bytes at offset %zu in \"%s\"",
+                reader ? "read" : "write", CHUNK_SIZE, ofs, file_name);
+        bytes += n;
+      }
+  snprintf (name, sizeof name, "%s-%d", reader ? "reader" : "writer",
+            child_idx);
+  bench_report (name, PASS_CNT * size / CHUNK_SIZE, bytes,
+                bench_cycles () - start);
+  close (fd);
+
+  return child_idx;
+}
@@ -0,0 +1,28 @@
+/* Runs reader and writer processes against one file at the same
+   time and times them as a group. */
+
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/filesys/bench/conc-rw.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  unsigned long long bytes = 0;
+  uint64_t start;
+  int i;
+
+  bench_make_file (file_name, FILE_SIZE);
+  for (i = 0; i < CHILD_CNT; i++)
+    bytes += (unsigned long long) PASS_CNT
+             * (i % 2 == 0 ? FILE_SIZE : REGION_SIZE);
+
+  start = bench_cycles ();
+  exec_children ("child-conc-rw", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+  bench_report ("conc-rw", CHILD_CNT * PASS_CNT, bytes,
+                bench_cycles () - start);
+}
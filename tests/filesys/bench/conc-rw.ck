@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::filesys::bench::bench;
+check_bench ([qw(conc-rw reader-0 writer-1 reader-2 writer-3)], <<'EOF');
+(conc-rw) begin
+(conc-rw) create "shared"
+(conc-rw) open "shared"
+(conc-rw) exec child 1 of 4: "child-conc-rw 0"
+(conc-rw) exec child 2 of 4: "child-conc-rw 1"
+(conc-rw) exec child 3 of 4: "child-conc-rw 2"
+(conc-rw) exec child 4 of 4: "child-conc-rw 3"
+(conc-rw) wait for child 1 of 4 returned 0 (expected 0)
+(conc-rw) wait for child 2 of 4 returned 1 (expected 1)
+(conc-rw) wait for child 3 of 4 returned 2 (expected 2)
+(conc-rw) wait for child 4 of 4 returned 3 (expected 3)
+(conc-rw) end
+EOF
+pass;
@@ -0,0 +1,14 @@
+#ifndef TESTS_FILESYS_BENCH_CONC_RW_H
+#define TESTS_FILESYS_BENCH_CONC_RW_H
+
+/* Children with an even index read the whole file, those with an
+   odd index overwrite their own REGION_SIZE bytes of it, each
+   PASS_CNT times, CHUNK_SIZE bytes at a time. */
+#define CHILD_CNT 4
+#define REGION_SIZE (64 * 1024)
+#define FILE_SIZE (CHILD_CNT * REGION_SIZE)
+#define CHUNK_SIZE 4096
+#define PASS_CNT 4
+static const char file_name[] = "shared";
+
+#endif /* tests/filesys/bench/conc-rw.h */
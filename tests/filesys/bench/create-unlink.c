@@ -0,0 +1,53 @@
+/* Creates, writes and removes many small files, in rounds small
+   enough for a directory that cannot grow. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUND_CNT 8
+#define FILE_CNT 12
+#define FILE_SIZE 100
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  uint64_t create_cycles = 0, unlink_cycles = 0;
+  char name[16];
+  int round, i;
+
+  msg ("create and remove %d files %d times", FILE_CNT, ROUND_CNT);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      uint64_t start = bench_cycles ();
+
+      for (i = 0; i < FILE_CNT; i++)
+        {
+          int fd;
+
+          snprintf (name, sizeof name, "file%d", i);
+          if (!create (name, FILE_SIZE) || (fd = open (name)) < 2)
+            fail ("create \"%s\"", name);
+          if (write (fd, buf, FILE_SIZE) != FILE_SIZE)
+            fail ("write \"%s\"", name);
+          close (fd);
+        }
+      create_cycles += bench_cycles () - start;
+
+      start = bench_cycles ();
+      for (i = 0; i < FILE_CNT; i++)
+        {
+          snprintf (name, sizeof name, "file%d", i);
+          if (!remove (name))
+            fail ("remove \"%s\"", name);
+        }
+      unlink_cycles += bench_cycles () - start;
+    }
+  bench_report ("create", ROUND_CNT * FILE_CNT,
+                ROUND_CNT * FILE_CNT * FILE_SIZE, create_cycles);
+  bench_report ("unlink", ROUND_CNT * FILE_CNT, 0, unlink_cycles);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::filesys::bench::bench;
+check_bench ([qw(create unlink)], <<'EOF');
+(create-unlink) begin
+(create-unlink) create and remove 12 files 8 times
+(create-unlink) end
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Opens a file at the bottom of a deep directory tree by its
+   absolute path, over and over. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DEPTH 12
+#define LOOKUP_CNT 200
+
+void
+test_main (void)
+{
+  char path[DEPTH * 8 + 16] = "";
+  uint64_t start;
+  int i;
+
+  for (i = 0; i < DEPTH; i++)
+    {
+      strlcat (path, "/dir", sizeof path);
+      if (!mkdir (path))
+        fail ("mkdir \"%s\"", path);
+    }
+  strlcat (path, "/leaf", sizeof path);
+  CHECK (create (path, 0), "create file %d directories deep", DEPTH);
+
+  start = bench_cycles ();
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      int fd = open (path);
+      if (fd < 2)
+        fail ("open \"%s\"", path);
+      close (fd);
+    }
+  bench_report ("deep-open", LOOKUP_CNT, 0, bench_cycles () - start);
+}
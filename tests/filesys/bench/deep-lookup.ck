@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::filesys::bench::bench;
+check_bench ([qw(deep-open)], <<'EOF');
+(deep-lookup) begin
+(deep-lookup) create file 12 directories deep
+(deep-lookup) end
+EOF
+pass;
@@ -0,0 +1,81 @@
+/* Lists a large directory with readdir() and with getdents().
+   A directory only grows past the entries mkdir() makes room for
+   with FILESYS_EXTEND_FILES; without it the test says so and
+   skips the listing. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 128
+#define LIST_CNT 10
+#define BATCH_SIZE 16
+#define DIR_ROOM 16             /* Entries mkdir() makes room for. */
+
+static const char *dir_name = "/big";
+
+/* Lists DIR_NAME once with readdir(), or with getdents() if
+   BATCH, and fails unless it holds FILE_CNT entries. */
+static void
+list_dir (bool batch)
+{
+  int fd = open (dir_name);
+  int cnt = 0;
+
+  if (fd < 2)
+    fail ("open \"%s\"", dir_name);
+  if (batch)
+    {
+      struct dirent entries[BATCH_SIZE];
+      int n;
+
+      while ((n = getdents (fd, entries, BATCH_SIZE)) > 0)
+        cnt += n;
+    }
+  else
+    {
+      char name[READDIR_MAX_LEN + 1];
+
+      while (readdir (fd, name))
+        cnt++;
+    }
+  close (fd);
+  if (cnt != FILE_CNT)
+    fail ("listed %d entries in \"%s\", expected %d",
+          cnt, dir_name, FILE_CNT);
+}
+
+void
+test_main (void)
+{
+  uint64_t start;
+  char name[32];
+  int i;
+
+  CHECK (mkdir (dir_name), "mkdir \"%s\"", dir_name);
+  msg ("creating %d files in \"%s\"", FILE_CNT, dir_name);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "%s/file%d", dir_name, i);
+      if (!create (name, 0))
+        {
+          if (i < DIR_ROOM)
+            fail ("create \"%s\"", name);
+          msg ("\"%s\" cannot hold %d entries without "
+               "FILESYS_EXTEND_FILES, skipped", dir_name, FILE_CNT);
+          return;
+        }
+    }
+
+  start = bench_cycles ();
+  for (i = 0; i < LIST_CNT; i++)
+    list_dir (false);
+  bench_report ("readdir", LIST_CNT * FILE_CNT, 0, bench_cycles () - start);
+
+  start = bench_cycles ();
+  for (i = 0; i < LIST_CNT; i++)
+    list_dir (true);
+  bench_report ("getdents", LIST_CNT * FILE_CNT, 0, bench_cycles () - start);
+}
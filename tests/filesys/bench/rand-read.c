@@ -0,0 +1,43 @@
+/* Reads 512-byte and 4 kB blocks at random aligned offsets in a
+   file several times the size of the buffer cache. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (512 * 1024)
+#define READ_CNT 256
+
+static char buf[4096];
+
+static void
+rand_read (int fd, const char *name, size_t size)
+{
+  uint64_t start = bench_cycles ();
+  size_t i;
+
+  for (i = 0; i < READ_CNT; i++)
+    {
+      size_t ofs = random_ulong () % (FILE_SIZE / size) * size;
+
+      if (pread (fd, buf, size, ofs) != (int) size)
+        fail ("read %zu bytes at offset %zu", size, ofs);
+    }
+  bench_report (name, READ_CNT, (unsigned long long) READ_CNT * size,
+                bench_cycles () - start);
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "rand";
+  int fd;
+
+  bench_make_file (file_name, FILE_SIZE);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  rand_read (fd, "rand-read-512", 512);
+  rand_read (fd, "rand-read-4k", 4096);
+  close (fd);
+}
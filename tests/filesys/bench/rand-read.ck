@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::filesys::bench::bench;
+check_bench ([qw(rand-read-512 rand-read-4k)], <<'EOF');
+(rand-read) begin
+(rand-read) create "rand"
+(rand-read) open "rand"
+(rand-read) open "rand"
+(rand-read) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Writes a large file sequentially, then reads it back
+   sequentially, timing each pass. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (1024 * 1024)
+#define CHUNK_SIZE (16 * 1024)
+
+static char buf[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "seq";
+  uint64_t start;
+  size_t ofs;
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, FILE_SIZE), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  start = bench_cycles ();
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    if (write (fd, buf, CHUNK_SIZE) != CHUNK_SIZE)
+      fail ("write %d bytes at offset %zu in \"%s\"",
+            CHUNK_SIZE, ofs, file_name);
+  fsync (fd);
+  bench_report ("seq-write", FILE_SIZE / CHUNK_SIZE, FILE_SIZE,
+                bench_cycles () - start);
+  close (fd);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  start = bench_cycles ();
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    if (read (fd, buf, CHUNK_SIZE) != CHUNK_SIZE)
+      fail ("read %d bytes at offset %zu in \"%s\"",
+            CHUNK_SIZE, ofs, file_name);
+  bench_report ("seq-read", FILE_SIZE / CHUNK_SIZE, FILE_SIZE,
+                bench_cycles () - start);
+  close (fd);
+}
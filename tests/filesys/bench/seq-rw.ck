@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::filesys::bench::bench;
+check_bench ([qw(seq-write seq-read)], <<'EOF');
+(seq-rw) begin
+(seq-rw) create "seq"
+(seq-rw) open "seq"
+(seq-rw) open "seq"
+(seq-rw) end
+EOF
+pass;
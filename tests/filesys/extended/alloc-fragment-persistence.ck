@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($fs) = {};
+my (@small) = map (random_bytes (1024), 0...11);
+$fs->{"s$_"} = [$small[$_]] foreach grep ($_ % 2, 0...11);
+$fs->{"big"} = [random_bytes (40000)];
+$fs->{"p"} = [random_bytes (8400)];
+$fs->{"q"} = [random_bytes (8400)];
+check_archive ($fs);
+pass;
@@ -0,0 +1,94 @@
+/* Breaks free space into small runs by creating small files and
+   removing every other one, then writes a file larger than any
+   run, so that it has to be put together from several, and
+   grows two files in alternating chunks, so that each has to
+   find room near its own end.  Every file must read back
+   intact. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SMALL_CNT 12
+#define SMALL_SIZE 1024
+#define BIG_SIZE 40000
+#define CHUNK_SIZE 700
+#define CHUNK_CNT 12
+
+static char small[SMALL_CNT][SMALL_SIZE];
+static char big[BIG_SIZE];
+static char pair[2][CHUNK_SIZE * CHUNK_CNT];
+
+void
+test_main (void) 
+{
+  static const char *pair_names[2] = {"p", "q"};
+  char name[16];
+  int fds[2];
+  int i, j, fd;
+
+  random_bytes (small, sizeof small);
+  random_bytes (big, sizeof big);
+  random_bytes (pair, sizeof pair);
+
+  msg ("create %d files of %d bytes", SMALL_CNT, SMALL_SIZE);
+  quiet = true;
+  for (i = 0; i < SMALL_CNT; i++)
+    {
+      snprintf (name, sizeof name, "s%d", i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      CHECK (write (fd, small[i], SMALL_SIZE) == SMALL_SIZE,
+             "write \"%s\"", name);
+      close (fd);
+    }
+  quiet = false;
+
+  msg ("remove every other file");
+  quiet = true;
+  for (i = 0; i < SMALL_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "s%d", i);
+      CHECK (remove (name), "remove \"%s\"", name);
+    }
+  quiet = false;
+
+  CHECK (create ("big", 0), "create \"big\"");
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  CHECK (write (fd, big, BIG_SIZE) == BIG_SIZE,
+         "write %d bytes to \"big\"", BIG_SIZE);
+  msg ("close \"big\"");
+  close (fd);
+
+  for (i = 0; i < 2; i++)
+    {
+      CHECK (create (pair_names[i], 0), "create \"%s\"", pair_names[i]);
+      CHECK ((fds[i] = open (pair_names[i])) > 1,
+             "open \"%s\"", pair_names[i]);
+    }
+  msg ("write \"p\" and \"q\" in alternating chunks");
+  for (j = 0; j < CHUNK_CNT; j++)
+    for (i = 0; i < 2; i++)
+      if (write (fds[i], pair[i] + j * CHUNK_SIZE, CHUNK_SIZE) != CHUNK_SIZE)
+        fail ("write %d bytes at offset %d in \"%s\" failed",
+              CHUNK_SIZE, j * CHUNK_SIZE, pair_names[i]);
+  for (i = 0; i < 2; i++)
+    {
+      msg ("close \"%s\"", pair_names[i]);
+      close (fds[i]);
+    }
+
+  msg ("check the files");
+  quiet = true;
+  for (i = 1; i < SMALL_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "s%d", i);
+      check_file (name, small[i], SMALL_SIZE);
+    }
+  check_file ("big", big, BIG_SIZE);
+  for (i = 0; i < 2; i++)
+    check_file (pair_names[i], pair[i], sizeof pair[i]);
+  quiet = false;
+}
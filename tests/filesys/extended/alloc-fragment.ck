@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(alloc-fragment) begin
+(alloc-fragment) create 12 files of 1024 bytes
+(alloc-fragment) remove every other file
+(alloc-fragment) create "big"
+(alloc-fragment) open "big"
+(alloc-fragment) write 40000 bytes to "big"
+(alloc-fragment) close "big"
+(alloc-fragment) create "p"
+(alloc-fragment) open "p"
+(alloc-fragment) create "q"
+(alloc-fragment) open "q"
+(alloc-fragment) write "p" and "q" in alternating chunks
+(alloc-fragment) close "p"
+(alloc-fragment) close "q"
+(alloc-fragment) check the files
+(alloc-fragment) end
+EOF
+pass;
@@ -0,0 +1,39 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(block-1k) begin
+(block-1k) create "seq"
+(block-1k) open "seq"
+(block-1k) wrote 10000 bytes to "seq" in 1234-byte chunks
+(block-1k) close "seq"
+(block-1k) open "seq" for verification
+(block-1k) verified contents of "seq"
+(block-1k) close "seq"
+(block-1k) create "odd"
+(block-1k) open "odd"
+(block-1k) write 3000 bytes to "odd" at offset 4090
+(block-1k) write 10 bytes to "odd" at offset 1019
+(block-1k) close "odd"
+(block-1k) open "odd" for verification
+(block-1k) verified contents of "odd"
+(block-1k) close "odd"
+(block-1k) remove "seq"
+(block-1k) create "again"
+(block-1k) open "again"
+(block-1k) wrote 9000 bytes to "again" in 4096-byte chunks
+(block-1k) close "again"
+(block-1k) open "again" for verification
+(block-1k) verified contents of "again"
+(block-1k) close "again"
+(block-1k) create "tiny"
+(block-1k) open "tiny"
+(block-1k) wrote 100 bytes to "tiny" in 100-byte chunks
+(block-1k) close "tiny"
+(block-1k) open "tiny" for verification
+(block-1k) verified contents of "tiny"
+(block-1k) close "tiny"
+(block-1k) end
+EOF
+pass;
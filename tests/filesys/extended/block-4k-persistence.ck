@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+random_bytes (10000);
+my ($odd) = ("\0" x 4090) . random_bytes (3000);
+substr ($odd, 1019, 10) = random_bytes (10);
+my ($again) = random_bytes (9000);
+my ($tiny) = random_bytes (100);
+check_archive ({"odd" => [$odd], "again" => [$again], "tiny" => [$tiny]});
+pass;
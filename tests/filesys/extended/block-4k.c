@@ -0,0 +1,5 @@
+/* Formats the file system with 4,096-byte blocks (see Make.tests)
+   and writes files across block boundaries, at odd offsets and
+   into a hole, then frees a file and allocates another. */
+
+#include "tests/filesys/extended/block-size.inc"
@@ -0,0 +1,39 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(block-4k) begin
+(block-4k) create "seq"
+(block-4k) open "seq"
+(block-4k) wrote 10000 bytes to "seq" in 1234-byte chunks
+(block-4k) close "seq"
+(block-4k) open "seq" for verification
+(block-4k) verified contents of "seq"
+(block-4k) close "seq"
+(block-4k) create "odd"
+(block-4k) open "odd"
+(block-4k) write 3000 bytes to "odd" at offset 4090
+(block-4k) write 10 bytes to "odd" at offset 1019
+(block-4k) close "odd"
+(block-4k) open "odd" for verification
+(block-4k) verified contents of "odd"
+(block-4k) close "odd"
+(block-4k) remove "seq"
+(block-4k) create "again"
+(block-4k) open "again"
+(block-4k) wrote 9000 bytes to "again" in 4096-byte chunks
+(block-4k) close "again"
+(block-4k) open "again" for verification
+(block-4k) verified contents of "again"
+(block-4k) close "again"
+(block-4k) create "tiny"
+(block-4k) open "tiny"
+(block-4k) wrote 100 bytes to "tiny" in 100-byte chunks
+(block-4k) close "tiny"
+(block-4k) open "tiny" for verification
+(block-4k) verified contents of "tiny"
+(block-4k) close "tiny"
+(block-4k) end
+EOF
+pass;
@@ -0,0 +1,46 @@
+/* Sets the buffer cache quota of a child process, which must
+   work while it runs and fail once it has exited, and checks that
+   negative quotas, processes that do not exist and a sibling's
+   quota are all rejected.  The child sets its own quota too. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char cmd[32];
+  pid_t child, sibling;
+  int fd;
+
+  CHECK ((child = exec ("child-quota wait")) != PID_ERROR,
+         "exec child-quota wait");
+  CHECK (cache_quota (child, 8), "set quota of child");
+  CHECK (cache_quota (child, 0), "remove quota of child");
+  CHECK (!cache_quota (child, -1), "set negative quota (must fail)");
+  CHECK (!cache_quota (child + 1000, 8),
+         "set quota of nonexistent process (must fail)");
+
+  snprintf (cmd, sizeof cmd, "child-quota %d", child);
+  CHECK ((sibling = exec (cmd)) != PID_ERROR, "exec child-quota with pid");
+  CHECK (wait (sibling) == 0,
+         "wait for sibling setting child's quota (must return 0)");
+
+  /* Tell the child its pid, then let it go. */
+  snprintf (cmd, sizeof cmd, "%d", child);
+  CHECK (create ("pid", 0), "create \"pid\"");
+  CHECK ((fd = open ("pid")) > 1, "open \"pid\"");
+  CHECK (write (fd, cmd, strlen (cmd)) == (int) strlen (cmd),
+         "write \"pid\"");
+  msg ("close \"pid\"");
+  close (fd);
+  CHECK (create ("go", 0), "create \"go\"");
+  CHECK (wait (child) == 1, "wait for child setting own quota (must return 1)");
+
+  CHECK (!cache_quota (child, 8), "set quota of exited child (must fail)");
+  CHECK (remove ("pid"), "remove \"pid\"");
+  CHECK (remove ("go"), "remove \"go\"");
+}
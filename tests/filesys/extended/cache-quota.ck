@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-quota) begin
+(cache-quota) exec child-quota wait
+(cache-quota) set quota of child
+(cache-quota) remove quota of child
+(cache-quota) set negative quota (must fail)
+(cache-quota) set quota of nonexistent process (must fail)
+(cache-quota) exec child-quota with pid
+(cache-quota) wait for sibling setting child's quota (must return 0)
+(cache-quota) create "pid"
+(cache-quota) open "pid"
+(cache-quota) write "pid"
+(cache-quota) close "pid"
+(cache-quota) create "go"
+(cache-quota) wait for child setting own quota (must return 1)
+(cache-quota) set quota of exited child (must fail)
+(cache-quota) remove "pid"
+(cache-quota) remove "go"
+(cache-quota) end
+EOF
+pass;
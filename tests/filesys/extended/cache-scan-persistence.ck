@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($fs);
+foreach my $d (0...3) {
+    $fs->{"d$d"}{"f$_"} = [random_bytes (600)] foreach 0...2;
+}
+$fs->{'big'} = [random_bytes (65536)];
+check_archive ($fs);
+pass;
@@ -0,0 +1,67 @@
+/* Builds a small directory tree, then repeatedly streams a file
+   larger than the buffer cache while walking the tree's paths and
+   reading its files in between.  Every pass must read back what
+   was written, with the scan competing against the directory and
+   inode sectors the path walks use. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DIR_CNT 4
+#define FILE_CNT 3
+#define SMALL_SIZE 600
+#define BIG_SIZE 65536
+#define PASS_CNT 3
+
+static char small[DIR_CNT][FILE_CNT][SMALL_SIZE];
+static char big[BIG_SIZE];
+
+void
+test_main (void) 
+{
+  char name[32];
+  int d, f, pass, fd;
+
+  msg ("create %d directories of %d files", DIR_CNT, FILE_CNT);
+  quiet = true;
+  for (d = 0; d < DIR_CNT; d++)
+    {
+      snprintf (name, sizeof name, "d%d", d);
+      CHECK (mkdir (name), "mkdir \"%s\"", name);
+      for (f = 0; f < FILE_CNT; f++)
+        {
+          snprintf (name, sizeof name, "d%d/f%d", d, f);
+          random_bytes (small[d][f], SMALL_SIZE);
+          CHECK (create (name, 0), "create \"%s\"", name);
+          CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+          CHECK (write (fd, small[d][f], SMALL_SIZE) == SMALL_SIZE,
+                 "write \"%s\"", name);
+          close (fd);
+        }
+    }
+  quiet = false;
+
+  random_bytes (big, sizeof big);
+  CHECK (create ("big", 0), "create \"big\"");
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  CHECK (write (fd, big, sizeof big) == sizeof big, "write \"big\"");
+  msg ("close \"big\"");
+  close (fd);
+
+  msg ("scan \"big\" and walk the tree %d times", PASS_CNT);
+  quiet = true;
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      check_file ("big", big, sizeof big);
+      for (d = 0; d < DIR_CNT; d++)
+        for (f = 0; f < FILE_CNT; f++)
+          {
+            snprintf (name, sizeof name, "d%d/f%d", d, f);
+            check_file (name, small[d][f], SMALL_SIZE);
+          }
+    }
+  quiet = false;
+}
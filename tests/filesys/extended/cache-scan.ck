@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-scan) begin
+(cache-scan) create 4 directories of 3 files
+(cache-scan) create "big"
+(cache-scan) open "big"
+(cache-scan) write "big"
+(cache-scan) close "big"
+(cache-scan) scan "big" and walk the tree 3 times
+(cache-scan) end
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Child process for cache-quota.
+   With argument "wait", busy-waits until our parent creates file
+   "go", then reads our own pid from file "pid", sets and removes
+   a quota on ourselves and exits with 1 if both succeeded.  Given
+   a pid instead, tries to set that process's quota and exits with
+   1 if that succeeded, which it must not for a sibling. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-quota";
+
+int
+main (int argc, const char *argv[]) 
+{
+  char buf[16];
+  pid_t pid;
+  int fd, n;
+
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  if (strcmp (argv[1], "wait"))
+    return cache_quota (atoi (argv[1]), 4);
+
+  while ((fd = open ("go")) == -1)
+    continue;
+  close (fd);
+
+  CHECK ((fd = open ("pid")) > 1, "open \"pid\"");
+  n = read (fd, buf, sizeof buf - 1);
+  CHECK (n > 0, "read \"pid\"");
+  buf[n] = '\0';
+  close (fd);
+
+  pid = atoi (buf);
+  return cache_quota (pid, 4) && cache_quota (pid, 0);
+}
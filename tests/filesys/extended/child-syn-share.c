@@ -0,0 +1,52 @@
+/* Child process for syn-share.
+   Child 0 rewrites the file created by our parent process in
+   place, chunk by chunk, with the data it already holds.  The
+   others read the whole file and check it.  Each does so
+   PASS_CNT times. */
+
+#include <random.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/filesys/extended/syn-share.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-syn-share";
+
+static char buf1[BUF_SIZE];
+static char buf2[BUF_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  int child_idx;
+  int fd, pass;
+  size_t ofs;
+
+  quiet = true;
+  
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  random_init (0);
+  random_bytes (buf1, sizeof buf1);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      seek (fd, 0);
+      if (child_idx == 0)
+        for (ofs = 0; ofs < BUF_SIZE; ofs += CHUNK_SIZE)
+          CHECK (write (fd, buf1 + ofs, CHUNK_SIZE) == CHUNK_SIZE,
+                 "write %d bytes at offset %zu in \"%s\"",
+                 CHUNK_SIZE, ofs, file_name);
+      else
+        {
+          CHECK (read (fd, buf2, BUF_SIZE) == BUF_SIZE,
+                 "read \"%s\"", file_name);
+          compare_bytes (buf2, buf1, BUF_SIZE, 0, file_name);
+        }
+    }
+  close (fd);
+
+  return child_idx;
+}
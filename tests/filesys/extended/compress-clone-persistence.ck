@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($text) = "compress me, compress me again\n";
+my ($a) = substr ($text x 400, 0, 10000) . random_bytes (10000);
+my ($b) = $a;
+substr ($b, 7700, 1000) = 'x' x 1000;
+check_archive ({"a" => [$a], "b" => [$b]});
+pass;
@@ -0,0 +1,49 @@
+/* Writes a compressed file, half text and half random bytes,
+   clones it with reflink(), and overwrites part of the clone
+   across a cluster boundary.  The original must keep its
+   contents and the clone must read back with the change. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 20000
+#define PATCH_OFS 7700
+#define PATCH_SIZE 1000
+static char buf[FILE_SIZE];
+static char patch[PATCH_SIZE];
+
+void
+test_main (void) 
+{
+  static const char text[] = "compress me, compress me again\n";
+  size_t i;
+  int fd;
+
+  for (i = 0; i < FILE_SIZE / 2; i++)
+    buf[i] = text[i % (sizeof text - 1)];
+  random_bytes (buf + FILE_SIZE / 2, FILE_SIZE / 2);
+  memset (patch, 'x', sizeof patch);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK ((fd = open ("a")) > 1, "open \"a\"");
+  CHECK (compress (fd), "compress \"a\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"a\"");
+  msg ("close \"a\"");
+  close (fd);
+
+  CHECK (reflink ("a", "b"), "reflink \"a\" to \"b\"");
+  CHECK (!reflink ("a", "b"), "reflink \"a\" to \"b\" again (must fail)");
+  CHECK ((fd = open ("b")) > 1, "open \"b\"");
+  seek (fd, PATCH_OFS);
+  CHECK (write (fd, patch, sizeof patch) == sizeof patch,
+         "write %d bytes to \"b\" at offset %d", PATCH_SIZE, PATCH_OFS);
+  msg ("close \"b\"");
+  close (fd);
+
+  check_file ("a", buf, sizeof buf);
+  memcpy (buf + PATCH_OFS, patch, sizeof patch);
+  check_file ("b", buf, sizeof buf);
+}
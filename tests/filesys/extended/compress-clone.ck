@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(compress-clone) begin
+(compress-clone) create "a"
+(compress-clone) open "a"
+(compress-clone) compress "a"
+(compress-clone) write "a"
+(compress-clone) close "a"
+(compress-clone) reflink "a" to "b"
+(compress-clone) reflink "a" to "b" again (must fail)
+(compress-clone) open "b"
+(compress-clone) write 1000 bytes to "b" at offset 7700
+(compress-clone) close "b"
+(compress-clone) open "a" for verification
+(compress-clone) verified contents of "a"
+(compress-clone) close "a"
+(compress-clone) open "b" for verification
+(compress-clone) verified contents of "b"
+(compress-clone) close "b"
+(compress-clone) end
+EOF
+pass;
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($src) = random_bytes (10000);
+my ($dst) = substr ($src, 0, 4096) . substr ($src, 5000);
+$src .= substr ($src, 0, 2000);
+check_archive ({"src" => [$src], "dst" => [$dst]});
+pass;
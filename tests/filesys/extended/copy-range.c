@@ -0,0 +1,76 @@
+/* Copies ranges between files with copy_file_range(), once from
+   a block boundary, where whole blocks can be shared, and once
+   from the middle of a block up to the end of the source, checking
+   how much is copied and that both file positions move by that
+   much.  Then copies within one file through two descriptors,
+   which must fail if the ranges overlap and may extend the file
+   if they do not. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SRC_SIZE 10000
+
+static char src[SRC_SIZE + 2000];
+static char dst[SRC_SIZE];
+
+void
+test_main (void) 
+{
+  int in_fd, out_fd, dir_fd;
+
+  random_bytes (src, SRC_SIZE);
+  CHECK (create ("src", 0), "create \"src\"");
+  CHECK ((in_fd = open ("src")) > 1, "open \"src\"");
+  CHECK (write (in_fd, src, SRC_SIZE) == SRC_SIZE,
+         "write %d bytes to \"src\"", SRC_SIZE);
+  CHECK (create ("dst", 0), "create \"dst\"");
+  CHECK ((out_fd = open ("dst")) > 1, "open \"dst\"");
+
+  seek (in_fd, 0);
+  CHECK (copy_file_range (in_fd, out_fd, 4096) == 4096,
+         "copy 4096 bytes from offset 0");
+  memcpy (dst, src, 4096);
+  CHECK (tell (in_fd) == 4096 && tell (out_fd) == 4096,
+         "both positions are 4096");
+
+  seek (in_fd, 5000);
+  CHECK (copy_file_range (in_fd, out_fd, 6000) == 5000,
+         "copy 6000 bytes from offset 5000 copies 5000");
+  memcpy (dst + 4096, src + 5000, 5000);
+  CHECK (tell (in_fd) == SRC_SIZE && tell (out_fd) == 9096,
+         "positions are %d and 9096", SRC_SIZE);
+  CHECK (copy_file_range (in_fd, out_fd, 100) == 0,
+         "copy at the end of \"src\" copies nothing");
+  msg ("close \"dst\"");
+  close (out_fd);
+  check_file ("dst", dst, 9096);
+
+  CHECK ((out_fd = open ("src")) > 1, "open \"src\" again");
+  seek (in_fd, 0);
+  seek (out_fd, 1000);
+  CHECK (copy_file_range (in_fd, out_fd, 2000) == -1,
+         "copy over an overlapping range (must fail)");
+  seek (out_fd, SRC_SIZE);
+  CHECK (copy_file_range (in_fd, out_fd, 2000) == 2000,
+         "copy 2000 bytes to the end of \"src\"");
+  memcpy (src + SRC_SIZE, src, 2000);
+  CHECK (filesize (out_fd) == SRC_SIZE + 2000,
+         "\"src\" is now %d bytes", SRC_SIZE + 2000);
+
+  CHECK (copy_file_range (STDOUT_FILENO, out_fd, 10) == -1,
+         "copy from stdout (must fail)");
+  CHECK ((dir_fd = open ("/")) > 1, "open \"/\"");
+  CHECK (copy_file_range (in_fd, dir_fd, 10) == -1,
+         "copy to \"/\" (must fail)");
+  msg ("close \"/\"");
+  close (dir_fd);
+  msg ("close \"src\" twice");
+  close (out_fd);
+  close (in_fd);
+  check_file ("src", src, sizeof src);
+}
@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(copy-range) begin
+(copy-range) create "src"
+(copy-range) open "src"
+(copy-range) write 10000 bytes to "src"
+(copy-range) create "dst"
+(copy-range) open "dst"
+(copy-range) copy 4096 bytes from offset 0
+(copy-range) both positions are 4096
+(copy-range) copy 6000 bytes from offset 5000 copies 5000
+(copy-range) positions are 10000 and 9096
+(copy-range) copy at the end of "src" copies nothing
+(copy-range) close "dst"
+(copy-range) open "dst" for verification
+(copy-range) verified contents of "dst"
+(copy-range) close "dst"
+(copy-range) open "src" again
+(copy-range) copy over an overlapping range (must fail)
+(copy-range) copy 2000 bytes to the end of "src"
+(copy-range) "src" is now 12000 bytes
+(copy-range) copy from stdout (must fail)
+(copy-range) open "/"
+(copy-range) copy to "/" (must fail)
+(copy-range) close "/"
+(copy-range) close "src" twice
+(copy-range) open "src" for verification
+(copy-range) verified contents of "src"
+(copy-range) close "src"
+(copy-range) end
+EOF
+pass;
@@ -0,0 +1,57 @@
+/* Fragments two files in the root directory and one in a
+   subdirectory by writing them in alternating chunks, then
+   defragments one of them through its file descriptor.  The root
+   directory cannot be defragmented that way, since it is not a
+   file open for writing; the test's kernel command line runs
+   "defrag /" after it instead, and the -persistence check
+   verifies every file's contents afterward. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK_SIZE 700
+#define CHUNK_CNT 15
+#define FILE_CNT 3
+#define FILE_SIZE (CHUNK_SIZE * CHUNK_CNT)
+
+static const char *files[FILE_CNT] = {"a", "b", "sub/c"};
+static char buf[FILE_CNT][FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fds[FILE_CNT];
+  int i, j, fd;
+
+  CHECK (mkdir ("sub"), "mkdir \"sub\"");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      random_bytes (buf[i], sizeof buf[i]);
+      CHECK (create (files[i], 0), "create \"%s\"", files[i]);
+      CHECK ((fds[i] = open (files[i])) > 1, "open \"%s\"", files[i]);
+    }
+
+  msg ("write files in alternating chunks");
+  for (j = 0; j < CHUNK_CNT; j++)
+    for (i = 0; i < FILE_CNT; i++)
+      if (write (fds[i], buf[i] + j * CHUNK_SIZE, CHUNK_SIZE) != CHUNK_SIZE)
+        fail ("write %d bytes at offset %d in \"%s\" failed",
+              CHUNK_SIZE, j * CHUNK_SIZE, files[i]);
+
+  CHECK (defrag (fds[0]), "defrag \"%s\"", files[0]);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      msg ("close \"%s\"", files[i]);
+      close (fds[i]);
+    }
+
+  CHECK ((fd = open ("/")) > 1, "open \"/\"");
+  CHECK (!defrag (fd), "defrag \"/\" (must fail)");
+  msg ("close \"/\"");
+  close (fd);
+
+  for (i = 0; i < FILE_CNT; i++)
+    check_file (files[i], buf[i], sizeof buf[i]);
+}
@@ -0,0 +1,39 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+fail "\"defrag /\" did not run after the test\n"
+  if !grep (/^Defragmenting '\/'\.\.\.$/, @output);
+fail "\"defrag /\" could not move all data\n"
+  if grep (/some data could not be moved/, @output);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(defrag-root) begin
+(defrag-root) mkdir "sub"
+(defrag-root) create "a"
+(defrag-root) open "a"
+(defrag-root) create "b"
+(defrag-root) open "b"
+(defrag-root) create "sub/c"
+(defrag-root) open "sub/c"
+(defrag-root) write files in alternating chunks
+(defrag-root) defrag "a"
+(defrag-root) close "a"
+(defrag-root) close "b"
+(defrag-root) close "sub/c"
+(defrag-root) open "/"
+(defrag-root) defrag "/" (must fail)
+(defrag-root) close "/"
+(defrag-root) open "a" for verification
+(defrag-root) verified contents of "a"
+(defrag-root) close "a"
+(defrag-root) open "b" for verification
+(defrag-root) verified contents of "b"
+(defrag-root) close "b"
+(defrag-root) open "sub/c" for verification
+(defrag-root) verified contents of "sub/c"
+(defrag-root) close "sub/c"
+(defrag-root) end
+EOF
+pass;
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($log) = random_bytes (6000);
+substr ($log, 2950, 300) = random_bytes (300);
+check_archive ({"log" => [$log]});
+pass;
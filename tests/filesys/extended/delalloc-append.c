@@ -0,0 +1,57 @@
+/* Appends to a file in small pieces, whose sectors are not
+   allocated until they have to be, reading what has been written
+   so far back through a second descriptor as it goes and
+   overwriting part of it before closing.  The file must read back
+   intact while open, after the last close, and, through the
+   -persistence check, after the file system is remounted. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PIECE_SIZE 100
+#define PIECE_CNT 60
+#define CHECK_EVERY 10
+#define PATCH_OFS 2950
+#define PATCH_SIZE 300
+
+static char buf[PIECE_SIZE * PIECE_CNT];
+
+void
+test_main (void) 
+{
+  int fd, reader, i;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("log", 0), "create \"log\"");
+  CHECK ((fd = open ("log")) > 1, "open \"log\"");
+  CHECK ((reader = open ("log")) > 1, "open \"log\" again");
+
+  msg ("append %d pieces of %d bytes", PIECE_CNT, PIECE_SIZE);
+  for (i = 0; i < PIECE_CNT; i++)
+    {
+      if (write (fd, buf + i * PIECE_SIZE, PIECE_SIZE) != PIECE_SIZE)
+        fail ("append of %d bytes at offset %d failed",
+              PIECE_SIZE, i * PIECE_SIZE);
+      if ((i + 1) % CHECK_EVERY == 0)
+        {
+          quiet = true;
+          seek (reader, 0);
+          check_file_handle (reader, "log", buf, (i + 1) * PIECE_SIZE);
+          quiet = false;
+        }
+    }
+
+  random_bytes (buf + PATCH_OFS, PATCH_SIZE);
+  seek (fd, PATCH_OFS);
+  CHECK (write (fd, buf + PATCH_OFS, PATCH_SIZE) == PATCH_SIZE,
+         "overwrite %d bytes at offset %d", PATCH_SIZE, PATCH_OFS);
+  seek (reader, 0);
+  check_file_handle (reader, "log", buf, sizeof buf);
+  msg ("close \"log\" twice");
+  close (reader);
+  close (fd);
+
+  check_file ("log", buf, sizeof buf);
+}
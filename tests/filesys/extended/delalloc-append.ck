@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(delalloc-append) begin
+(delalloc-append) create "log"
+(delalloc-append) open "log"
+(delalloc-append) open "log" again
+(delalloc-append) append 60 pieces of 100 bytes
+(delalloc-append) overwrite 300 bytes at offset 2950
+(delalloc-append) verified contents of "log"
+(delalloc-append) close "log" twice
+(delalloc-append) open "log" for verification
+(delalloc-append) verified contents of "log"
+(delalloc-append) close "log"
+(delalloc-append) end
+EOF
+pass;
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($dir) = {"sub" => {}};
+my (@names) = qw (a bb ccc dddd eeeee ffffff);
+$dir->{$names[$_]} = ["\0" x ($_ * 500)] foreach 0...$#names;
+check_archive ({"dir" => $dir});
+pass;
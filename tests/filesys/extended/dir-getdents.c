@@ -0,0 +1,89 @@
+/* Creates files of different lengths and a subdirectory in a
+   directory, then lists it with getdents() in batches smaller
+   than the directory.  Every entry must come back exactly once,
+   with the inode number, type and length of what it names.
+   getdents() on an ordinary file must fail. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ENTRY_CNT 7
+#define BATCH_SIZE 3
+
+/* The last entry is a directory, the others files of I * 500
+   bytes. */
+static const char *names[ENTRY_CNT] =
+  {"a", "bb", "ccc", "dddd", "eeeee", "ffffff", "sub"};
+
+void
+test_main (void) 
+{
+  struct dirent entries[BATCH_SIZE];
+  int inumbers[ENTRY_CNT];
+  bool seen[ENTRY_CNT];
+  char name[32];
+  int i, j, n, fd, total;
+
+  CHECK (mkdir ("dir"), "mkdir \"dir\"");
+  msg ("create %d entries in \"dir\"", ENTRY_CNT);
+  quiet = true;
+  for (i = 0; i < ENTRY_CNT; i++)
+    {
+      snprintf (name, sizeof name, "dir/%s", names[i]);
+      if (i == ENTRY_CNT - 1)
+        CHECK (mkdir (name), "mkdir \"%s\"", name);
+      else
+        CHECK (create (name, i * 500), "create \"%s\"", name);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      inumbers[i] = inumber (fd);
+      close (fd);
+      seen[i] = false;
+    }
+  quiet = false;
+
+  CHECK ((fd = open ("dir")) > 1, "open \"dir\"");
+  msg ("getdents \"dir\" in batches of %d", BATCH_SIZE);
+  total = 0;
+  while ((n = getdents (fd, entries, BATCH_SIZE)) > 0)
+    {
+      if (n > BATCH_SIZE)
+        fail ("getdents returned %d entries for a batch of %d",
+              n, BATCH_SIZE);
+      for (j = 0; j < n; j++)
+        {
+          const struct dirent *e = &entries[j];
+
+          for (i = 0; i < ENTRY_CNT; i++)
+            if (!strcmp (e->name, names[i]))
+              break;
+          if (i == ENTRY_CNT)
+            fail ("getdents returned unexpected entry \"%s\"", e->name);
+          if (seen[i])
+            fail ("getdents returned \"%s\" twice", e->name);
+          seen[i] = true;
+          if (e->inumber != inumbers[i])
+            fail ("\"%s\" has inode number %d, expected %d",
+                  e->name, e->inumber, inumbers[i]);
+          if (e->is_dir != (i == ENTRY_CNT - 1))
+            fail ("\"%s\" is%s a directory", e->name,
+                  e->is_dir ? "" : " not");
+          if (!e->is_dir && e->size != i * 500)
+            fail ("\"%s\" has length %d, expected %d",
+                  e->name, e->size, i * 500);
+        }
+      total += n;
+    }
+  CHECK (n == 0, "getdents \"dir\" at end returned 0");
+  CHECK (total == ENTRY_CNT, "getdents \"dir\" returned %d entries", total);
+  msg ("close \"dir\"");
+  close (fd);
+
+  CHECK ((fd = open ("dir/a")) > 1, "open \"dir/a\"");
+  CHECK (getdents (fd, entries, BATCH_SIZE) == -1,
+         "getdents \"dir/a\" (must fail)");
+  msg ("close \"dir/a\"");
+  close (fd);
+}
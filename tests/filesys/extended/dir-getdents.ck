@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-getdents) begin
+(dir-getdents) mkdir "dir"
+(dir-getdents) create 7 entries in "dir"
+(dir-getdents) open "dir"
+(dir-getdents) getdents "dir" in batches of 3
+(dir-getdents) getdents "dir" at end returned 0
+(dir-getdents) getdents "dir" returned 7 entries
+(dir-getdents) close "dir"
+(dir-getdents) open "dir/a"
+(dir-getdents) getdents "dir/a" (must fail)
+(dir-getdents) close "dir/a"
+(dir-getdents) end
+EOF
+pass;
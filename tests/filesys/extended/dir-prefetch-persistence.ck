@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($dir) = {};
+foreach my $i (0...39) {
+    $dir->{sprintf ("f%02d", $i)} = ["\0" x ($i * 37)]
+      if $i < 20 || $i >= 30;
+}
+check_archive ({"dir" => $dir});
+pass;
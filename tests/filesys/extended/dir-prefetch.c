@@ -0,0 +1,98 @@
+/* Fills a directory with several getdents() batches' worth of
+   files.  Lists it in batches, removing files further on after
+   the first one, so that inodes queued for reading ahead are
+   stale by the time their entries are reached, and reads single
+   entries with readdir() between batches.  Every remaining file
+   must come back exactly once, with its length, and no removed
+   one may come back. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+#define BATCH_SIZE 8
+#define REMOVE_FIRST 20
+#define REMOVE_CNT 10
+
+static bool seen[FILE_CNT];
+
+static bool
+removed (int i) 
+{
+  return i >= REMOVE_FIRST && i < REMOVE_FIRST + REMOVE_CNT;
+}
+
+/* Records entry NAME, whose length is SIZE or unknown if SIZE is
+   negative. */
+static void
+see (const char *name, int size) 
+{
+  int i = atoi (name + 1);
+
+  if (name[0] != 'f' || strlen (name) != 3 || i >= FILE_CNT)
+    fail ("unexpected entry \"%s\"", name);
+  if (removed (i))
+    fail ("removed file \"%s\" was listed", name);
+  if (seen[i])
+    fail ("\"%s\" was listed twice", name);
+  if (size >= 0 && size != i * 37)
+    fail ("\"%s\" has length %d, expected %d", name, size, i * 37);
+  seen[i] = true;
+}
+
+void
+test_main (void) 
+{
+  struct dirent entries[BATCH_SIZE];
+  char name[READDIR_MAX_LEN + 1];
+  char path[32];
+  int i, n, fd;
+
+  CHECK (mkdir ("dir"), "mkdir \"dir\"");
+  msg ("create %d files in \"dir\"", FILE_CNT);
+  quiet = true;
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (path, sizeof path, "dir/f%02d", i);
+      CHECK (create (path, i * 37), "create \"%s\"", path);
+    }
+  quiet = false;
+
+  CHECK ((fd = open ("dir")) > 1, "open \"dir\"");
+  CHECK ((n = getdents (fd, entries, BATCH_SIZE)) == BATCH_SIZE,
+         "getdents \"dir\"");
+  for (i = 0; i < n; i++)
+    see (entries[i].name, entries[i].size);
+
+  msg ("remove files %d to %d", REMOVE_FIRST,
+       REMOVE_FIRST + REMOVE_CNT - 1);
+  quiet = true;
+  for (i = REMOVE_FIRST; i < REMOVE_FIRST + REMOVE_CNT; i++)
+    {
+      snprintf (path, sizeof path, "dir/f%02d", i);
+      CHECK (remove (path), "remove \"%s\"", path);
+    }
+  quiet = false;
+
+  msg ("list the rest of \"dir\" with getdents and readdir");
+  for (;;)
+    {
+      n = getdents (fd, entries, BATCH_SIZE);
+      if (n < 0 || n > BATCH_SIZE)
+        fail ("getdents returned %d", n);
+      for (i = 0; i < n; i++)
+        see (entries[i].name, entries[i].size);
+      if (!readdir (fd, name))
+        break;
+      see (name, -1);
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    if (!removed (i) && !seen[i])
+      fail ("\"f%02d\" was not listed", i);
+  msg ("close \"dir\"");
+  close (fd);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-prefetch) begin
+(dir-prefetch) mkdir "dir"
+(dir-prefetch) create 40 files in "dir"
+(dir-prefetch) open "dir"
+(dir-prefetch) getdents "dir"
+(dir-prefetch) remove files 20 to 29
+(dir-prefetch) list the rest of "dir" with getdents and readdir
+(dir-prefetch) close "dir"
+(dir-prefetch) end
+EOF
+pass;
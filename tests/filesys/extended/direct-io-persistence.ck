@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($data) = random_bytes (65536);
+my ($small) = random_bytes (300);
+my ($big) = random_bytes (20000);
+substr ($data, 3000, 200) = substr ($small, 0, 200);
+substr ($data, 2055, 20000) = $big;
+check_archive ({"data" => [$data]});
+pass;
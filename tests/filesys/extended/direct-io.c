@@ -0,0 +1,60 @@
+/* Mixes transfers large enough to bypass the buffer cache with
+   small ones that go through it, on overlapping parts of one file,
+   and checks that each sees what the other wrote: a large
+   unaligned read after a small cached write, and a small read
+   after a large unaligned write over cached sectors. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 65536
+#define BIG_WRITE_OFS 2055
+#define BIG_WRITE_SIZE 20000
+
+static char buf[FILE_SIZE];
+static char back[FILE_SIZE];
+static char small[300];
+static char big[BIG_WRITE_SIZE];
+
+static void
+read_back (int fd, size_t ofs, size_t size)
+{
+  seek (fd, ofs);
+  CHECK (read (fd, back, size) == (int) size,
+         "read %zu bytes at offset %zu", size, ofs);
+  compare_bytes (back, buf + ofs, size, ofs, "data");
+}
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  random_bytes (small, sizeof small);
+  random_bytes (big, sizeof big);
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (write (fd, buf, sizeof buf) == FILE_SIZE,
+         "write %d bytes in one call", FILE_SIZE);
+
+  read_back (fd, 3000, 100);
+  seek (fd, 3000);
+  CHECK (write (fd, small, 200) == 200, "write 200 bytes at offset 3000");
+  memcpy (buf + 3000, small, 200);
+  read_back (fd, 100, 40000);
+
+  seek (fd, BIG_WRITE_OFS);
+  CHECK (write (fd, big, sizeof big) == BIG_WRITE_SIZE,
+         "write %d bytes at offset %d", BIG_WRITE_SIZE, BIG_WRITE_OFS);
+  memcpy (buf + BIG_WRITE_OFS, big, sizeof big);
+  read_back (fd, 2900, 300);
+
+  read_back (fd, 0, FILE_SIZE);
+  msg ("close \"data\"");
+  close (fd);
+}
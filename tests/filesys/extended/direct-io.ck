@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(direct-io) begin
+(direct-io) create "data"
+(direct-io) open "data"
+(direct-io) write 65536 bytes in one call
+(direct-io) read 100 bytes at offset 3000
+(direct-io) write 200 bytes at offset 3000
+(direct-io) read 40000 bytes at offset 100
+(direct-io) write 20000 bytes at offset 2055
+(direct-io) read 300 bytes at offset 2900
+(direct-io) read 65536 bytes at offset 0
+(direct-io) close "data"
+(direct-io) end
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Passes fadvise() bad advice values, bad file descriptors and
+   ranges that start or run past 2 GB, all of which must fail, and
+   then every valid advice value, which must succeed.  A directory
+   accepts only advice about which data to fetch or drop.  The
+   file's contents must be unaffected. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096];
+
+void
+test_main (void) 
+{
+  int advice;
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("data", sizeof buf), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"data\"");
+
+  CHECK (!fadvise (fd, 0, 0, 42), "fadvise advice 42 (must fail)");
+  CHECK (!fadvise (fd, 0, 0, -1), "fadvise advice -1 (must fail)");
+  CHECK (!fadvise (99, 0, 0, POSIX_FADV_WILLNEED),
+         "fadvise fd 99 (must fail)");
+  CHECK (!fadvise (STDIN_FILENO, 0, 0, POSIX_FADV_WILLNEED),
+         "fadvise stdin (must fail)");
+  CHECK (!fadvise (STDOUT_FILENO, 0, 0, POSIX_FADV_DONTNEED),
+         "fadvise stdout (must fail)");
+  CHECK (!fadvise (fd, 0x80000000, 0, POSIX_FADV_WILLNEED),
+         "fadvise offset 0x80000000 (must fail)");
+  CHECK (!fadvise (fd, 0, 0x80000000, POSIX_FADV_WILLNEED),
+         "fadvise length 0x80000000 (must fail)");
+
+  for (advice = POSIX_FADV_NORMAL; advice <= POSIX_FADV_NOREUSE; advice++)
+    CHECK (fadvise (fd, 0, sizeof buf, advice), "fadvise advice %d", advice);
+  msg ("close \"data\"");
+  close (fd);
+
+  CHECK ((fd = open ("/")) > 1, "open \"/\"");
+  CHECK (fadvise (fd, 0, 0, POSIX_FADV_WILLNEED), "fadvise \"/\" WILLNEED");
+  CHECK (fadvise (fd, 0, 0, POSIX_FADV_DONTNEED), "fadvise \"/\" DONTNEED");
+  CHECK (!fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL),
+         "fadvise \"/\" SEQUENTIAL (must fail)");
+  msg ("close \"/\"");
+  close (fd);
+
+  check_file ("data", buf, sizeof buf);
+}
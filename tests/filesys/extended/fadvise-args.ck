@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fadvise-args) begin
+(fadvise-args) create "data"
+(fadvise-args) open "data"
+(fadvise-args) write "data"
+(fadvise-args) fadvise advice 42 (must fail)
+(fadvise-args) fadvise advice -1 (must fail)
+(fadvise-args) fadvise fd 99 (must fail)
+(fadvise-args) fadvise stdin (must fail)
+(fadvise-args) fadvise stdout (must fail)
+(fadvise-args) fadvise offset 0x80000000 (must fail)
+(fadvise-args) fadvise length 0x80000000 (must fail)
+(fadvise-args) fadvise advice 0
+(fadvise-args) fadvise advice 1
+(fadvise-args) fadvise advice 2
+(fadvise-args) fadvise advice 3
+(fadvise-args) fadvise advice 4
+(fadvise-args) fadvise advice 5
+(fadvise-args) close "data"
+(fadvise-args) open "/"
+(fadvise-args) fadvise "/" WILLNEED
+(fadvise-args) fadvise "/" DONTNEED
+(fadvise-args) fadvise "/" SEQUENTIAL (must fail)
+(fadvise-args) close "/"
+(fadvise-args) open "data" for verification
+(fadvise-args) verified contents of "data"
+(fadvise-args) close "data"
+(fadvise-args) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Reserves space in an empty file with fallocate(), inside and
+   past what is later written, and checks that it changes neither
+   the file's length nor what reads back.  Reserving space through
+   a console descriptor, a closed descriptor or a directory, or
+   past the largest possible file, must fail. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 5000
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fd, dir_fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (fallocate (fd, 0, 8192), "fallocate 8192 bytes at offset 0");
+  CHECK (filesize (fd) == 0, "filesize \"data\" is still 0");
+  CHECK (write (fd, buf, FILE_SIZE) == FILE_SIZE,
+         "write %d bytes to \"data\"", FILE_SIZE);
+  CHECK (fallocate (fd, 20000, 4096), "fallocate 4096 bytes at offset 20000");
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"data\" is still %d",
+         FILE_SIZE);
+  CHECK (tell (fd) == FILE_SIZE, "tell \"data\" is still %d", FILE_SIZE);
+  CHECK (!fallocate (fd, 0, 0x7fffffff),
+         "fallocate past the largest file (must fail)");
+  msg ("close \"data\"");
+  close (fd);
+  check_file ("data", buf, sizeof buf);
+
+  CHECK (!fallocate (STDOUT_FILENO, 0, 512), "fallocate stdout (must fail)");
+  CHECK (!fallocate (fd, 0, 512), "fallocate closed fd (must fail)");
+  CHECK ((dir_fd = open ("/")) > 1, "open \"/\"");
+  CHECK (!fallocate (dir_fd, 0, 512), "fallocate \"/\" (must fail)");
+  msg ("close \"/\"");
+  close (dir_fd);
+}
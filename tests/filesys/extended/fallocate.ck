@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fallocate) begin
+(fallocate) create "data"
+(fallocate) open "data"
+(fallocate) fallocate 8192 bytes at offset 0
+(fallocate) filesize "data" is still 0
+(fallocate) write 5000 bytes to "data"
+(fallocate) fallocate 4096 bytes at offset 20000
+(fallocate) filesize "data" is still 5000
+(fallocate) tell "data" is still 5000
+(fallocate) fallocate past the largest file (must fail)
+(fallocate) close "data"
+(fallocate) open "data" for verification
+(fallocate) verified contents of "data"
+(fallocate) close "data"
+(fallocate) fallocate stdout (must fail)
+(fallocate) fallocate closed fd (must fail)
+(fallocate) open "/"
+(fallocate) fallocate "/" (must fail)
+(fallocate) close "/"
+(fallocate) end
+EOF
+pass;
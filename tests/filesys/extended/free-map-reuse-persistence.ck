@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($fs) = {};
+my (@old) = map (random_bytes (3000), 0...5);
+$fs->{"old$_"} = [$old[$_]] foreach 0, 2, 4;
+$fs->{"new$_"} = [random_bytes (5000)] foreach 0...2;
+check_archive ($fs);
+pass;
@@ -0,0 +1,83 @@
+/* Creates several files, removes every other one and creates
+   larger files in the space they freed.  Files that were kept
+   must be left intact, both now and, through the -persistence
+   check, after the free map has been written back and read in
+   again. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OLD_CNT 6
+#define OLD_SIZE 3000
+#define NEW_CNT 3
+#define NEW_SIZE 5000
+
+static char old[OLD_CNT][OLD_SIZE];
+static char new[NEW_CNT][NEW_SIZE];
+
+/* Creates FILE_NAME holding the SIZE bytes in BUF. */
+static void
+write_file (const char *file_name, const char *buf, int size) 
+{
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, size) == size,
+         "write %d bytes to \"%s\"", size, file_name);
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  char name[16];
+  int i;
+
+  random_bytes (old, sizeof old);
+  random_bytes (new, sizeof new);
+
+  msg ("create %d files of %d bytes", OLD_CNT, OLD_SIZE);
+  quiet = true;
+  for (i = 0; i < OLD_CNT; i++)
+    {
+      snprintf (name, sizeof name, "old%d", i);
+      write_file (name, old[i], OLD_SIZE);
+    }
+  quiet = false;
+
+  msg ("remove every other file");
+  quiet = true;
+  for (i = 1; i < OLD_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "old%d", i);
+      CHECK (remove (name), "remove \"%s\"", name);
+    }
+  quiet = false;
+
+  msg ("create %d files of %d bytes", NEW_CNT, NEW_SIZE);
+  quiet = true;
+  for (i = 0; i < NEW_CNT; i++)
+    {
+      snprintf (name, sizeof name, "new%d", i);
+      write_file (name, new[i], NEW_SIZE);
+    }
+  quiet = false;
+
+  msg ("check the files");
+  quiet = true;
+  for (i = 0; i < OLD_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "old%d", i);
+      check_file (name, old[i], OLD_SIZE);
+    }
+  for (i = 0; i < NEW_CNT; i++)
+    {
+      snprintf (name, sizeof name, "new%d", i);
+      check_file (name, new[i], NEW_SIZE);
+    }
+  quiet = false;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(free-map-reuse) begin
+(free-map-reuse) create 6 files of 3000 bytes
+(free-map-reuse) remove every other file
+(free-map-reuse) create 3 files of 5000 bytes
+(free-map-reuse) check the files
+(free-map-reuse) end
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Writes a file in two parts, forcing each to disk with fsync()
+   and fdatasync(), then with sync(), and checks that it reads back
+   correctly.  fsync() on a console or closed descriptor must
+   fail. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 9000
+#define FIRST_PART 5000
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (write (fd, buf, FIRST_PART) == FIRST_PART,
+         "write %d bytes to \"data\"", FIRST_PART);
+  CHECK (fsync (fd), "fsync \"data\"");
+  CHECK (write (fd, buf + FIRST_PART, FILE_SIZE - FIRST_PART)
+         == FILE_SIZE - FIRST_PART,
+         "write %d more bytes to \"data\"", FILE_SIZE - FIRST_PART);
+  CHECK (fdatasync (fd), "fdatasync \"data\"");
+  msg ("close \"data\"");
+  close (fd);
+  msg ("sync");
+  sync ();
+  check_file ("data", buf, sizeof buf);
+
+  CHECK (!fsync (STDOUT_FILENO), "fsync stdout (must fail)");
+  CHECK (!fsync (fd), "fsync closed fd (must fail)");
+}
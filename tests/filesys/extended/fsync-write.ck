@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fsync-write) begin
+(fsync-write) create "data"
+(fsync-write) open "data"
+(fsync-write) write 5000 bytes to "data"
+(fsync-write) fsync "data"
+(fsync-write) write 4000 more bytes to "data"
+(fsync-write) fdatasync "data"
+(fsync-write) close "data"
+(fsync-write) sync
+(fsync-write) open "data" for verification
+(fsync-write) verified contents of "data"
+(fsync-write) close "data"
+(fsync-write) fsync stdout (must fail)
+(fsync-write) fsync closed fd (must fail)
+(fsync-write) end
+EOF
+pass;
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($sparse) = "\0" x 50100;
+substr ($sparse, 10000, 100) = random_bytes (100);
+substr ($sparse, 50000, 100) = random_bytes (100);
+substr ($sparse, 20000, 1000) = random_bytes (1000);
+check_archive ({"sparse" => [$sparse]});
+pass;
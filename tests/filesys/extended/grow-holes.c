@@ -0,0 +1,46 @@
+/* Writes a few bytes far apart in a new file, leaving holes that
+   are never written, then fills part of one hole.  The holes must
+   read back as zeros and the written parts intact, now and,
+   through the -persistence check, after the file system is
+   remounted. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 50100
+
+/* Parts written, in order. */
+static const struct
+  {
+    int ofs;
+    int size;
+  }
+parts[] = {{10000, 100}, {50000, 100}, {20000, 1000}};
+#define PART_CNT (sizeof parts / sizeof *parts)
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  size_t i;
+  int fd, end = 0;
+
+  CHECK (create ("sparse", 0), "create \"sparse\"");
+  CHECK ((fd = open ("sparse")) > 1, "open \"sparse\"");
+  for (i = 0; i < PART_CNT; i++)
+    {
+      random_bytes (buf + parts[i].ofs, parts[i].size);
+      seek (fd, parts[i].ofs);
+      CHECK (write (fd, buf + parts[i].ofs, parts[i].size) == parts[i].size,
+             "write %d bytes at offset %d", parts[i].size, parts[i].ofs);
+      if (end < parts[i].ofs + parts[i].size)
+        end = parts[i].ofs + parts[i].size;
+      check_file ("sparse", buf, end);
+    }
+  msg ("close \"sparse\"");
+  close (fd);
+  check_file ("sparse", buf, FILE_SIZE);
+}
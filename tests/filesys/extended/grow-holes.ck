@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-holes) begin
+(grow-holes) create "sparse"
+(grow-holes) open "sparse"
+(grow-holes) write 100 bytes at offset 10000
+(grow-holes) open "sparse" for verification
+(grow-holes) verified contents of "sparse"
+(grow-holes) close "sparse"
+(grow-holes) write 100 bytes at offset 50000
+(grow-holes) open "sparse" for verification
+(grow-holes) verified contents of "sparse"
+(grow-holes) close "sparse"
+(grow-holes) write 1000 bytes at offset 20000
+(grow-holes) open "sparse" for verification
+(grow-holes) verified contents of "sparse"
+(grow-holes) close "sparse"
+(grow-holes) close "sparse"
+(grow-holes) open "sparse" for verification
+(grow-holes) verified contents of "sparse"
+(grow-holes) close "sparse"
+(grow-holes) end
+EOF
+pass;
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($grow) = random_bytes (6000);
+my ($tiny) = random_bytes (50);
+my ($deep) = random_bytes (10);
+check_archive ({"grow" => [$grow], "tiny" => [$tiny],
+		"dir" => {"deep" => [$deep]}});
+pass;
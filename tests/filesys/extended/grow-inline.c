@@ -0,0 +1,63 @@
+/* Grows a file from a few bytes, which fit in its inode sector,
+   to well past what does, checking its contents at each step.
+   Also leaves a small file in the root directory and another in
+   a new subdirectory, which stay inline, so that the -persistence
+   check also covers directories changed only in their inodes. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define STEP_CNT 4
+
+/* Lengths "grow" has after each step; the first two fit in its
+   inode sector. */
+static const int sizes[STEP_CNT] = {100, 400, 2000, 6000};
+
+static char grow[6000];
+static char tiny[50];
+static char deep[10];
+
+/* Creates FILE_NAME holding the SIZE bytes in BUF. */
+static void
+write_file (const char *file_name, const char *buf, int size) 
+{
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, size) == size,
+         "write %d bytes to \"%s\"", size, file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  int i, fd, ofs;
+
+  random_bytes (grow, sizeof grow);
+  random_bytes (tiny, sizeof tiny);
+  random_bytes (deep, sizeof deep);
+
+  CHECK (create ("grow", 0), "create \"grow\"");
+  CHECK ((fd = open ("grow")) > 1, "open \"grow\"");
+  for (i = ofs = 0; i < STEP_CNT; ofs = sizes[i++])
+    {
+      CHECK (write (fd, grow + ofs, sizes[i] - ofs) == sizes[i] - ofs,
+             "grow \"grow\" to %d bytes", sizes[i]);
+      check_file ("grow", grow, sizes[i]);
+    }
+  msg ("close \"grow\"");
+  close (fd);
+
+  write_file ("tiny", tiny, sizeof tiny);
+  CHECK (mkdir ("dir"), "mkdir \"dir\"");
+  write_file ("dir/deep", deep, sizeof deep);
+
+  check_file ("grow", grow, sizeof grow);
+  check_file ("tiny", tiny, sizeof tiny);
+  check_file ("dir/deep", deep, sizeof deep);
+}
@@ -0,0 +1,46 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-inline) begin
+(grow-inline) create "grow"
+(grow-inline) open "grow"
+(grow-inline) grow "grow" to 100 bytes
+(grow-inline) open "grow" for verification
+(grow-inline) verified contents of "grow"
+(grow-inline) close "grow"
+(grow-inline) grow "grow" to 400 bytes
+(grow-inline) open "grow" for verification
+(grow-inline) verified contents of "grow"
+(grow-inline) close "grow"
+(grow-inline) grow "grow" to 2000 bytes
+(grow-inline) open "grow" for verification
+(grow-inline) verified contents of "grow"
+(grow-inline) close "grow"
+(grow-inline) grow "grow" to 6000 bytes
+(grow-inline) open "grow" for verification
+(grow-inline) verified contents of "grow"
+(grow-inline) close "grow"
+(grow-inline) close "grow"
+(grow-inline) create "tiny"
+(grow-inline) open "tiny"
+(grow-inline) write 50 bytes to "tiny"
+(grow-inline) close "tiny"
+(grow-inline) mkdir "dir"
+(grow-inline) create "dir/deep"
+(grow-inline) open "dir/deep"
+(grow-inline) write 10 bytes to "dir/deep"
+(grow-inline) close "dir/deep"
+(grow-inline) open "grow" for verification
+(grow-inline) verified contents of "grow"
+(grow-inline) close "grow"
+(grow-inline) open "tiny" for verification
+(grow-inline) verified contents of "tiny"
+(grow-inline) close "tiny"
+(grow-inline) open "dir/deep" for verification
+(grow-inline) verified contents of "dir/deep"
+(grow-inline) close "dir/deep"
+(grow-inline) end
+EOF
+pass;
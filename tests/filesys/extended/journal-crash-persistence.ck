@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($a) = random_bytes (5000);
+my ($b) = random_bytes (700);
+check_archive ({"d" => {"a" => [$a], "e" => {"b" => [$b]}}});
+pass;
@@ -0,0 +1,46 @@
+/* Builds a small tree, removes a file again, and syncs after each
+   step.  The kernel then powers off without writing anything back
+   ("crash" action), so the persistence check sees the tree only
+   if the next mount replays the journal correctly. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char a[5000];
+static char b[700];
+
+static void
+make_file (const char *name, const char *buf, size_t size)
+{
+  int fd;
+
+  CHECK (create (name, 0), "create \"%s\"", name);
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  CHECK (write (fd, buf, size) == (int) size,
+         "write %zu bytes to \"%s\"", size, name);
+  msg ("close \"%s\"", name);
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  random_bytes (a, sizeof a);
+  random_bytes (b, sizeof b);
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK (mkdir ("d/e"), "mkdir \"d/e\"");
+  make_file ("d/a", a, sizeof a);
+  make_file ("d/e/b", b, sizeof b);
+  msg ("sync");
+  sync ();
+
+  make_file ("gone", b, sizeof b);
+  msg ("sync");
+  sync ();
+  CHECK (remove ("gone"), "remove \"gone\"");
+  msg ("sync");
+  sync ();
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(journal-crash) begin
+(journal-crash) mkdir "d"
+(journal-crash) mkdir "d/e"
+(journal-crash) create "d/a"
+(journal-crash) open "d/a"
+(journal-crash) write 5000 bytes to "d/a"
+(journal-crash) close "d/a"
+(journal-crash) create "d/e/b"
+(journal-crash) open "d/e/b"
+(journal-crash) write 700 bytes to "d/e/b"
+(journal-crash) close "d/e/b"
+(journal-crash) sync
+(journal-crash) create "gone"
+(journal-crash) open "gone"
+(journal-crash) write 700 bytes to "gone"
+(journal-crash) close "gone"
+(journal-crash) sync
+(journal-crash) remove "gone"
+(journal-crash) sync
+(journal-crash) end
+EOF
+pass;
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($small) = "stored inline by pintos-mkfs\n" . random_bytes (600);
+my ($new) = random_bytes (3000);
+check_archive ({"tree" => {"sub" => {"small" => [$small]}},
+		"new" => [$new]});
+pass;
@@ -0,0 +1,42 @@
+/* Runs on a disk built on the host by pintos-mkfs instead of one
+   formatted by the kernel (see Make.tests).  Reads a small file
+   pintos-mkfs stored inline, grows it past the inline limit, and
+   creates a new file next to the copied tree. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static const char small[] = "stored inline by pintos-mkfs\n";
+static char grown[sizeof small - 1 + 600];
+static char new[3000];
+
+void
+test_main (void) 
+{
+  size_t small_len = sizeof small - 1;
+  int fd;
+
+  check_file ("tree/sub/small", small, small_len);
+
+  memcpy (grown, small, small_len);
+  random_bytes (grown + small_len, 600);
+  CHECK ((fd = open ("tree/sub/small")) > 1, "open \"tree/sub/small\"");
+  seek (fd, small_len);
+  CHECK (write (fd, grown + small_len, 600) == 600,
+         "append 600 bytes to \"tree/sub/small\"");
+  msg ("close \"tree/sub/small\"");
+  close (fd);
+  check_file ("tree/sub/small", grown, sizeof grown);
+
+  random_bytes (new, sizeof new);
+  CHECK (create ("new", 0), "create \"new\"");
+  CHECK ((fd = open ("new")) > 1, "open \"new\"");
+  CHECK (write (fd, new, sizeof new) == (int) sizeof new,
+         "write %zu bytes to \"new\"", sizeof new);
+  msg ("close \"new\"");
+  close (fd);
+  check_file ("new", new, sizeof new);
+}
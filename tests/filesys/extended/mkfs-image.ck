@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mkfs-image) begin
+(mkfs-image) open "tree/sub/small" for verification
+(mkfs-image) verified contents of "tree/sub/small"
+(mkfs-image) close "tree/sub/small"
+(mkfs-image) open "tree/sub/small"
+(mkfs-image) append 600 bytes to "tree/sub/small"
+(mkfs-image) close "tree/sub/small"
+(mkfs-image) open "tree/sub/small" for verification
+(mkfs-image) verified contents of "tree/sub/small"
+(mkfs-image) close "tree/sub/small"
+(mkfs-image) create "new"
+(mkfs-image) open "new"
+(mkfs-image) write 3000 bytes to "new"
+(mkfs-image) close "new"
+(mkfs-image) open "new" for verification
+(mkfs-image) verified contents of "new"
+(mkfs-image) close "new"
+(mkfs-image) end
+EOF
+pass;
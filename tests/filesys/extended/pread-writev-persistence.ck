@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($data) = random_bytes (1000);
+substr ($data, 500, 200) = random_bytes (200);
+check_archive ({"data" => [$data]});
+pass;
@@ -0,0 +1,77 @@
+/* Writes a file with writev() from several buffers, one of them
+   empty, patches it with pwrite() and reads it back with pread()
+   and readv(), checking that the positional calls leave the file
+   position alone and the vectored ones advance it.  Reads past
+   the end return 0 bytes; a console descriptor, a directory or
+   an empty buffer list must be refused. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 1000
+#define PATCH_OFS 500
+#define PATCH_SIZE 200
+
+static char buf[FILE_SIZE];
+static char patch[PATCH_SIZE];
+static char back[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  struct iovec iov[3];
+  int fd, dir_fd;
+
+  random_bytes (buf, sizeof buf);
+  random_bytes (patch, sizeof patch);
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 100;
+  iov[1].iov_base = buf + 100;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = buf + 100;
+  iov[2].iov_len = FILE_SIZE - 100;
+  CHECK (writev (fd, iov, 3) == FILE_SIZE,
+         "writev %d bytes from 3 buffers", FILE_SIZE);
+  CHECK (tell (fd) == FILE_SIZE, "tell \"data\" is %d", FILE_SIZE);
+
+  CHECK (pwrite (fd, patch, PATCH_SIZE, PATCH_OFS) == PATCH_SIZE,
+         "pwrite %d bytes at offset %d", PATCH_SIZE, PATCH_OFS);
+  memcpy (buf + PATCH_OFS, patch, PATCH_SIZE);
+  CHECK (tell (fd) == FILE_SIZE, "tell \"data\" is still %d", FILE_SIZE);
+
+  CHECK (pread (fd, back, 300, 400) == 300, "pread 300 bytes at offset 400");
+  compare_bytes (back, buf + 400, 300, 400, "data");
+  CHECK (pread (fd, back, 100, FILE_SIZE - 50) == 50,
+         "pread across the end returns 50 bytes");
+  CHECK (pread (fd, back, 100, FILE_SIZE) == 0,
+         "pread at the end returns 0 bytes");
+  CHECK (tell (fd) == FILE_SIZE, "tell \"data\" is still %d", FILE_SIZE);
+
+  seek (fd, 0);
+  iov[0].iov_base = back;
+  iov[0].iov_len = 600;
+  iov[1].iov_base = back + 600;
+  iov[1].iov_len = 600;
+  CHECK (readv (fd, iov, 2) == FILE_SIZE,
+         "readv %d bytes into 2 buffers", FILE_SIZE);
+  compare_bytes (back, buf, FILE_SIZE, 0, "data");
+  CHECK (tell (fd) == FILE_SIZE, "tell \"data\" is %d", FILE_SIZE);
+  CHECK (readv (fd, iov, 0) == -1, "readv into no buffers (must fail)");
+
+  CHECK (pread (STDIN_FILENO, back, 10, 0) == -1,
+         "pread stdin (must fail)");
+  CHECK ((dir_fd = open ("/")) > 1, "open \"/\"");
+  CHECK (pwrite (dir_fd, patch, 10, 0) == -1, "pwrite \"/\" (must fail)");
+  msg ("close \"/\"");
+  close (dir_fd);
+  msg ("close \"data\"");
+  close (fd);
+  check_file ("data", buf, sizeof buf);
+}
@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pread-writev) begin
+(pread-writev) create "data"
+(pread-writev) open "data"
+(pread-writev) writev 1000 bytes from 3 buffers
+(pread-writev) tell "data" is 1000
+(pread-writev) pwrite 200 bytes at offset 500
+(pread-writev) tell "data" is still 1000
+(pread-writev) pread 300 bytes at offset 400
+(pread-writev) pread across the end returns 50 bytes
+(pread-writev) pread at the end returns 0 bytes
+(pread-writev) tell "data" is still 1000
+(pread-writev) readv 1000 bytes into 2 buffers
+(pread-writev) tell "data" is 1000
+(pread-writev) readv into no buffers (must fail)
+(pread-writev) pread stdin (must fail)
+(pread-writev) open "/"
+(pread-writev) pwrite "/" (must fail)
+(pread-writev) close "/"
+(pread-writev) close "data"
+(pread-writev) open "data" for verification
+(pread-writev) verified contents of "data"
+(pread-writev) close "data"
+(pread-writev) end
+EOF
+pass;
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($b) = random_bytes (9000);
+substr ($b, 1000, 500) = random_bytes (500);
+check_archive ({"b" => [$b], "c" => [$b]});
+pass;
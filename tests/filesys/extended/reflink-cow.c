@@ -0,0 +1,67 @@
+/* Clones a file with reflink() and writes to both the original
+   and the clone, checking that each write is seen only through
+   the file it was made to.  A clone of the clone is taken before
+   the original is removed, and the persistence check makes sure
+   the shared blocks survived that.  Cloning onto an existing name
+   or from a missing file must fail. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 9000
+
+static char a[FILE_SIZE];
+static char b[FILE_SIZE];
+static char patch[500];
+
+static void
+patch_file (const char *name, char *buf, size_t ofs)
+{
+  int fd;
+
+  random_bytes (patch, sizeof patch);
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  seek (fd, ofs);
+  CHECK (write (fd, patch, sizeof patch) == (int) sizeof patch,
+         "write %zu bytes to \"%s\" at offset %zu", sizeof patch, name, ofs);
+  memcpy (buf + ofs, patch, sizeof patch);
+  msg ("close \"%s\"", name);
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_bytes (a, sizeof a);
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK ((fd = open ("a")) > 1, "open \"a\"");
+  CHECK (write (fd, a, sizeof a) == FILE_SIZE,
+         "write %d bytes to \"a\"", FILE_SIZE);
+  msg ("close \"a\"");
+  close (fd);
+
+  CHECK (reflink ("a", "b"), "reflink \"a\" to \"b\"");
+  memcpy (b, a, sizeof b);
+  check_file ("b", b, sizeof b);
+
+  patch_file ("b", b, 1000);
+  check_file ("a", a, sizeof a);
+  check_file ("b", b, sizeof b);
+
+  patch_file ("a", a, 6000);
+  check_file ("a", a, sizeof a);
+  check_file ("b", b, sizeof b);
+
+  CHECK (!reflink ("a", "b"), "reflink \"a\" to existing \"b\" (must fail)");
+  CHECK (!reflink ("none", "c"), "reflink missing \"none\" (must fail)");
+
+  CHECK (reflink ("b", "c"), "reflink \"b\" to \"c\"");
+  CHECK (remove ("a"), "remove \"a\"");
+  check_file ("b", b, sizeof b);
+  check_file ("c", b, sizeof b);
+}
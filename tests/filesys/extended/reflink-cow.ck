@@ -0,0 +1,45 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(reflink-cow) begin
+(reflink-cow) create "a"
+(reflink-cow) open "a"
+(reflink-cow) write 9000 bytes to "a"
+(reflink-cow) close "a"
+(reflink-cow) reflink "a" to "b"
+(reflink-cow) open "b" for verification
+(reflink-cow) verified contents of "b"
+(reflink-cow) close "b"
+(reflink-cow) open "b"
+(reflink-cow) write 500 bytes to "b" at offset 1000
+(reflink-cow) close "b"
+(reflink-cow) open "a" for verification
+(reflink-cow) verified contents of "a"
+(reflink-cow) close "a"
+(reflink-cow) open "b" for verification
+(reflink-cow) verified contents of "b"
+(reflink-cow) close "b"
+(reflink-cow) open "a"
+(reflink-cow) write 500 bytes to "a" at offset 6000
+(reflink-cow) close "a"
+(reflink-cow) open "a" for verification
+(reflink-cow) verified contents of "a"
+(reflink-cow) close "a"
+(reflink-cow) open "b" for verification
+(reflink-cow) verified contents of "b"
+(reflink-cow) close "b"
+(reflink-cow) reflink "a" to existing "b" (must fail)
+(reflink-cow) reflink missing "none" (must fail)
+(reflink-cow) reflink "b" to "c"
+(reflink-cow) remove "a"
+(reflink-cow) open "b" for verification
+(reflink-cow) verified contents of "b"
+(reflink-cow) close "b"
+(reflink-cow) open "c" for verification
+(reflink-cow) verified contents of "c"
+(reflink-cow) close "c"
+(reflink-cow) end
+EOF
+pass;
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_archive ({"child-syn-share" => "tests/filesys/extended/child-syn-share",
+		"shared" => [random_bytes (512 * 12)],
+		"other" => [random_bytes (20000)]});
+pass;
@@ -0,0 +1,53 @@
+/* Has several subprocesses read one file over and over while
+   another rewrites it in place with the same data, and grows a
+   second file meanwhile.  Readers of the one file, and I/O on the
+   two files, go on at the same time under the inodes' own locks;
+   every read must still see the file's data intact. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/filesys/extended/syn-share.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+#define OTHER_SIZE 20000
+#define OTHER_CHUNK 500
+
+static char buf[BUF_SIZE];
+static char other[OTHER_SIZE];
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  size_t ofs;
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  random_bytes (other, sizeof other);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  CHECK (create ("other", 0), "create \"other\"");
+  CHECK ((fd = open ("other")) > 1, "open \"other\"");
+
+  exec_children ("child-syn-share", children, CHILD_CNT);
+
+  quiet = true;
+  for (ofs = 0; ofs < OTHER_SIZE; ofs += OTHER_CHUNK)
+    CHECK (write (fd, other + ofs, OTHER_CHUNK) == OTHER_CHUNK,
+           "write %d bytes at offset %zu in \"other\"", OTHER_CHUNK, ofs);
+  quiet = false;
+  msg ("close \"other\"");
+  close (fd);
+
+  wait_children (children, CHILD_CNT);
+  check_file (file_name, buf, sizeof buf);
+  check_file ("other", other, sizeof other);
+}
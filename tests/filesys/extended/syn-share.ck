@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-share) begin
+(syn-share) create "shared"
+(syn-share) open "shared"
+(syn-share) write "shared"
+(syn-share) close "shared"
+(syn-share) create "other"
+(syn-share) open "other"
+(syn-share) exec child 1 of 4: "child-syn-share 0"
+(syn-share) exec child 2 of 4: "child-syn-share 1"
+(syn-share) exec child 3 of 4: "child-syn-share 2"
+(syn-share) exec child 4 of 4: "child-syn-share 3"
+(syn-share) close "other"
+(syn-share) wait for child 1 of 4 returned 0 (expected 0)
+(syn-share) wait for child 2 of 4 returned 1 (expected 1)
+(syn-share) wait for child 3 of 4 returned 2 (expected 2)
+(syn-share) wait for child 4 of 4 returned 3 (expected 3)
+(syn-share) open "shared" for verification
+(syn-share) verified contents of "shared"
+(syn-share) close "shared"
+(syn-share) open "other" for verification
+(syn-share) verified contents of "other"
+(syn-share) close "other"
+(syn-share) end
+EOF
+pass;
@@ -0,0 +1,10 @@
+#ifndef TESTS_FILESYS_EXTENDED_SYN_SHARE_H
+#define TESTS_FILESYS_EXTENDED_SYN_SHARE_H
+
+#define CHUNK_SIZE 512
+#define CHUNK_CNT 12
+#define BUF_SIZE (CHUNK_SIZE * CHUNK_CNT)
+#define PASS_CNT 8
+static const char file_name[] = "shared";
+
+#endif /* tests/filesys/extended/syn-share.h */
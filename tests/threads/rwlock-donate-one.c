@@ -0,0 +1,49 @@
+/* The main thread acquires a readers-writer lock for reading.
+   Then it creates two higher-priority threads that block
+   acquiring it for writing, causing them to donate their
+   priorities to the main thread.  When the main thread releases
+   the lock, the writers should acquire it in priority order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+
+void
+test_rwlock_donate_one (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw, RWLOCK_PREFER_READERS);
+  rwlock_acquire_read (&rw);
+  thread_create ("writer1", PRI_DEFAULT + 1, writer_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  thread_create ("writer2", PRI_DEFAULT + 2, writer_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_release_read (&rw);
+  msg ("writer2, writer1 must already have finished, in that order.");
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("%s: got the lock", thread_name ());
+  rwlock_release_write (rw);
+  msg ("%s: done", thread_name ());
+}
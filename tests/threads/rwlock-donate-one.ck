@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate-one) begin
+(rwlock-donate-one) This thread should have priority 32.  Actual priority: 32.
+(rwlock-donate-one) This thread should have priority 33.  Actual priority: 33.
+(rwlock-donate-one) writer2: got the lock
+(rwlock-donate-one) writer2: done
+(rwlock-donate-one) writer1: got the lock
+(rwlock-donate-one) writer1: done
+(rwlock-donate-one) writer2, writer1 must already have finished, in that order.
+(rwlock-donate-one) This thread should have priority 31.  Actual priority: 31.
+(rwlock-donate-one) end
+EOF
+pass;
@@ -0,0 +1,70 @@
+/* The main thread and a higher-priority reader thread both
+   acquire a readers-writer lock for reading.  A thread of higher
+   priority still blocks acquiring it for writing, which must
+   raise both readers, not just one, to its priority.  The writer
+   gets the lock as soon as the second reader releases it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct lock_and_sema 
+  {
+    struct rwlock rw;
+    struct semaphore sema;
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_donate_readers (void) 
+{
+  struct lock_and_sema ls;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&ls.rw, RWLOCK_PREFER_READERS);
+  sema_init (&ls.sema, 0);
+  rwlock_acquire_read (&ls.rw);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &ls);
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &ls);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  sema_up (&ls.sema);
+  rwlock_release_read (&ls.rw);
+  msg ("writer, reader must already have finished, in that order.");
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *ls_) 
+{
+  struct lock_and_sema *ls = ls_;
+
+  rwlock_acquire_read (&ls->rw);
+  msg ("reader: got the lock");
+  sema_down (&ls->sema);
+  msg ("reader: This thread should have priority %d.  "
+       "Actual priority: %d.", PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_release_read (&ls->rw);
+  msg ("reader: done");
+}
+
+static void
+writer_thread_func (void *ls_) 
+{
+  struct lock_and_sema *ls = ls_;
+
+  rwlock_acquire_write (&ls->rw);
+  msg ("writer: got the lock");
+  rwlock_release_write (&ls->rw);
+  msg ("writer: done");
+}
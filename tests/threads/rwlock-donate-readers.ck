@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate-readers) begin
+(rwlock-donate-readers) reader: got the lock
+(rwlock-donate-readers) This thread should have priority 33.  Actual priority: 33.
+(rwlock-donate-readers) reader: This thread should have priority 33.  Actual priority: 33.
+(rwlock-donate-readers) writer: got the lock
+(rwlock-donate-readers) writer: done
+(rwlock-donate-readers) reader: done
+(rwlock-donate-readers) writer, reader must already have finished, in that order.
+(rwlock-donate-readers) This thread should have priority 31.  Actual priority: 31.
+(rwlock-donate-readers) end
+EOF
+pass;
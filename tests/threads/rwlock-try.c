@@ -0,0 +1,64 @@
+/* Checks rwlock_try_acquire_read() and rwlock_try_acquire_write()
+   on a lock that prefers writers.  While the main thread reads,
+   another reader may get in but a writer may not; once a writer
+   is waiting, no new reader may get in either.  Neither call may
+   wait. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func try_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_try (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw, RWLOCK_PREFER_WRITERS);
+  msg ("main: try read: %s",
+       rwlock_try_acquire_read (&rw) ? "acquired" : "failed");
+  thread_create ("try1", PRI_DEFAULT + 1, try_thread_func, &rw);
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &rw);
+  thread_create ("try2", PRI_DEFAULT + 3, try_thread_func, &rw);
+  rwlock_release_read (&rw);
+  msg ("main: try write: %s",
+       rwlock_try_acquire_write (&rw) ? "acquired" : "failed");
+  rwlock_release_write (&rw);
+}
+
+static void
+try_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  msg ("%s: try write: %s", thread_name (),
+       rwlock_try_acquire_write (rw) ? "acquired" : "failed");
+  if (rwlock_try_acquire_read (rw))
+    {
+      msg ("%s: try read: acquired", thread_name ());
+      rwlock_release_read (rw);
+    }
+  else
+    msg ("%s: try read: failed", thread_name ());
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("writer: got the lock");
+  rwlock_release_write (rw);
+  msg ("writer: done");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-try) begin
+(rwlock-try) main: try read: acquired
+(rwlock-try) try1: try write: failed
+(rwlock-try) try1: try read: acquired
+(rwlock-try) try2: try write: failed
+(rwlock-try) try2: try read: failed
+(rwlock-try) writer: got the lock
+(rwlock-try) writer: done
+(rwlock-try) main: try write: acquired
+(rwlock-try) end
+EOF
+pass;
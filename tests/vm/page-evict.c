@@ -0,0 +1,69 @@
+/* Stamps each page of a buffer larger than physical memory with
+   its page number, then checks and restamps the pages in reverse
+   order and in a strided order, so that frames are evicted and
+   reused in orders other than the one they were filled in. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 768
+#define STRIDE 7
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+/* Returns the stamp of page I in pass PASS. */
+static uint32_t
+stamp (size_t i, uint32_t pass)
+{
+  return (uint32_t) i * 2654435761u ^ pass;
+}
+
+/* Writes page I's stamp for PASS at both ends of the page. */
+static void
+write_page (size_t i, uint32_t pass)
+{
+  uint32_t *p = (uint32_t *) (buf + i * PAGE_SIZE);
+  p[0] = p[PAGE_SIZE / sizeof *p - 1] = stamp (i, pass);
+}
+
+/* Fails unless page I holds its stamp for PASS. */
+static void
+check_page (size_t i, uint32_t pass)
+{
+  uint32_t *p = (uint32_t *) (buf + i * PAGE_SIZE);
+  uint32_t want = stamp (i, pass);
+  if (p[0] != want || p[PAGE_SIZE / sizeof *p - 1] != want)
+    fail ("page %zu holds %08x...%08x, expected %08x",
+          i, p[0], p[PAGE_SIZE / sizeof *p - 1], want);
+}
+
+void
+test_main (void)
+{
+  size_t i, j;
+
+  msg ("forward pass");
+  for (i = 0; i < PAGE_CNT; i++)
+    write_page (i, 1);
+
+  msg ("reverse pass");
+  for (i = PAGE_CNT; i-- > 0; )
+    {
+      check_page (i, 1);
+      write_page (i, 2);
+    }
+
+  msg ("strided pass");
+  for (j = 0; j < STRIDE; j++)
+    for (i = j; i < PAGE_CNT; i += STRIDE)
+      {
+        check_page (i, 2);
+        write_page (i, 3);
+      }
+
+  msg ("final pass");
+  for (i = 0; i < PAGE_CNT; i++)
+    check_page (i, 3);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-evict) begin
+(page-evict) forward pass
+(page-evict) reverse pass
+(page-evict) strided pass
+(page-evict) final pass
+(page-evict) end
+EOF
+pass;
@@ -36,6 +36,7 @@
 #include "devices/ide.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/journal.h"
   #ifdef FILESYS_USE_CACHE
 	#include "filesys/cache.h"
   #endif
@@ -261,10 +262,19 @@ parse_options (char **argv)
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
+      else if (!strcmp (name, "-bs"))
+        {
+          if (value == NULL || !filesys_set_block_size (atoi (value)))
+            PANIC ("block size must be 512, 1024, 2048 or 4096 bytes");
+        }
       else if (!strcmp (name, "-filesys"))
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-jt"))
+        journal_configure (atoi (value), 0);
+      else if (!strcmp (name, "-js"))
+        journal_configure (0, atoi (value));
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -333,6 +343,9 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"clone", 3, fsutil_clone},
+      {"defrag", 2, fsutil_defrag},
+      {"crash", 1, fsutil_crash},
 #endif
       {NULL, 0, NULL},
     };
@@ -379,6 +392,9 @@ usage (void)
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
           "  rm FILE            Delete FILE.\n"
+          "  clone FILE NEW     Create NEW sharing the data of FILE.\n"
+          "  defrag PATH        Make files at or below PATH contiguous, and pack them.\n"
+          "  crash              Power off without syncing the file system.\n"
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
@@ -389,8 +405,11 @@ usage (void)
           "  -r                 Reboot after actions.\n"
 #ifdef FILESYS
           "  -f                 Format file system device during startup.\n"
+          "  -bs=BYTES          Format with BYTES-byte blocks (default 512).\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -jt=TICKS          Commit the journal every TICKS timer ticks.\n"
+          "  -js=SECTORS        Commit the journal at SECTORS dirty sectors.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
@@ -398,3 +398,268 @@ void cond_broadcast(struct condition *cond, struct lock *lock) {
 	while (!list_empty(&cond->waiters))
 		cond_signal(cond, lock);
 }
+
+/* Initializes RWLOCK.  A readers-writer lock can be held by any
+   number of readers at once, or by a single writer.  It suits
+   data that is read far more often than it is changed, where a
+   plain lock would serialize the readers for nothing.
+
+   POLICY decides who goes first when readers and writers both
+   wait.  With RWLOCK_PREFER_WRITERS new readers queue up behind a
+   waiting writer, so a steady stream of readers cannot starve
+   writers; a thread must then not take the lock for reading twice.
+   With RWLOCK_PREFER_READERS readers get in whenever no writer
+   holds the lock.
+
+   Like locks, readers-writer locks donate priority: a thread that
+   has to wait raises every current holder, readers included, to
+   its own priority until they release the lock. */
+void rwlock_init (struct rwlock *rw, enum rwlock_policy policy)
+{
+    ASSERT (rw != NULL);
+
+    lock_init (&rw->lock);
+    cond_init (&rw->can_read);
+    cond_init (&rw->can_write);
+    list_init (&rw->holders);
+    rw->readers = 0;
+    rw->writer = NULL;
+    rw->waiting = 0;
+    rw->waiting_writers = 0;
+    rw->bounty = 0;
+    rw->policy = policy;
+}
+
+/* Returns true if a new reader may enter RW. */
+static bool rwlock_can_read (const struct rwlock *rw)
+{
+    if (rw->writer != NULL)
+        return false;
+    return rw->policy == RWLOCK_PREFER_READERS || rw->waiting_writers == 0;
+}
+
+/* Returns true if a writer may enter RW. */
+static bool rwlock_can_write (const struct rwlock *rw)
+{
+    return rw->writer == NULL && rw->readers == 0;
+}
+
+/* Records that the current thread holds RW, in one of the hold
+   slots of its struct thread. */
+static void rwlock_hold (struct rwlock *rw)
+{
+    struct thread *cur = thread_current ();
+    int i;
+
+    for (i = 0; i < THREAD_RWLOCK_CNT; i++)
+        if (cur->rw_holds[i].rw == NULL)
+        {
+            cur->rw_holds[i].rw = rw;
+            cur->rw_holds[i].thread = cur;
+            list_push_back (&rw->holders, &cur->rw_holds[i].elem);
+            return;
+        }
+    PANIC ("thread holds too many readers-writer locks");
+}
+
+/* Forgets the current thread's hold on RW. */
+static void rwlock_unhold (struct rwlock *rw)
+{
+    struct thread *cur = thread_current ();
+    int i;
+
+    for (i = 0; i < THREAD_RWLOCK_CNT; i++)
+        if (cur->rw_holds[i].rw == rw)
+        {
+            list_remove (&cur->rw_holds[i].elem);
+            cur->rw_holds[i].rw = NULL;
+            return;
+        }
+    NOT_REACHED ();
+}
+
+/* Raises every holder of RW to the current thread's priority,
+   which is about to wait for it. */
+static void rwlock_donate (struct rwlock *rw)
+{
+    struct list_elem *e;
+    enum intr_level old_level;
+
+    if (thread_mlfqs)
+        return;
+
+    old_level = intr_disable ();
+    if (rw->bounty < thread_current ()->current_priority)
+        rw->bounty = thread_current ()->current_priority;
+    for (e = list_begin (&rw->holders); e != list_end (&rw->holders);
+         e = list_next (e))
+        thread_promote (list_entry (e, struct rwlock_hold, elem)->thread);
+    intr_set_level (old_level);
+}
+
+/* Gives back any priority the current thread was donated through
+   a lock it no longer holds. */
+static void rwlock_undonate (void)
+{
+    enum intr_level old_level;
+
+    if (thread_mlfqs)
+        return;
+
+    old_level = intr_disable ();
+    if (thread_current ()->current_priority != thread_current ()->priority)
+        thread_demote ();
+    intr_set_level (old_level);
+}
+
+/* Wakes whoever may enter RW now that a holder has left. */
+static void rwlock_wake (struct rwlock *rw)
+{
+    if (!rwlock_can_write (rw))
+        return;
+    if (rw->waiting_writers > 0)
+    {
+        cond_signal (&rw->can_write, &rw->lock);
+        if (rw->policy == RWLOCK_PREFER_WRITERS)
+            return;
+    }
+    cond_broadcast (&rw->can_read, &rw->lock);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or,
+   under RWLOCK_PREFER_WRITERS, waits for it. */
+void rwlock_acquire_read (struct rwlock *rw)
+{
+    ASSERT (rw != NULL);
+    ASSERT (!intr_context ());
+    ASSERT (!rwlock_held_by_current_thread (rw));
+
+    lock_acquire (&rw->lock);
+    if (!rwlock_can_read (rw))
+    {
+        rw->waiting++;
+        do
+        {
+            rwlock_donate (rw);
+            cond_wait (&rw->can_read, &rw->lock);
+        }
+        while (!rwlock_can_read (rw));
+        if (--rw->waiting == 0)
+            rw->bounty = 0;
+    }
+    rw->readers++;
+    rwlock_hold (rw);
+    lock_release (&rw->lock);
+}
+
+/* Acquires RW for reading if that can be done without waiting for
+   a writer.  Returns true if successful. */
+bool rwlock_try_acquire_read (struct rwlock *rw)
+{
+    bool success;
+
+    ASSERT (rw != NULL);
+    ASSERT (!rwlock_held_by_current_thread (rw));
+
+    lock_acquire (&rw->lock);
+    success = rwlock_can_read (rw);
+    if (success)
+    {
+        rw->readers++;
+        rwlock_hold (rw);
+    }
+    lock_release (&rw->lock);
+    return success;
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void rwlock_release_read (struct rwlock *rw)
+{
+    ASSERT (rw != NULL);
+
+    lock_acquire (&rw->lock);
+    ASSERT (rw->readers > 0);
+    rw->readers--;
+    rwlock_unhold (rw);
+    rwlock_wake (rw);
+    lock_release (&rw->lock);
+    rwlock_undonate ();
+}
+
+/* Acquires RW for writing, sleeping until no thread reads or
+   writes it. */
+void rwlock_acquire_write (struct rwlock *rw)
+{
+    ASSERT (rw != NULL);
+    ASSERT (!intr_context ());
+    ASSERT (!rwlock_held_by_current_thread (rw));
+
+    lock_acquire (&rw->lock);
+    if (!rwlock_can_write (rw))
+    {
+        rw->waiting++;
+        rw->waiting_writers++;
+        do
+        {
+            rwlock_donate (rw);
+            cond_wait (&rw->can_write, &rw->lock);
+        }
+        while (!rwlock_can_write (rw));
+        rw->waiting_writers--;
+        if (--rw->waiting == 0)
+            rw->bounty = 0;
+    }
+    rw->writer = thread_current ();
+    rwlock_hold (rw);
+    lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing if no thread reads or writes it.
+   Returns true if successful. */
+bool rwlock_try_acquire_write (struct rwlock *rw)
+{
+    bool success;
+
+    ASSERT (rw != NULL);
+    ASSERT (!rwlock_held_by_current_thread (rw));
+
+    lock_acquire (&rw->lock);
+    success = rwlock_can_write (rw);
+    if (success)
+    {
+        rw->writer = thread_current ();
+        rwlock_hold (rw);
+    }
+    lock_release (&rw->lock);
+    return success;
+}
+
+/* Releases RW, which the current thread holds for writing, and
+   lets in the next writer, the waiting readers, or both,
+   depending on RW's policy. */
+void rwlock_release_write (struct rwlock *rw)
+{
+    ASSERT (rw != NULL);
+    ASSERT (rw->writer == thread_current ());
+
+    lock_acquire (&rw->lock);
+    rw->writer = NULL;
+    rwlock_unhold (rw);
+    rwlock_wake (rw);
+    lock_release (&rw->lock);
+    rwlock_undonate ();
+}
+
+/* Returns true if the current thread holds RW, for reading or for
+   writing. */
+bool rwlock_held_by_current_thread (const struct rwlock *rw)
+{
+    struct thread *cur = thread_current ();
+    int i;
+
+    ASSERT (rw != NULL);
+    for (i = 0; i < THREAD_RWLOCK_CNT; i++)
+        if (cur->rw_holds[i].rw == rw)
+            return true;
+    return false;
+}
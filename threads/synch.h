@@ -43,6 +43,46 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Who a readers-writer lock lets in first when both wait. */
+enum rwlock_policy
+{
+    RWLOCK_PREFER_READERS,      /* Readers enter unless a writer holds it. */
+    RWLOCK_PREFER_WRITERS       /* Readers also wait for waiting writers. */
+};
+
+/* Readers-writer lock. */
+struct rwlock
+{
+    struct lock lock;           /* Protects the fields below. */
+    struct condition can_read;  /* Signaled when readers may enter. */
+    struct condition can_write; /* Signaled when a writer may enter. */
+    struct list holders;        /* struct rwlock_hold of each holder. */
+    int readers;                /* Number of threads reading. */
+    struct thread *writer;      /* Thread writing, if any. */
+    int waiting;                /* Number of threads waiting. */
+    int waiting_writers;        /* Number of those that want to write. */
+    int bounty;                 /* Max priority of waiting threads. */
+    enum rwlock_policy policy;  /* Who goes first. */
+};
+
+/* A thread's hold on a readers-writer lock.  Stored in the thread,
+   so that waiters can find every reader to donate priority to. */
+struct rwlock_hold
+{
+    struct list_elem elem;      /* Element in the rwlock's holders. */
+    struct rwlock *rw;          /* Lock held, or null if unused. */
+    struct thread *thread;      /* Holding thread. */
+};
+
+void rwlock_init (struct rwlock *, enum rwlock_policy);
+void rwlock_acquire_read (struct rwlock *);
+bool rwlock_try_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -544,6 +544,13 @@ void thread_demote(void)
             new_priority = l->bounty;
         }
     }
+    int i;
+    for (i = 0; i < THREAD_RWLOCK_CNT; i++) {
+        struct rwlock *rw = cur->rw_holds[i].rw;
+        if (rw != NULL && rw->bounty > new_priority) {
+            new_priority = rw->bounty;
+        }
+    }
     //printf("[kernel] demoting current thread from %d to %d\n", old_priority, new_priority);
 
     cur->current_priority = new_priority;
@@ -5,6 +5,7 @@
 #include <list.h>
 #include <stdint.h>
 #include "userprog/common.h"
+#include "threads/synch.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -15,6 +16,9 @@ enum thread_status
     THREAD_DYING        /* About to be destroyed. */
 };
 
+/* Most readers-writer locks a thread can hold at once. */
+#define THREAD_RWLOCK_CNT 8
+
 /* Thread identifier type.
    You can redefine this to whatever type you like. */
 typedef int tid_t;
@@ -101,6 +105,8 @@ struct thread
     struct list_elem elem;              /* List element. */
 
     struct list owned_locks;
+    struct rwlock_hold rw_holds[THREAD_RWLOCK_CNT];  /* Readers-writer
+                                                       locks held. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -108,6 +114,10 @@ struct thread
     pid_t pid;
 #endif
 
+#ifdef FILESYS
+    int journal_depth;                  /* Nesting of journal operations. */
+#endif
+
 #ifdef VM
     void* esp;
     void* last_stack_page;
@@ -28,13 +28,16 @@
 	#include "vm/swap.h"
 	#include "vm/mmap.h"
 #endif
+#ifdef FILESYS_USE_CACHE
+	#include "filesys/cache.h"
+#endif
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
 
 static struct lock file_sys_lock;
-static struct lock hash_lock;
+static struct rwlock process_table_lock;
 static struct lock process_wait_lock;
 static struct lock pid_lock;
 static struct hash process_table;
@@ -67,23 +70,27 @@ bool process_hash_less_func (const struct hash_elem *a, const struct hash_elem *
 process_t * find_process(pid_t pid) {
   process_t dummy;
   dummy.pid = pid;
-  lock_acquire(&hash_lock);
+  rwlock_acquire_read(&process_table_lock);
   struct hash_elem *result = hash_find(&process_table, &(dummy.h_elem));
-  lock_release(&hash_lock);
+  rwlock_release_read(&process_table_lock);
   return result != NULL ? hash_entry(result, process_t, h_elem) : NULL;
 }
 
 void delete_process(process_t *proc) {
-  lock_acquire(&hash_lock);  
+#ifdef FILESYS_USE_CACHE
+  /* Whichever way the process ends, its quota entry is freed. */
+  cache_set_quota(proc->pid, 0);
+#endif
+  rwlock_acquire_write(&process_table_lock);
   hash_delete(&process_table, &(proc->h_elem));
   free(proc);
-  lock_release(&hash_lock);
+  rwlock_release_write(&process_table_lock);
 }
 
 void insert_process(process_t *proc) {
-  lock_acquire(&hash_lock);
+  rwlock_acquire_write(&process_table_lock);
   hash_insert(&process_table, &(proc->h_elem));  
-  lock_release(&hash_lock);
+  rwlock_release_write(&process_table_lock);
 }
 
 process_t *process_current(void) {
@@ -100,7 +107,7 @@ process_t *process_current(void) {
 void process_init(void) {
   lock_init(&process_wait_lock);
   lock_init(&pid_lock);
-  lock_init(&hash_lock);  
+  rwlock_init(&process_table_lock, RWLOCK_PREFER_WRITERS);
   lock_init(&file_sys_lock);
   hash_init(&process_table, &process_hash_func, process_hash_less_func, NULL);
 
@@ -154,6 +161,7 @@ void init_process( process_t* proc ) {
   lock_init(&proc->shared_res_lock);
   list_init( &proc->mmap_list);
   supl_pt_init(&proc->supl_pt);
+  rwlock_init(&proc->supl_pt_lock, RWLOCK_PREFER_WRITERS);
 #endif
   sema_init( &(proc->process_semaphore), 0);
 }
@@ -206,6 +214,18 @@ process_execute (const char *buf)
 
   /* Initialize process and add it into the hash table. */
   init_process(p);
+#ifdef FILESYS_USE_CACHE
+  /* A child starts with its parent's buffer cache quota, so a
+     batch job can be limited before it is started.  If the quota
+     table has no room for it, the child is not started rather than
+     run without the limit. */
+  if (!cache_set_quota(p->pid, cache_get_quota(p->ppid))) {
+    palloc_free_page (fn_copy);
+    palloc_free_page (fn_copy_name);
+    free (p);
+    return PID_ERROR;
+  }
+#endif
   insert_process(p);
 
   char* save_ptr;
@@ -401,6 +421,9 @@ process_exit (void)
     file_close(current->exe_file);    
   }
   lock_release(&file_sys_lock);
+#ifdef FILESYS_USE_CACHE
+  cache_set_quota(current->pid, 0);
+#endif
   //other cleanup here please
   
   printf("%s: exit(%d)\n", cur->name, exit_code);
@@ -745,7 +768,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		spte->writable = writable;
 		spte->swap_slot_no = -1;
 
-		supl_pt_insert(&(process_current()->supl_pt), spte);
+		supl_pt_insert(process_current(), spte);
 
 #else
 		if(!load_page(file, ofs, upage, page_read_bytes, page_zero_bytes, writable, -1))
@@ -960,7 +983,7 @@ stack_growth(int nr_of_pages)
 			spte->writable = true;
 			spte->page_read_bytes = 0; //this page will be always written to swap
 
-			supl_pt_insert(&(process_current()->supl_pt), spte);
+			supl_pt_insert(process_current(), spte);
 		  #endif
 		}
 		else
@@ -43,6 +43,8 @@ struct process_t {
 	struct lock shared_res_lock;
 	//supplemental page table - needed for lazy loading
 	struct hash supl_pt;
+	/* Lets page faults look up pages in parallel with each other. */
+	struct rwlock supl_pt_lock;
 	struct list mmap_list;
 #endif
 
@@ -10,11 +10,18 @@
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "filesys/fd.h"
+#include "filesys/inode.h"
+#ifdef FILESYS_USE_CACHE
+#include "filesys/cache.h"
+#endif
+#include <uio.h>
+#include <limits.h>
+#include <string.h>
 
 #ifdef FILESYS_SUBDIRS
 #include "filesys/directory.h"
 #include "filesys/path.h"
-#include <string.h>
+#include <dirent.h>
 #endif
 
 #ifdef VM
@@ -38,6 +45,20 @@ static void syscall_write(struct intr_frame *f);
 static void syscall_seek(struct intr_frame *f);
 static void syscall_tell(struct intr_frame *f);
 static void syscall_close(struct intr_frame *f);
+static void syscall_fallocate(struct intr_frame *f);
+static void syscall_pread(struct intr_frame *f);
+static void syscall_pwrite(struct intr_frame *f);
+static void syscall_readv(struct intr_frame *f);
+static void syscall_writev(struct intr_frame *f);
+static void syscall_copy_file_range(struct intr_frame *f);
+static void syscall_reflink(struct intr_frame *f);
+static void syscall_fsync(struct intr_frame *f);
+static void syscall_fdatasync(struct intr_frame *f);
+static void syscall_sync(struct intr_frame *f);
+static void syscall_compress(struct intr_frame *f);
+static void syscall_defrag(struct intr_frame *f);
+static void syscall_fadvise(struct intr_frame *f);
+static void syscall_cache_quota(struct intr_frame *f);
 
 #ifdef FILESYS_SUBDIRS
 static void syscall_chdir(struct intr_frame *f);
@@ -45,6 +66,7 @@ static void syscall_mkdir(struct intr_frame *f);
 static void syscall_readdir(struct intr_frame *f);
 static void syscall_isdir(struct intr_frame *f);
 static void syscall_inumber(struct intr_frame *f);
+static void syscall_getdents(struct intr_frame *f);
 #endif
 
 #ifdef VM
@@ -93,7 +115,9 @@ static bool is_valid_user_string_read(char* address UNUSED) {
 	return false;
 }
 
-/* Verify a given address range belongs to safe user space. */
+/* Verify a given address range belongs to safe user space.
+   Access rights only change at page boundaries, so one byte
+   per page is enough. */
 static bool is_valid_user_address_range_read(char* address UNUSED, int size UNUSED) {
 	char *end = address + size;
 	
@@ -101,14 +125,14 @@ static bool is_valid_user_address_range_read(char* address UNUSED, int size UNUS
 		return false;
 	
 	char *p;
-	for(p = address; p < end; ++p)
+	for(p = address; p < end; p = (char*)pg_round_down(p) + PGSIZE)
 		if(!is_valid_user_address_for_read(p))
 			return false;
 
 	return true;	
 }
 
-/* Verify a given address is safe for write */
+/* Verify a given address is safe for write, one byte per page. */
 static bool is_valid_user_address_range_write(char* address UNUSED, int size UNUSED) {
 	char *end = address + size;
 
@@ -116,7 +140,7 @@ static bool is_valid_user_address_range_write(char* address UNUSED, int size UNU
 		return false;
 
 	char *p;
-	for(p = address; p < end; ++p)
+	for(p = address; p < end; p = (char*)pg_round_down(p) + PGSIZE)
 		if(!is_valid_user_address_for_write(p))
 			return false;
 	return true;	
@@ -271,13 +295,7 @@ static void syscall_filesize(struct intr_frame *f) {
 	}
 
 	struct file *file = fd_get_file(fd);
-	 #ifndef FILESYS_SYNC
-		filesys_lock();
-	 #endif
 	f->eax = file != NULL ? file_length(file) : 0;
-	 #ifndef FILESYS_SYNC
-		filesys_unlock();
-	 #endif
 }
 
 /* Read from a file. */
@@ -308,16 +326,12 @@ void syscall_read(struct intr_frame *f) {
 	preload_and_pin_pages(buffer, size, frames);
 #endif
 
-	 #ifndef FILESYS_SYNC
-		filesys_lock();
-	 #endif
+	/* No global lock: the inode serializes what needs it. */
 	f->eax = file != NULL ? file_read(file, buffer, size) : 0;
-	 #ifndef FILESYS_SYNC
-		filesys_unlock();
-	 #endif
 
 #ifdef VM
 	ft_unpin_frames(frames, nr_of_frames);
+	free(frames);
 #endif
 }
 
@@ -357,16 +371,12 @@ void syscall_write(struct intr_frame *f) {
 	preload_and_pin_pages(buffer, size, frames);
 #endif
 
-	 #ifndef FILESYS_SYNC
-		filesys_lock();
-	 #endif
+	/* No global lock: the inode serializes what needs it. */
 	f->eax = file != NULL ? file_write(file, buffer, size) : 0;
-	 #ifndef FILESYS_SYNC
-		filesys_unlock();
-	 #endif
 
 #ifdef VM
 	ft_unpin_frames(frames, nr_of_frames);
+	free(frames);
 #endif
 
 }
@@ -382,15 +392,8 @@ static void syscall_seek(struct intr_frame *f) {
 	}
 
 	struct file *file = fd_get_file(fd);
-	if (file != NULL) {
-		 #ifndef FILESYS_SYNC
-		filesys_lock();
-	 #endif
+	if (file != NULL)
 		file_seek(file, position);
-		 #ifndef FILESYS_SYNC
-		filesys_unlock();
-	 #endif
-	}
 }
 
 /* Report current position in a file. */
@@ -403,13 +406,7 @@ static void syscall_tell(struct intr_frame *f) {
 	}
 
 	struct file *file = fd_get_file(fd);
-	 #ifndef FILESYS_SYNC
-		filesys_lock();
-	 #endif
 	f->eax = file != NULL ? file_tell(file) : 0;
-	 #ifndef FILESYS_SYNC
-		filesys_unlock();
-	 #endif
 }
 
 /* Close a file. */
@@ -445,6 +442,378 @@ struct fd_list_link *link = fd_get_link(fd);
 	fd_close(fd);
 }
 
+/* Allocate disk space for part of a file ahead of writing it. */
+static void syscall_fallocate(struct intr_frame *f) {
+	int fd = ((int*)f->esp)[1];
+	unsigned int offset = ((int*)f->esp)[2];
+	unsigned int length = ((int*)f->esp)[3];
+
+	if (!fd_is_valid(fd, WRITE) || fd == STDIN || fd == STDOUT) {
+		f->eax = false;
+		return;
+	}
+
+#ifdef FILESYS_SUBDIRS
+	if (fd_is_directory(fd)) {
+		f->eax = false;
+		return;
+	}
+#endif
+
+	struct file *file = fd_get_file(fd);
+	/* No global lock: the inode serializes what needs it. */
+	f->eax = file != NULL ? file_preallocate(file, length, offset) : false;
+}
+
+/* Copies the NIOV-element iovec array at user address UIOV into
+   IOV and checks that every buffer it names may be read from or,
+   if WRITABLE, written to.  Kills the process on a bad pointer.
+   Returns false if NIOV or the total length is out of range. */
+static bool copy_in_iovecs(struct iovec *iov, const struct iovec *uiov, int niov, bool writable) {
+	if (niov <= 0 || niov > IOV_MAX)
+		return false;
+	if (!is_valid_user_address_range_read((char*)uiov, niov * sizeof *uiov)) {
+		kill_current_process();
+		return false;
+	}
+	memcpy(iov, uiov, niov * sizeof *uiov);
+
+	size_t total = 0;
+	int i;
+	for (i = 0; i < niov; i++) {
+		char *base = iov[i].iov_base;
+		int len = iov[i].iov_len;
+		if (iov[i].iov_len > INT_MAX - total)
+			return false;
+		total += iov[i].iov_len;
+		if (writable ? !is_valid_user_address_range_write(base, len)
+		             : !is_valid_user_address_range_read(base, len)) {
+			kill_current_process();
+			return false;
+		}
+	}
+	return true;
+}
+
+#ifdef VM
+/* Brings the user pages under the NIOV buffers of IOV into memory
+   and pins them, so that they stay put while the file system
+   copies to or from them.  A page shared by several buffers is
+   pinned once.  Stores the frames, to be handed back to
+   ft_unpin_frames() and freed, in *FRAMESP and their number in
+   *CNT; if every buffer is empty, that is a null pointer and 0.
+   Returns false, pinning nothing, if out of memory. */
+static bool pin_user_buffers(const struct iovec *iov, int niov, frame ***framesp, int *cnt) {
+	int max = 0, n = 0;
+	int i, j;
+	for (i = 0; i < niov; i++) {
+		char *base = iov[i].iov_base;
+		if (iov[i].iov_len > 0)
+			max += (pg_round_up(base + iov[i].iov_len) - pg_round_down(base)) / PGSIZE;
+	}
+
+	*framesp = NULL;
+	*cnt = 0;
+	if (max == 0)
+		return true;
+	frame** frames = (frame**)malloc(max * sizeof(frame*));
+	if (frames == NULL)
+		return false;
+	for (i = 0; i < niov; i++) {
+		char *base = iov[i].iov_base;
+		char *end = base + iov[i].iov_len;
+		char *page;
+		if (iov[i].iov_len == 0)
+			continue;
+		for (page = pg_round_down(base); page < end; page += PGSIZE) {
+			for (j = 0; j < n; j++)
+				if (frames[j]->upage == page)
+					break;
+			if (j == n)
+				preload_and_pin_pages(page, 1, &frames[n++]);
+		}
+	}
+	*framesp = frames;
+	*cnt = n;
+	return true;
+}
+#endif
+
+/* Reads from or, if WRITE, writes to FILE through the NIOV
+   buffers of IOV, starting at byte OFS, or at the file position
+   if OFS is negative.  Stops at the first short transfer.  Returns
+   the number of bytes transferred, or -1 if the buffers could not
+   be pinned. */
+static int file_transfer(struct file *file, const struct iovec *iov, int niov, off_t ofs, bool write) {
+	int total = 0;
+	int i;
+
+#ifdef VM
+	int nr_of_frames;
+	frame** frames;
+	if (!pin_user_buffers(iov, niov, &frames, &nr_of_frames))
+		return -1;
+#endif
+
+	/* No global lock: the inode serializes what needs it. */
+	for (i = 0; i < niov; i++) {
+		off_t len = iov[i].iov_len;
+		off_t done;
+		if (ofs < 0)
+			done = write ? file_write(file, iov[i].iov_base, len)
+			             : file_read(file, iov[i].iov_base, len);
+		else
+			done = write ? file_write_at(file, iov[i].iov_base, len, ofs + total)
+			             : file_read_at(file, iov[i].iov_base, len, ofs + total);
+		total += done;
+		if (done < len)
+			break;
+	}
+
+#ifdef VM
+	ft_unpin_frames(frames, nr_of_frames);
+	free(frames);
+#endif
+	return total;
+}
+
+/* Returns the file FD names if it may be read or, if WRITE,
+   written through the positional and vectored calls, or NULL. */
+static struct file* transfer_file(int fd, bool write) {
+	if (!fd_is_valid(fd, write ? WRITE : READ) || fd == STDIN || fd == STDOUT)
+		return NULL;
+#ifdef FILESYS_SUBDIRS
+	if (fd_is_directory(fd))
+		return NULL;
+#endif
+	return fd_get_file(fd);
+}
+
+/* Read from a file at a given offset, leaving the file position
+   alone. */
+static void syscall_pread(struct intr_frame *f) {
+	int fd = ((int*)f->esp)[1];
+	struct iovec iov;
+	iov.iov_base = (void*)((int*)f->esp)[2];
+	iov.iov_len = (unsigned int)((int*)f->esp)[3];
+	unsigned int offset = (unsigned int)((int*)f->esp)[4];
+
+	if (!is_valid_user_address_range_write(iov.iov_base, iov.iov_len)) {
+		kill_current_process();
+		return;
+	}
+
+	struct file *file = transfer_file(fd, false);
+	if (file == NULL || iov.iov_len > INT_MAX || offset > INT_MAX) {
+		f->eax = -1;
+		return;
+	}
+	f->eax = file_transfer(file, &iov, 1, offset, false);
+}
+
+/* Write to a file at a given offset, leaving the file position
+   alone. */
+static void syscall_pwrite(struct intr_frame *f) {
+	int fd = ((int*)f->esp)[1];
+	struct iovec iov;
+	iov.iov_base = (void*)((int*)f->esp)[2];
+	iov.iov_len = (unsigned int)((int*)f->esp)[3];
+	unsigned int offset = (unsigned int)((int*)f->esp)[4];
+
+	if (!is_valid_user_address_range_read(iov.iov_base, iov.iov_len)) {
+		kill_current_process();
+		return;
+	}
+
+	struct file *file = transfer_file(fd, true);
+	if (file == NULL || iov.iov_len > INT_MAX || offset > INT_MAX) {
+		f->eax = -1;
+		return;
+	}
+	f->eax = file_transfer(file, &iov, 1, offset, true);
+}
+
+/* Read from a file into several buffers in turn. */
+static void syscall_readv(struct intr_frame *f) {
+	int fd = ((int*)f->esp)[1];
+	const struct iovec *uiov = (const struct iovec*)((int*)f->esp)[2];
+	int niov = ((int*)f->esp)[3];
+	struct iovec iov[IOV_MAX];
+
+	f->eax = -1;
+	if (!copy_in_iovecs(iov, uiov, niov, true))
+		return;
+
+	struct file *file = transfer_file(fd, false);
+	if (file != NULL)
+		f->eax = file_transfer(file, iov, niov, -1, false);
+}
+
+/* Write to a file from several buffers in turn. */
+static void syscall_writev(struct intr_frame *f) {
+	int fd = ((int*)f->esp)[1];
+	const struct iovec *uiov = (const struct iovec*)((int*)f->esp)[2];
+	int niov = ((int*)f->esp)[3];
+	struct iovec iov[IOV_MAX];
+
+	f->eax = -1;
+	if (!copy_in_iovecs(iov, uiov, niov, false))
+		return;
+
+	if (fd == STDOUT) {
+		int i, total = 0;
+		for (i = 0; i < niov; i++) {
+			putbuf(iov[i].iov_base, iov[i].iov_len);
+			total += iov[i].iov_len;
+		}
+		f->eax = total;
+		return;
+	}
+
+	struct file *file = transfer_file(fd, true);
+	if (file != NULL)
+		f->eax = file_transfer(file, iov, niov, -1, true);
+}
+
+/* Copy bytes from one file to another without a trip through
+   user memory. */
+static void syscall_copy_file_range(struct intr_frame *f) {
+	int fd_in = ((int*)f->esp)[1];
+	int fd_out = ((int*)f->esp)[2];
+	unsigned int length = ((int*)f->esp)[3];
+
+	struct file *in = transfer_file(fd_in, false);
+	struct file *out = transfer_file(fd_out, true);
+	if (in == NULL || out == NULL || length > INT_MAX) {
+		f->eax = -1;
+		return;
+	}
+
+	/* Refuse overlapping ranges within one file. */
+	off_t in_pos = file_tell(in);
+	off_t out_pos = file_tell(out);
+	if (file_get_inode(in) == file_get_inode(out)
+	    && in_pos < out_pos + (off_t)length && out_pos < in_pos + (off_t)length) {
+		f->eax = -1;
+		return;
+	}
+
+	f->eax = file_copy(out, in, length);
+}
+
+/* Clone a file, sharing its data until either copy is written. */
+static void syscall_reflink(struct intr_frame *f) {
+	char *old_name = (char*) ((int*)f->esp)[1];
+	char *new_name = (char*) ((int*)f->esp)[2];
+
+	if (!is_valid_user_string_read(old_name) || !is_valid_user_string_read(new_name)) {
+		kill_current_process();
+		return;
+	}
+
+	/* No global lock: the directory and inode locks serialize what
+	   needs it. */
+	f->eax = filesys_clone(old_name, new_name);
+}
+
+/* Returns the inode of file or directory FD, or NULL. */
+static struct inode* fd_inode(int fd) {
+	if (!fd_is_valid(fd, READ | WRITE) || fd == STDIN || fd == STDOUT)
+		return NULL;
+#ifdef FILESYS_SUBDIRS
+	if (fd_is_directory(fd))
+		return dir_get_inode(fd_get_dir(fd));
+#endif
+	struct file *file = fd_get_file(fd);
+	return file != NULL ? file_get_inode(file) : NULL;
+}
+
+/* Returns the inode of FD if it is a file that may be written,
+   or NULL. */
+static struct inode* fd_writable_inode(int fd) {
+	if (!fd_is_valid(fd, WRITE) || fd == STDIN || fd == STDOUT)
+		return NULL;
+#ifdef FILESYS_SUBDIRS
+	if (fd_is_directory(fd))
+		return NULL;
+#endif
+	struct file *file = fd_get_file(fd);
+	return file != NULL ? file_get_inode(file) : NULL;
+}
+
+/* Write a file's data and metadata to disk. */
+static void syscall_fsync(struct intr_frame *f) {
+	struct inode *inode = fd_inode(((int*)f->esp)[1]);
+	f->eax = inode != NULL && inode_sync(inode, false);
+}
+
+/* Write a file's data, and only the metadata needed to read it
+   back, to disk. */
+static void syscall_fdatasync(struct intr_frame *f) {
+	struct inode *inode = fd_inode(((int*)f->esp)[1]);
+	f->eax = inode != NULL && inode_sync(inode, true);
+}
+
+/* Write everything the file system holds in memory to disk. */
+static void syscall_sync(struct intr_frame *f) {
+	filesys_sync();
+	f->eax = 0;
+}
+
+/* Store a file's data compressed from now on. */
+static void syscall_compress(struct intr_frame *f) {
+	struct inode *inode = fd_writable_inode(((int*)f->esp)[1]);
+	f->eax = inode != NULL && inode_set_compressed(inode);
+}
+
+/* Move a file's data into one contiguous run. */
+static void syscall_defrag(struct intr_frame *f) {
+	struct inode *inode = fd_writable_inode(((int*)f->esp)[1]);
+	f->eax = inode != NULL && inode_defrag(inode);
+}
+
+/* Declare how part of a file will be used, so that the buffer
+   cache can read ahead, fetch or drop it accordingly. */
+static void syscall_fadvise(struct intr_frame *f) {
+	int fd = ((int*)f->esp)[1];
+	struct inode *inode = fd_inode(fd);
+	off_t offset = ((int*)f->esp)[2];
+	off_t length = ((int*)f->esp)[3];
+	int advice = ((int*)f->esp)[4];
+
+	if (inode == NULL || offset < 0 || length < 0) {
+		f->eax = false;
+		return;
+	}
+#ifdef FILESYS_SUBDIRS
+	/* A directory has no access pattern of its own, only ranges
+	   to fetch or drop. */
+	if (fd_is_directory(fd)) {
+		f->eax = inode_advise(inode, offset, length, advice);
+		return;
+	}
+#endif
+	f->eax = file_advise(fd_get_file(fd), offset, length, advice);
+}
+
+/* Set the soft buffer cache quota, in cache slots, of this process
+   or of one of its children.  0 removes it. */
+static void syscall_cache_quota(struct intr_frame *f) {
+#ifdef FILESYS_USE_CACHE
+	pid_t pid = ((int*)f->esp)[1];
+	int slots = ((int*)f->esp)[2];
+	process_t *current = process_current();
+	process_t *target = pid == current->pid ? current : find_process(pid);
+
+	/* A process that has exited would never give its quota back. */
+	f->eax = target != NULL && target->status == ALIVE && slots >= 0
+		&& (target == current || target->ppid == current->pid)
+		&& cache_set_quota(pid, slots);
+#else
+	f->eax = false;
+#endif
+}
+
 /* Start another process. */
 void syscall_exec(struct intr_frame *f) {
 	char *buf = (char*) ((int*)f->esp)[1];
@@ -502,12 +871,12 @@ static void syscall_mmap(struct intr_frame *f) {
 			--pageIndex;
 			//rollback & break
 			while(pageIndex >= 0) {
-				supl_pt_remove(&(p->supl_pt), gPages[pageIndex]);
+				supl_pt_remove(p, gPages[pageIndex]);
 				--pageIndex;
 			}
 			return;
 		}
-		supl_pt_insert(&(p->supl_pt), spte);
+		supl_pt_insert(p, spte);
 		//pagedir_set_present(th->pagedir, addr, false);
 		addr += PGSIZE;
 		pageIndex++;
@@ -578,6 +947,42 @@ static void syscall_inumber(struct intr_frame *f) {
 	int fd = (int)((int*)f->esp)[1];
 	f->eax = fd_inode_number(fd);
 }
+
+/* Read as many directory entries, with their attributes, as fit in the buffer. */
+static void syscall_getdents(struct intr_frame *f) {
+	int fd = (int)((int*)f->esp)[1];
+	struct dirent *entries = (struct dirent*) ((int*)f->esp)[2];
+	unsigned int max_entries = (unsigned int) ((int*)f->esp)[3];
+
+	if (max_entries > PGSIZE / sizeof(struct dirent))
+		max_entries = PGSIZE / sizeof(struct dirent);
+	int size = max_entries * sizeof(struct dirent);
+
+	if (!is_valid_user_address_range_write((char*)entries, size)) {
+		kill_current_process();
+		return;
+	}
+
+	struct dir *dir = fd_get_dir(fd);
+	if (dir == NULL) {
+		f->eax = -1;
+		return;
+	}
+
+#ifdef VM
+	//make sure that every page is in memory and will not be swapped out
+	int nr_of_frames = (pg_round_up((char*)entries + size) - pg_round_down(entries)) / PGSIZE;
+	frame** frames = (frame**)malloc(nr_of_frames * sizeof(frame*));
+	preload_and_pin_pages((char*)entries, size, frames);
+#endif
+
+	f->eax = dir_readdir_batch(dir, entries, max_entries);
+
+#ifdef VM
+	ft_unpin_frames(frames, nr_of_frames);
+	free(frames);
+#endif
+}
 #endif
 
 static void syscall_handler (struct intr_frame *f) 
@@ -631,6 +1036,48 @@ static void syscall_handler (struct intr_frame *f)
 		case SYS_CLOSE:
 			syscall_close(f);
 			break;
+		case SYS_FALLOCATE:
+			syscall_fallocate(f);
+			break;
+		case SYS_PREAD:
+			syscall_pread(f);
+			break;
+		case SYS_PWRITE:
+			syscall_pwrite(f);
+			break;
+		case SYS_READV:
+			syscall_readv(f);
+			break;
+		case SYS_WRITEV:
+			syscall_writev(f);
+			break;
+		case SYS_COPY_FILE_RANGE:
+			syscall_copy_file_range(f);
+			break;
+		case SYS_REFLINK:
+			syscall_reflink(f);
+			break;
+		case SYS_FSYNC:
+			syscall_fsync(f);
+			break;
+		case SYS_FDATASYNC:
+			syscall_fdatasync(f);
+			break;
+		case SYS_SYNC:
+			syscall_sync(f);
+			break;
+		case SYS_COMPRESS:
+			syscall_compress(f);
+			break;
+		case SYS_DEFRAG:
+			syscall_defrag(f);
+			break;
+		case SYS_FADVISE:
+			syscall_fadvise(f);
+			break;
+		case SYS_CACHE_QUOTA:
+			syscall_cache_quota(f);
+			break;
 #ifdef VM
 		case SYS_MMAP:
 			syscall_mmap(f);
@@ -655,6 +1102,9 @@ static void syscall_handler (struct intr_frame *f)
 		case SYS_INUMBER:
 			syscall_inumber(f);
 			break;
+		case SYS_GETDENTS:
+			syscall_getdents(f);
+			break;
 #endif
 		default:
 			thread_exit();  
@@ -0,0 +1,399 @@
+/* Builds a Pintos file system image on the host.
+
+   Formats an image the way the kernel's "-f" does and copies host
+   files and directory trees into it, writing inodes, directories,
+   the free map, the share map, the journal superblock and the file
+   system superblock directly.  The result goes into a disk with
+   "pintos-mkdisk --filesys=IMAGE", which is much faster than
+   extracting a tar archive under the simulator.
+
+   The on-disk structures come from filesys/layout.h, and which
+   layout they describe from the FILESYS_EXTEND_FILES and
+   FILESYS_SUBDIRS the program is built with.  utils/Makefile takes
+   them from a project's Make.vars, filesys unless MKFS_PROJECT says
+   otherwise, so an image only mounts under that project's kernel. */
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* The host's NAME_MAX, from <dirent.h>, gives way to Pintos's. */
+#undef NAME_MAX
+#include "filesys/layout.h"
+
+#define SECTOR_SIZE BLOCK_SECTOR_SIZE
+
+/* Entries a new directory has room for, from filesys/filesys.c. */
+#define DIR_MIN_ENTRIES 16
+
+_Static_assert (sizeof (struct inode_disk) == SECTOR_SIZE,
+                "struct inode_disk must be one sector");
+
+static const char *program_name;
+static uint8_t *image;                  /* The whole image. */
+static size_t sector_cnt;               /* Sectors in the image. */
+static size_t block_sectors = 1;        /* Sectors per block. */
+static size_t block_cnt;                /* Whole blocks in the image. */
+static uint8_t *used;                   /* One byte per block. */
+
+static void
+fail (const char *format, ...)
+{
+  va_list args;
+
+  fprintf (stderr, "%s: ", program_name);
+  va_start (args, format);
+  vfprintf (stderr, format, args);
+  va_end (args);
+  putc ('\n', stderr);
+  exit (EXIT_FAILURE);
+}
+
+static void
+usage (void)
+{
+  fprintf (stderr,
+           "pintos-mkfs, builds a Pintos file system image on the host\n"
+           "usage: %s [-s MB] [-b BYTES] IMAGE [PATH[=NAME]]...\n"
+           "  where IMAGE is the file system image to create,\n"
+           "    each PATH is a host file or directory tree to copy into\n"
+           "    the root directory, as NAME if given,\n"
+           "    -s sets the image size in MB (default: 2),\n"
+           "    and -b sets the block size, 512 to 4096 (default: 512).\n"
+           "Put IMAGE on a disk with \"pintos-mkdisk --filesys=IMAGE\".\n",
+           program_name);
+  exit (EXIT_FAILURE);
+}
+
+/* Returns the address of SECTOR in the image. */
+static uint8_t *
+sector_at (uint32_t sector)
+{
+  return image + (size_t) sector * SECTOR_SIZE;
+}
+
+/* Marks the block holding SECTOR in use. */
+static void
+mark (uint32_t sector)
+{
+  used[sector / block_sectors] = 1;
+}
+
+/* Allocates CNT consecutive sectors, rounded up to whole blocks,
+   first fit, and returns the first. */
+static uint32_t
+allocate (size_t cnt)
+{
+  size_t blocks = (cnt + block_sectors - 1) / block_sectors;
+  size_t start, run = 0, i;
+
+  for (start = i = 0; i < block_cnt; i++)
+    if (used[i])
+      {
+        run = 0;
+        start = i + 1;
+      }
+    else if (++run == blocks)
+      {
+        memset (used + start, 1, blocks);
+        return start * block_sectors;
+      }
+  fail ("image full: no room for %zu sectors", cnt);
+  return 0;
+}
+
+/* Writes an inode to SECTOR for SIZE bytes of DATA, inline if it
+   fits, otherwise in one run of data sectors, as the kernel's
+   inode_create() and later writes would leave it. */
+static void
+write_inode (uint32_t sector, uint32_t parent, const void *data, size_t size)
+{
+  struct inode_disk *disk_inode = (struct inode_disk *) sector_at (sector);
+
+  if (size > INT32_MAX)
+    fail ("file too large: %zu bytes", size);
+  memset (disk_inode, 0, sizeof *disk_inode);
+#ifdef FILESYS_EXTEND_FILES
+  disk_inode->file_total_size = size;
+#else
+  disk_inode->length = size;
+#endif
+#ifdef FILESYS_SUBDIRS
+  disk_inode->parent_dir_inode = parent;
+#else
+  (void) parent;
+#endif
+  disk_inode->magic = INODE_MAGIC;
+  if (size <= INODE_INLINE_SIZE)
+    {
+      disk_inode->flags = INODE_INLINE;
+      memcpy (disk_inode->inline_data, data, size);
+    }
+  else
+    {
+      size_t sectors = (size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+      sectors = (sectors + block_sectors - 1) / block_sectors * block_sectors;
+#ifdef FILESYS_EXTEND_FILES
+      disk_inode->start[0] = allocate (sectors);
+      disk_inode->length[0] = sectors;
+      memcpy (sector_at (disk_inode->start[0]), data, size);
+#else
+      disk_inode->start = allocate (sectors);
+      memcpy (sector_at (disk_inode->start), data, size);
+#endif
+    }
+}
+
+/* Reads host file PATH into memory.  Stores its size in *SIZE. */
+static uint8_t *
+read_file (const char *path, size_t *size)
+{
+  FILE *file = fopen (path, "rb");
+  uint8_t *data;
+  struct stat st;
+
+  if (file == NULL || fstat (fileno (file), &st) < 0)
+    fail ("%s: %s", path, strerror (errno));
+  *size = st.st_size;
+  data = malloc (*size > 0 ? *size : 1);
+  if (data == NULL)
+    fail ("out of memory");
+  if (fread (data, 1, *size, file) != *size)
+    fail ("%s: read error", path);
+  fclose (file);
+  return data;
+}
+
+static void add_dir (uint32_t, uint32_t, const char *);
+
+/* Adds an entry for host file or directory PATH, named NAME, to the
+   ENTRY_CNT entries at *ENTRIES of the directory whose inode is in
+   DIR_SECTOR. */
+static void
+add_entry (struct dir_entry **entries, size_t *entry_cnt, uint32_t dir_sector,
+           const char *path, const char *name)
+{
+  struct dir_entry *e;
+  struct stat st;
+  size_t i;
+
+  if (strlen (name) == 0 || strlen (name) > NAME_MAX || strchr (name, '/'))
+    fail ("%s: name \"%s\" not allowed in Pintos", path, name);
+  for (i = 0; i < *entry_cnt; i++)
+    if (!strcmp ((*entries)[i].name, name))
+      fail ("%s: duplicate name \"%s\"", path, name);
+  if (stat (path, &st) < 0)
+    fail ("%s: %s", path, strerror (errno));
+
+  *entries = realloc (*entries, (*entry_cnt + 1) * sizeof **entries);
+  if (*entries == NULL)
+    fail ("out of memory");
+  e = &(*entries)[(*entry_cnt)++];
+  memset (e, 0, sizeof *e);
+  strcpy (e->name, name);
+  e->in_use = 1;
+  e->inode_sector = allocate (1);
+
+  if (S_ISDIR (st.st_mode))
+    {
+#ifndef FILESYS_SUBDIRS
+      fail ("%s: directories need a kernel with FILESYS_SUBDIRS", path);
+#endif
+      e->is_directory = 1;
+      add_dir (e->inode_sector, dir_sector, path);
+    }
+  else if (S_ISREG (st.st_mode))
+    {
+      size_t size;
+      uint8_t *data = read_file (path, &size);
+      write_inode (e->inode_sector, dir_sector, data, size);
+      free (data);
+    }
+  else
+    fail ("%s: not a regular file or directory", path);
+}
+
+/* Writes the directory whose inode is in SECTOR, with parent
+   PARENT, holding the entries of host directory PATH, or none if
+   PATH is null. */
+static void
+add_dir (uint32_t sector, uint32_t parent, const char *path)
+{
+  struct dir_entry *entries = NULL;
+  size_t entry_cnt = 0, size;
+
+  if (path != NULL)
+    {
+      DIR *dir = opendir (path);
+      struct dirent *de;
+
+      if (dir == NULL)
+        fail ("%s: %s", path, strerror (errno));
+      while ((de = readdir (dir)) != NULL)
+        if (strcmp (de->d_name, ".") && strcmp (de->d_name, ".."))
+          {
+            char *child = malloc (strlen (path) + strlen (de->d_name) + 2);
+            if (child == NULL)
+              fail ("out of memory");
+            sprintf (child, "%s/%s", path, de->d_name);
+            add_entry (&entries, &entry_cnt, sector, child, de->d_name);
+            free (child);
+          }
+      closedir (dir);
+    }
+
+  size = (entry_cnt > DIR_MIN_ENTRIES ? entry_cnt : DIR_MIN_ENTRIES)
+         * sizeof *entries;
+  entries = realloc (entries, size);
+  if (entries == NULL)
+    fail ("out of memory");
+  memset (entries + entry_cnt, 0, size - entry_cnt * sizeof *entries);
+  write_inode (sector, parent, entries, size);
+  free (entries);
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct dir_entry *root = NULL;
+  size_t root_cnt = 0, log_length, map_bytes, i;
+  uint32_t log_start, map_start;
+  double size_mb = 2.0;
+  const char *image_fn;
+  struct journal_super *journal;
+  struct super_disk *super;
+  uint8_t *map, *share;
+  uint16_t probe = 1;
+  FILE *out;
+  int opt;
+
+  program_name = argv[0];
+  while ((opt = getopt (argc, argv, "s:b:h")) != -1)
+    switch (opt)
+      {
+      case 's':
+        size_mb = strtod (optarg, NULL);
+        break;
+      case 'b':
+        block_sectors = strtoul (optarg, NULL, 10) / SECTOR_SIZE;
+        if (strtoul (optarg, NULL, 10) % SECTOR_SIZE != 0
+            || (block_sectors != 1 && block_sectors != 2
+                && block_sectors != 4 && block_sectors != 8))
+          fail ("%s: block size must be 512, 1024, 2048 or 4096", optarg);
+        break;
+      default:
+        usage ();
+      }
+  if (optind >= argc)
+    usage ();
+  image_fn = argv[optind++];
+
+  /* The structures are written as they are laid out in memory. */
+  if (*(uint8_t *) &probe != 1)
+    fail ("host must be little-endian");
+
+  sector_cnt = size_mb * 1024 * 1024 / SECTOR_SIZE;
+  block_cnt = sector_cnt / block_sectors;
+  if (block_cnt * block_sectors <= SUPER_SECTOR + 1 + LOG_MIN_SECTORS)
+    fail ("image too small");
+  image = calloc (sector_cnt, SECTOR_SIZE);
+  used = calloc (block_cnt, 1);
+  if (image == NULL || used == NULL)
+    fail ("out of memory");
+
+  /* Fixed sectors, then the log, as in the kernel's do_format(). */
+  mark (FREE_MAP_SECTOR);
+  mark (ROOT_DIR_SECTOR);
+#ifdef FILESYS_EXTEND_FILES
+  mark (SHARE_MAP_SECTOR);
+#endif
+  mark (JOURNAL_SECTOR);
+  mark (SUPER_SECTOR);
+  super = (struct super_disk *) sector_at (SUPER_SECTOR);
+  super->magic = SUPER_MAGIC;
+  super->block_sectors = block_sectors;
+
+  log_length = sector_cnt / LOG_FRACTION;
+  if (log_length < LOG_MIN_SECTORS)
+    log_length = LOG_MIN_SECTORS;
+  if (log_length > LOG_MAX_SECTORS)
+    log_length = LOG_MAX_SECTORS;
+  log_start = allocate (log_length);
+  journal = (struct journal_super *) sector_at (JOURNAL_SECTOR);
+  journal->magic = JOURNAL_MAGIC;
+  journal->start = log_start;
+  journal->length = log_length;
+  journal->seq = 1;
+
+  /* The free map and, with FILESYS_EXTEND_FILES, the share map
+     files get their sectors before any file, but the free map's
+     contents are only known at the end.
+     The free map is a bitmap of 32-bit words, one bit per block;
+     the share map holds a zero byte per block. */
+  map_bytes = (block_cnt + 31) / 32 * 4;
+  map = calloc (map_bytes, 1);
+  share = calloc (block_cnt, 1);
+  if (map == NULL || share == NULL)
+    fail ("out of memory");
+  write_inode (FREE_MAP_SECTOR, FREE_MAP_SECTOR, map, map_bytes);
+#ifdef FILESYS_EXTEND_FILES
+  map_start = ((struct inode_disk *) sector_at (FREE_MAP_SECTOR))->start[0];
+  write_inode (SHARE_MAP_SECTOR, SHARE_MAP_SECTOR, share, block_cnt);
+#else
+  map_start = ((struct inode_disk *) sector_at (FREE_MAP_SECTOR))->start;
+#endif
+  free (share);
+
+  /* The root directory and everything in it. */
+  for (; optind < argc; optind++)
+    {
+      char *path = argv[optind];
+      char *eq = strchr (path, '=');
+      const char *name;
+
+      if (eq != NULL)
+        {
+          *eq = '\0';
+          name = eq + 1;
+        }
+      else
+        {
+          name = strrchr (path, '/');
+          name = name != NULL ? name + 1 : path;
+        }
+      add_entry (&root, &root_cnt, ROOT_DIR_SECTOR, path, name);
+    }
+  {
+    size_t size = (root_cnt > DIR_MIN_ENTRIES ? root_cnt : DIR_MIN_ENTRIES)
+                  * sizeof *root;
+    root = realloc (root, size);
+    if (root == NULL)
+      fail ("out of memory");
+    memset (root + root_cnt, 0, size - root_cnt * sizeof *root);
+    write_inode (ROOT_DIR_SECTOR, ROOT_DIR_SECTOR, root, size);
+  }
+
+  /* Now that every block is placed, fill in the free map. */
+  for (i = 0; i < block_cnt; i++)
+    if (used[i])
+      map[i / 8] |= 1 << (i % 8);
+  if (map_bytes <= INODE_INLINE_SIZE)
+    memcpy (((struct inode_disk *) sector_at (FREE_MAP_SECTOR))->inline_data,
+            map, map_bytes);
+  else
+    memcpy (sector_at (map_start), map, map_bytes);
+
+  out = fopen (image_fn, "wb");
+  if (out == NULL)
+    fail ("%s: %s", image_fn, strerror (errno));
+  if (fwrite (image, SECTOR_SIZE, sector_cnt, out) != sector_cnt
+      || fclose (out) != 0)
+    fail ("%s: write error", image_fn);
+  return EXIT_SUCCESS;
+}
@@ -15,34 +15,44 @@
 
 #include <string.h>
 
-/* The frame table */
-static struct list frame_table;
-static struct list_elem *lru_cursor = NULL;
-
-/* A lock for frame_table synchronized access*/
-struct lock ft_lock;
+/* The frame table: one entry per page of the user pool, the
+   entry of kpage at (kpage - palloc_user_base ()) / PGSIZE.
+   Entries are never freed; ft_remove_frame() only marks them
+   unused. */
+static frame *frame_table;
+static size_t frame_cnt;
+static size_t lru_cursor;
+
+/* A lock for frame_table synchronized access.  Lookups only read
+   the table, so they share it; anything that links, unlinks or
+   pins a frame writes. */
+static struct rwlock ft_lock;
 
 static bool install_frame (frame* frame, bool writable);
 
+/* Returns the entry of KPAGE, or NULL if KPAGE is not a page of
+   the user pool. */
+static frame* frame_entry (void *kpage)
+{
+	uint8_t *base = palloc_user_base();
+
+	if((uint8_t *) kpage < base)
+		return NULL;
+	size_t i = ((uint8_t *) kpage - base) / PGSIZE;
+	return i < frame_cnt ? &frame_table[i] : NULL;
+}
+
 static frame* frame_lookup (void *kpage)
 {
-	struct list_elem *e = list_head (&frame_table);
-	while ((e = list_next (e)) != list_end (&frame_table))
-	{
-		frame *f = list_entry(e, frame, list_elem);
-		if(f->kpage == kpage)
-		{
-			return f;
-		}
-	}
-	return NULL;
+	frame *f = frame_entry(kpage);
+	return f != NULL && f->used ? f : NULL;
 }
 
 void* ft_get_frame(void *kpage)
 {
-	lock_acquire(&ft_lock);
+	rwlock_acquire_read(&ft_lock);
 	frame *f = frame_lookup(kpage);
-	lock_release(&ft_lock);
+	rwlock_release_read(&ft_lock);
 	return f;
 }
 
@@ -51,8 +61,16 @@ void* ft_get_frame(void *kpage)
  */
 void ft_init(void)
 {
-	list_init(&frame_table);
-	lock_init(&ft_lock);
+	uint8_t *base = palloc_user_base();
+	size_t i;
+
+	frame_cnt = palloc_user_page_cnt();
+	frame_table = calloc(frame_cnt, sizeof *frame_table);
+	if(frame_table == NULL)
+		PANIC("no memory for a frame table of %zu frames", frame_cnt);
+	for(i = 0; i < frame_cnt; ++i)
+		frame_table[i].kpage = base + i * PGSIZE;
+	rwlock_init(&ft_lock, RWLOCK_PREFER_WRITERS);
 }
 
 /**
@@ -62,15 +80,15 @@ void ft_insert_frame(frame *f)
 {
 	ASSERT(ft_get_frame(f->kpage) == NULL);
 
-	lock_acquire(&ft_lock);
-	list_push_back(&frame_table, &(f->list_elem));
-	lock_release(&ft_lock);
+	rwlock_acquire_write(&ft_lock);
+	f->used = true;
+	rwlock_release_write(&ft_lock);
 }
 
 /**
  * Removes the frame given from the
- * frame_table and frees the space
- * occupied by the frame table entry.
+ * frame_table. The entry stays pinned
+ * until the page is allocated again.
  * Frame needs to be pinned when
  * calling this function
  */
@@ -78,15 +96,9 @@ void ft_remove_frame(frame* toRemoveFrame)
 {
 	ASSERT(toRemoveFrame->pinned == true);
 
-	lock_acquire(&ft_lock);
-
-	frame *lru_cursor_frame = list_entry(lru_cursor, frame, list_elem);
-	if(toRemoveFrame == lru_cursor_frame) {
-		lru_cursor = list_next(lru_cursor);
-	}
-	list_remove(&(toRemoveFrame->list_elem));
-	free(toRemoveFrame);
-	lock_release(&ft_lock);
+	rwlock_acquire_write(&ft_lock);
+	toRemoveFrame->used = false;
+	rwlock_release_write(&ft_lock);
 }
 
 /**
@@ -109,8 +121,8 @@ frame* ft_alloc_frame(bool zero_page, bool writable, void *page_u_addr)
 	frame *f;
 
 	if (page_k_addr != NULL ) {
-		f = (frame *) malloc(sizeof(frame));
-		f->kpage = page_k_addr;
+		f = frame_entry(page_k_addr);
+		ASSERT(f != NULL);
 		f->pinned = true;
 		ft_insert_frame(f);
 	} else {
@@ -166,28 +178,24 @@ void ft_free_frame(frame *f)
  */
 frame *ft_get_lru_frame(void)
 {
-	lock_acquire(&ft_lock);
-
-	if (lru_cursor == NULL) {
-		lru_cursor = list_head(&frame_table);
-	}
+	rwlock_acquire_write(&ft_lock);
 
 	while (true)
 	{
-		lru_cursor = list_next(lru_cursor);
-
 		// restart from the beginning
-		if (lru_cursor == list_end(&frame_table)) {
-			lru_cursor = list_next(list_head(&frame_table));
+		if (++lru_cursor == frame_cnt) {
+			lru_cursor = 0;
 		}
 
-		frame *f = list_entry(lru_cursor, frame, list_elem);
+		frame *f = &frame_table[lru_cursor];
+		if (!f->used)
+			continue;
 		if (!pagedir_is_accessed(f->pagedir, f->upage) && !f->pinned) {
 			//empathy programming - if the process is dying, leave him alone :)
 			if(!lock_try_acquire(&f->process->shared_res_lock))
 				continue;
 			f->pinned = true;
-			lock_release(&ft_lock);
+			rwlock_release_write(&ft_lock);
 			return f;
 		} else {
 			pagedir_set_accessed(f->pagedir, f->upage, false);
@@ -247,10 +255,10 @@ bool ft_atomic_pin_frame(frame *f)
 {
 	while(f->pinned == true);
 
-	lock_acquire(&ft_lock);
+	rwlock_acquire_write(&ft_lock);
 	ASSERT(f->pinned != true);
 	f->pinned = true;
-	lock_release(&ft_lock);
+	rwlock_release_write(&ft_lock);
 
 	return true;
 }
@@ -260,33 +268,35 @@ bool ft_atomic_pin_frame(frame *f)
  */
 frame* ft_atomic_pin_upage(void *pagedir, void *uaddr)
 {
-	lock_acquire(&ft_lock);
+	rwlock_acquire_write(&ft_lock);
 
 	void *kpage = pagedir_get_page(pagedir, uaddr);
 
 	//page is not present in page table anymore
 	//evicted or in process of eviction
 	if(!kpage) {
-		lock_release(&ft_lock);
+		rwlock_release_write(&ft_lock);
 		return NULL;
 	}
 
 	frame *f = frame_lookup(kpage);
-	if(!f)
+	if(!f) {
+		rwlock_release_write(&ft_lock);
 		return NULL;
+	}
 
 	//if frame is already pinned than page
 	//might be in process of eviction but the page
 	//was not set not present yet
 	if(f->pinned == true)
 	{
-		lock_release(&ft_lock);
+		rwlock_release_write(&ft_lock);
 		return NULL;
 	}
 
 	ASSERT(f->pinned != true);
 	f->pinned = true;
-	lock_release(&ft_lock);
+	rwlock_release_write(&ft_lock);
 
 	return f;
 }
@@ -1,7 +1,7 @@
 #ifndef FRAME_H
 #define FRAME_H
 
-#include <list.h>
+#include <stdbool.h>
 #include "vm/common.h"
 
 struct frame
@@ -21,7 +21,8 @@ struct frame
 	//if frame is pinned, the contained page can not be evicted
 	bool  pinned;
 
-	struct list_elem list_elem; //needed for hash_table
+	//the frame is in the frame table, holding a user page
+	bool  used;
 };
 
 //initializes the frame-table
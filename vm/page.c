@@ -10,7 +10,7 @@
 
 static unsigned page_hash(const struct hash_elem *p_, void *aux UNUSED);
 static bool page_less(const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED);
-supl_pte* page_lookup(process_t *process, const uint32_t pg_no);
+static supl_pte* page_lookup(process_t *process, const uint32_t pg_no);
 
 void supl_pt_init(struct hash *supl_pt)
 {
@@ -46,9 +46,10 @@ static bool page_less (const struct hash_elem *a_, const struct hash_elem *b_, v
 
 /*
  * Returns the supplemental page table entry, containing the given virtual address,
- * or a null pointer if no such page exists.
+ * or a null pointer if no such page exists.  The caller must hold
+ * the process's supl_pt_lock.
 */
-supl_pte *page_lookup (process_t *p, const uint32_t pg_no)
+static supl_pte *page_lookup (process_t *p, const uint32_t pg_no)
 {
 	struct supl_pte spte;
 	struct hash_elem *e;
@@ -59,25 +60,34 @@ supl_pte *page_lookup (process_t *p, const uint32_t pg_no)
 	return e != NULL ? hash_entry (e, supl_pte, he) : NULL ;
 }
 
-void supl_pt_insert(struct hash *spt, supl_pte *spte)
+void supl_pt_insert(process_t *p, supl_pte *spte)
 {
-	hash_insert(spt, &(spte->he));
+	rwlock_acquire_write(&p->supl_pt_lock);
+	hash_insert(&p->supl_pt, &(spte->he));
+	rwlock_release_write(&p->supl_pt_lock);
 }
 
-void supl_pt_remove(struct hash *spt, supl_pte *spte)
+void supl_pt_remove(process_t *p, supl_pte *spte)
 {
-	hash_delete(spt, &(spte->he));
+	rwlock_acquire_write(&p->supl_pt_lock);
+	hash_delete(&p->supl_pt, &(spte->he));
+	rwlock_release_write(&p->supl_pt_lock);
 }
 
 supl_pte *supl_pt_get_spte(process_t *p, void *uaddr)
 {
 	uint32_t pg_nr = pg_no(uaddr);
-	return page_lookup(p, pg_nr);
+	rwlock_acquire_read(&p->supl_pt_lock);
+	supl_pte *pte = page_lookup(p, pg_nr);
+	rwlock_release_read(&p->supl_pt_lock);
+	return pte;
 }
 
 void supl_pt_remove_spte(process_t *p, void *uaddr) {
+	rwlock_acquire_write(&p->supl_pt_lock);
 	supl_pte* pte = page_lookup(p, pg_no(uaddr));
 	if(pte) {
-		supl_pt_remove(&(p->supl_pt), pte);
+		hash_delete(&p->supl_pt, &(pte->he));
 	}
+	rwlock_release_write(&p->supl_pt_lock);
 }
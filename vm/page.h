@@ -20,8 +20,8 @@ struct supl_pte {						// an entry (element) in the supplemental page table
 
 void supl_pt_init(struct hash *);
 void supl_pt_free(struct hash *);
-void supl_pt_insert(struct hash *spt, supl_pte *spte);
-void supl_pt_remove(struct hash *spt, supl_pte *spte);
+void supl_pt_insert(process_t *p, supl_pte *spte);
+void supl_pt_remove(process_t *p, supl_pte *spte);
 supl_pte* supl_pt_get_spte(process_t *p, void *uaddr);
 void supl_pt_remove_spte(process_t *p, void *uaddr);
 